@@ -0,0 +1,296 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <cstdio>
+#include <cstring>
+#include "BoundedFileIo.h"
+
+namespace {
+Q_DECLARE_LOGGING_CATEGORY(PHOTOTONIC_METADATA_IO_LOG)
+Q_LOGGING_CATEGORY(PHOTOTONIC_METADATA_IO_LOG, "phototonic.exif.io", QtWarningMsg)
+
+// Marker segments and IFDs are small and mostly adjacent, one block usually serves several of them
+const qint64 ReadAheadSize = 32 * 1024;
+}
+
+BoundedFileIo::BoundedFileIo(const QString &fileFullPath, qint64 readLimit) : file(fileFullPath) {
+    fileSize = file.size();
+    position = 0;
+    this->readLimit = readLimit;
+    fetchedBytes = 0;
+    blockOffset = 0;
+    mappedData = 0;
+    errorState = false;
+    eofState = false;
+    limitExceeded = false;
+}
+
+BoundedFileIo::~BoundedFileIo() {
+    close();
+}
+
+Exiv2::Image::AutoPtr BoundedFileIo::readMetadata(const QString &imageFullPath, qint64 &bytesRead) {
+    BoundedFileIo *boundedIo = new BoundedFileIo(imageFullPath);
+    Exiv2::BasicIo::AutoPtr io(boundedIo);
+
+    // What ImageFactory::open() does, without handing over the I/O before the image owns it
+    if (io->open() != 0) {
+        throw Exiv2::Error(Exiv2::kerDataSourceOpenFailed, io->path(), Exiv2::strError());
+    }
+    int imageType = Exiv2::ImageFactory::getType(*io);
+    if (imageType == Exiv2::ImageType::none) {
+        throw Exiv2::Error(Exiv2::kerFileContainsUnknownImageType);
+    }
+    Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::create(imageType, io);
+    if (!image.get()) {
+        throw Exiv2::Error(Exiv2::kerUnsupportedImageType, imageFullPath.toStdString());
+    }
+
+    try {
+        image->readMetadata();
+    } catch (Exiv2::Error &) {
+        if (!boundedIo->limitReached()) {
+            bytesRead += boundedIo->bytesRead();
+            throw;
+        }
+    }
+
+    // Some parsers stop quietly at a failed read, their metadata would then be incomplete
+    bytesRead += boundedIo->bytesRead();
+    if (boundedIo->limitReached()) {
+        qCDebug(PHOTOTONIC_METADATA_IO_LOG) << imageFullPath << "needs more than" << DefaultReadLimit
+                                            << "bytes for its metadata, reading the whole file";
+        image = Exiv2::ImageFactory::open(imageFullPath.toStdString());
+        image->readMetadata();
+        bytesRead += QFileInfo(imageFullPath).size();
+        return image;
+    }
+
+    qCDebug(PHOTOTONIC_METADATA_IO_LOG) << imageFullPath << "read" << boundedIo->bytesRead()
+                                        << "of" << boundedIo->size() << "bytes";
+    return image;
+}
+
+qint64 BoundedFileIo::bytesRead() const {
+    return fetchedBytes;
+}
+
+bool BoundedFileIo::limitReached() const {
+    return limitExceeded;
+}
+
+int BoundedFileIo::open() {
+    close();
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return 1;
+    }
+
+    // The block survives reopening, parsers open the file once to detect the type and once to read
+    fileSize = file.size();
+    position = 0;
+    errorState = false;
+    eofState = false;
+    return 0;
+}
+
+int BoundedFileIo::close() {
+    int result = munmap();
+    if (file.isOpen()) {
+        file.close();
+    }
+    return result;
+}
+
+long BoundedFileIo::write(const Exiv2::byte *, long) {
+    return 0;
+}
+
+long BoundedFileIo::write(Exiv2::BasicIo &) {
+    return 0;
+}
+
+int BoundedFileIo::putb(Exiv2::byte) {
+    return EOF;
+}
+
+Exiv2::DataBuf BoundedFileIo::read(long readCount) {
+    Exiv2::DataBuf buffer(readCount);
+    long readBytes = read(buffer.pData_, buffer.size_);
+    buffer.size_ = readBytes;
+    return buffer;
+}
+
+long BoundedFileIo::read(Exiv2::byte *buffer, long readCount) {
+    if (!file.isOpen() || readCount <= 0) {
+        return 0;
+    }
+
+    qint64 count = qMin(qint64(readCount), fileSize - position);
+    if (count < readCount) {
+        eofState = true;
+    }
+    if (count <= 0) {
+        return 0;
+    }
+
+    char *data = reinterpret_cast<char *>(buffer);
+    qint64 copied = 0;
+    while (copied < count) {
+        qint64 offset = position + copied;
+        if (offset >= blockOffset && offset < blockOffset + block.size()) {
+            qint64 available = qMin(count - copied, blockOffset + block.size() - offset);
+            memcpy(data + copied, block.constData() + (offset - blockOffset), available);
+            copied += available;
+        } else if (count - copied >= ReadAheadSize) {
+            // Large reads bypass the block so they are not fetched twice
+            if (!fetch(offset, data + copied, count - copied)) {
+                break;
+            }
+            copied = count;
+        } else if (!fillBlock(offset)) {
+            break;
+        }
+    }
+
+    position += copied;
+    return long(copied);
+}
+
+int BoundedFileIo::getb() {
+    Exiv2::byte data;
+    if (read(&data, 1) != 1) {
+        return EOF;
+    }
+    return data;
+}
+
+void BoundedFileIo::transfer(Exiv2::BasicIo &) {
+    throw Exiv2::Error(Exiv2::kerErrorMessage, "BoundedFileIo is read only");
+}
+
+#if defined(_MSC_VER)
+int BoundedFileIo::seek(int64_t offset, Position origin) {
+#else
+int BoundedFileIo::seek(long offset, Position origin) {
+#endif
+    qint64 newPosition = offset;
+    if (origin == cur) {
+        newPosition += position;
+    } else if (origin == end) {
+        newPosition += fileSize;
+    }
+
+    if (newPosition < 0) {
+        return 1;
+    }
+    if (newPosition > fileSize) {
+        eofState = true;
+        return 1;
+    }
+
+    position = newPosition;
+    eofState = false;
+    return 0;
+}
+
+Exiv2::byte *BoundedFileIo::mmap(bool isWriteable) {
+    if (isWriteable) {
+        throw Exiv2::Error(Exiv2::kerErrorMessage, "BoundedFileIo is read only");
+    }
+
+    if (!mappedData && file.isOpen() && fileSize > 0) {
+        mappedData = file.map(0, fileSize);
+        if (!mappedData) {
+            throw Exiv2::Error(Exiv2::kerCallFailed, path(), Exiv2::strError(), "QFile::map");
+        }
+    }
+    return mappedData;
+}
+
+int BoundedFileIo::munmap() {
+    if (!mappedData) {
+        return 0;
+    }
+
+    bool unmapped = file.unmap(mappedData);
+    mappedData = 0;
+    return unmapped ? 0 : 1;
+}
+
+long BoundedFileIo::tell() const {
+    return long(position);
+}
+
+size_t BoundedFileIo::size() const {
+    return size_t(fileSize);
+}
+
+bool BoundedFileIo::isopen() const {
+    return file.isOpen();
+}
+
+int BoundedFileIo::error() const {
+    return errorState ? 1 : 0;
+}
+
+bool BoundedFileIo::eof() const {
+    return eofState;
+}
+
+std::string BoundedFileIo::path() const {
+    return file.fileName().toStdString();
+}
+
+#ifdef EXV_UNICODE_PATH
+std::wstring BoundedFileIo::wpath() const {
+    return file.fileName().toStdWString();
+}
+#endif
+
+void BoundedFileIo::populateFakeData() {
+}
+
+bool BoundedFileIo::fetch(qint64 offset, char *data, qint64 count) {
+    if (fetchedBytes + count > readLimit) {
+        limitExceeded = true;
+        errorState = true;
+        return false;
+    }
+
+    if (!file.seek(offset) || file.read(data, count) != count) {
+        errorState = true;
+        return false;
+    }
+
+    fetchedBytes += count;
+    return true;
+}
+
+bool BoundedFileIo::fillBlock(qint64 offset) {
+    qint64 count = qMin(ReadAheadSize, fileSize - offset);
+    QByteArray newBlock(int(count), Qt::Uninitialized);
+    if (!fetch(offset, newBlock.data(), count)) {
+        return false;
+    }
+
+    block = newBlock;
+    blockOffset = offset;
+    return true;
+}
@@ -0,0 +1,118 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOUNDED_FILE_IO_H
+#define BOUNDED_FILE_IO_H
+
+#include <QByteArray>
+#include <QFile>
+#include <exiv2/exiv2.hpp>
+
+/*
+ * Read only Exiv2 I/O for metadata parsing that fetches only the ranges the parser asks for,
+ * through a small read-ahead block, and gives up once readLimit bytes were fetched. Parsers that
+ * skip the image data by seeking (JPEG, PNG, WebP, ...) then never pull it over the network.
+ * mmap() maps the file, which the TIFF based formats use; mapped pages are loaded on access and
+ * are not counted in bytesRead().
+ */
+class BoundedFileIo : public Exiv2::BasicIo {
+
+public:
+    static const qint64 DefaultReadLimit = 8 * 1024 * 1024;
+
+    explicit BoundedFileIo(const QString &fileFullPath, qint64 readLimit = DefaultReadLimit);
+
+    ~BoundedFileIo();
+
+    /*
+     * Opens the image and reads its metadata through a BoundedFileIo. When the format needs more
+     * than the read limit the image is read again with the default Exiv2 file I/O. Adds the
+     * bytes fetched from the file to bytesRead. Throws Exiv2::Error like ImageFactory::open().
+     */
+    static Exiv2::Image::AutoPtr readMetadata(const QString &imageFullPath, qint64 &bytesRead);
+
+    // Bytes fetched from the file since construction, reopening does not reset it
+    qint64 bytesRead() const;
+
+    bool limitReached() const;
+
+    int open();
+
+    int close();
+
+    long write(const Exiv2::byte *data, long writeCount);
+
+    long write(Exiv2::BasicIo &source);
+
+    int putb(Exiv2::byte data);
+
+    Exiv2::DataBuf read(long readCount);
+
+    long read(Exiv2::byte *buffer, long readCount);
+
+    int getb();
+
+    void transfer(Exiv2::BasicIo &source);
+
+#if defined(_MSC_VER)
+    int seek(int64_t offset, Position origin);
+#else
+    int seek(long offset, Position origin);
+#endif
+
+    Exiv2::byte *mmap(bool isWriteable = false);
+
+    int munmap();
+
+    long tell() const;
+
+    size_t size() const;
+
+    bool isopen() const;
+
+    int error() const;
+
+    bool eof() const;
+
+    std::string path() const;
+
+#ifdef EXV_UNICODE_PATH
+    std::wstring wpath() const;
+#endif
+
+    void populateFakeData();
+
+private:
+    bool fetch(qint64 offset, char *data, qint64 count);
+
+    bool fillBlock(qint64 offset);
+
+    QFile file;
+    qint64 fileSize;
+    qint64 position;
+    qint64 readLimit;
+    qint64 fetchedBytes;
+    QByteArray block;
+    qint64 blockOffset;
+    uchar *mappedData;
+    bool errorState;
+    bool eofState;
+    bool limitExceeded;
+};
+
+#endif // BOUNDED_FILE_IO_H
@@ -0,0 +1,347 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtEndian>
+#include <cstring>
+#include "ExactDuplicateFinder.h"
+
+namespace {
+// Large enough for sequential disk throughput
+const qint64 StreamChunkSize = 1024 * 1024;
+const quint64 HashSeed = 0;
+
+const quint64 Prime1 = Q_UINT64_C(0x9E3779B185EBCA87);
+const quint64 Prime2 = Q_UINT64_C(0xC2B2AE3D27D4EB4F);
+const quint64 Prime3 = Q_UINT64_C(0x165667B19E3779F9);
+const quint64 Prime4 = Q_UINT64_C(0x85EBCA77C2B2AE63);
+const quint64 Prime5 = Q_UINT64_C(0x27D4EB2F165667C5);
+
+inline quint64 rotateLeft(quint64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 readWord(const char *data) {
+    quint64 word;
+    memcpy(&word, data, 8);
+    return qFromLittleEndian(word);
+}
+
+inline quint64 hashRound(quint64 lane, quint64 word) {
+    return rotateLeft(lane + word * Prime2, 31) * Prime1;
+}
+
+inline quint64 mergeLane(quint64 hash, quint64 lane) {
+    return (hash ^ hashRound(0, lane)) * Prime1 + Prime4;
+}
+
+/*
+ * XXH64, fed in pieces. Four independent lanes keep the multiplier busy, so it stays well ahead
+ * of the disk, and every input bit reaches every output bit, unlike a word-wise FNV.
+ */
+class StreamHash {
+
+public:
+    explicit StreamHash(quint64 seed) {
+        lanes[0] = seed + Prime1 + Prime2;
+        lanes[1] = seed + Prime2;
+        lanes[2] = seed;
+        lanes[3] = seed - Prime1;
+        this->seed = seed;
+        totalSize = 0;
+        pendingSize = 0;
+    }
+
+    void add(const char *data, qint64 size) {
+        totalSize += size;
+        if (pendingSize > 0) {
+            int taken = int(qMin(size, qint64(StripeSize - pendingSize)));
+            memcpy(pending + pendingSize, data, taken);
+            pendingSize += taken;
+            data += taken;
+            size -= taken;
+            if (pendingSize < StripeSize) {
+                return;
+            }
+            addStripe(pending);
+            pendingSize = 0;
+        }
+
+        for (; size >= StripeSize; data += StripeSize, size -= StripeSize) {
+            addStripe(data);
+        }
+        memcpy(pending, data, size_t(size));
+        pendingSize = int(size);
+    }
+
+    quint64 result() const {
+        quint64 hash;
+        if (totalSize >= StripeSize) {
+            hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12)
+                   + rotateLeft(lanes[3], 18);
+            for (int lane = 0; lane < 4; ++lane) {
+                hash = mergeLane(hash, lanes[lane]);
+            }
+        } else {
+            hash = seed + Prime5;
+        }
+        hash += quint64(totalSize);
+
+        int offset = 0;
+        for (; offset + 8 <= pendingSize; offset += 8) {
+            hash ^= hashRound(0, readWord(pending + offset));
+            hash = rotateLeft(hash, 27) * Prime1 + Prime4;
+        }
+        if (offset + 4 <= pendingSize) {
+            quint32 word;
+            memcpy(&word, pending + offset, 4);
+            hash ^= quint64(qFromLittleEndian(word)) * Prime1;
+            hash = rotateLeft(hash, 23) * Prime2 + Prime3;
+            offset += 4;
+        }
+        for (; offset < pendingSize; ++offset) {
+            hash ^= uchar(pending[offset]) * Prime5;
+            hash = rotateLeft(hash, 11) * Prime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= Prime2;
+        hash ^= hash >> 29;
+        hash *= Prime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+private:
+    static const int StripeSize = 32;
+
+    void addStripe(const char *data) {
+        for (int lane = 0; lane < 4; ++lane) {
+            lanes[lane] = hashRound(lanes[lane], readWord(data + 8 * lane));
+        }
+    }
+
+    quint64 lanes[4];
+    quint64 seed;
+    qint64 totalSize;
+    char pending[StripeSize];
+    int pendingSize;
+};
+}
+
+ExactDuplicateFinder::ExactDuplicateFinder(QObject *parent, JobScheduler *jobScheduler) : QObject(parent) {
+    this->jobScheduler = jobScheduler;
+    searchJob = 0;
+}
+
+bool ExactDuplicateFinder::partialHash(const QString &fileFullPath, quint64 &hash) {
+    QFile file(fileFullPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray head = file.read(PartialHashSize);
+    StreamHash streamHash(HashSeed);
+    streamHash.add(head.constData(), head.size());
+
+    // Files up to twice the partial size are covered completely, head and tail may overlap
+    qint64 tailOffset = qMax(file.size() - PartialHashSize, qint64(head.size()));
+    if (tailOffset < file.size()) {
+        if (!file.seek(tailOffset)) {
+            return false;
+        }
+        QByteArray tail = file.read(PartialHashSize);
+        streamHash.add(tail.constData(), tail.size());
+    }
+
+    hash = streamHash.result();
+    return file.error() == QFileDevice::NoError;
+}
+
+bool ExactDuplicateFinder::fullHash(const QString &fileFullPath, quint64 &hash) {
+    QFile file(fileFullPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray chunk(int(StreamChunkSize), Qt::Uninitialized);
+    StreamHash streamHash(HashSeed);
+    for (;;) {
+        qint64 readBytes = file.read(chunk.data(), StreamChunkSize);
+        if (readBytes < 0) {
+            return false;
+        }
+        if (readBytes == 0) {
+            break;
+        }
+        streamHash.add(chunk.constData(), readBytes);
+    }
+
+    hash = streamHash.result();
+    return true;
+}
+
+bool ExactDuplicateFinder::sameContents(const QString &firstFullPath, const QString &secondFullPath) {
+    QFile firstFile(firstFullPath);
+    QFile secondFile(secondFullPath);
+    if (!firstFile.open(QIODevice::ReadOnly) || !secondFile.open(QIODevice::ReadOnly)
+        || firstFile.size() != secondFile.size()) {
+        return false;
+    }
+
+    QByteArray firstChunk(int(StreamChunkSize), Qt::Uninitialized);
+    QByteArray secondChunk(int(StreamChunkSize), Qt::Uninitialized);
+    for (;;) {
+        qint64 firstBytes = firstFile.read(firstChunk.data(), StreamChunkSize);
+        qint64 secondBytes = secondFile.read(secondChunk.data(), StreamChunkSize);
+        if (firstBytes < 0 || firstBytes != secondBytes) {
+            return false;
+        }
+        if (firstBytes == 0) {
+            return true;
+        }
+        if (memcmp(firstChunk.constData(), secondChunk.constData(), size_t(firstBytes)) != 0) {
+            return false;
+        }
+    }
+}
+
+bool ExactDuplicateFinder::start(const QStringList &fileFullPaths) {
+    if (isRunning()) {
+        return false;
+    }
+
+    distinctFiles.clear();
+    searchJob = new Job(tr("Find identical files among %n image(s)", "", fileFullPaths.size()), 1,
+                        [this, fileFullPaths](int, QString &) {
+                            distinctFiles = findDuplicates(fileFullPaths);
+                            return true;
+                        });
+    connect(searchJob, SIGNAL(finished(bool)), this, SLOT(onSearchFinished(bool)));
+    jobScheduler->submit(searchJob);
+    return true;
+}
+
+void ExactDuplicateFinder::cancel() {
+    if (searchJob) {
+        searchJob->cancel();
+    }
+}
+
+bool ExactDuplicateFinder::isRunning() const {
+    return searchJob != 0;
+}
+
+QStringList ExactDuplicateFinder::findDuplicates(const QStringList &fileFullPaths) {
+    QVector<bool> isCopy(fileFullPaths.size(), false);
+
+    // Indexes into fileFullPaths, ascending so the first file of a group is the original
+    QMap<qint64, QList<int> > sizeGroups;
+    for (int i = 0; i < fileFullPaths.size(); ++i) {
+        qint64 fileSize = QFileInfo(fileFullPaths.at(i)).size();
+        if (fileSize > 0) {
+            sizeGroups[fileSize].append(i);
+        }
+    }
+
+    QMap<qint64, QList<int> >::const_iterator sizeGroup;
+    for (sizeGroup = sizeGroups.constBegin(); sizeGroup != sizeGroups.constEnd() && !searchJob->isCanceled(); ++sizeGroup) {
+        if (sizeGroup->size() < 2) {
+            continue;
+        }
+
+        QMap<quint64, QList<int> > partialGroups;
+        foreach (int i, *sizeGroup) {
+            quint64 hash;
+            if (partialHash(fileFullPaths.at(i), hash)) {
+                partialGroups[hash].append(i);
+            }
+        }
+
+        foreach (const QList<int> &partialGroup, partialGroups) {
+            QList<QList<int> > identicalGroups;
+            if (sizeGroup.key() <= 2 * PartialHashSize) {
+                identicalGroups.append(partialGroup);
+            } else if (partialGroup.size() > 1) {
+                QMap<quint64, QList<int> > fullGroups;
+                foreach (int i, partialGroup) {
+                    if (searchJob->isCanceled()) {
+                        break;
+                    }
+                    quint64 hash;
+                    if (fullHash(fileFullPaths.at(i), hash)) {
+                        fullGroups[hash].append(i);
+                    }
+                }
+                identicalGroups = fullGroups.values();
+            }
+
+            foreach (const QList<int> &hashGroup, identicalGroups) {
+                if (hashGroup.size() < 2 || searchJob->isCanceled()) {
+                    continue;
+                }
+
+                // Equal hashes only make files candidates, each one is compared with the originals
+                QList<QList<int> > contentGroups;
+                foreach (int i, hashGroup) {
+                    if (searchJob->isCanceled()) {
+                        break;
+                    }
+
+                    bool matched = false;
+                    for (int group = 0; group < contentGroups.size() && !matched; ++group) {
+                        if (sameContents(fileFullPaths.at(contentGroups.at(group).first()), fileFullPaths.at(i))) {
+                            contentGroups[group].append(i);
+                            matched = true;
+                        }
+                    }
+                    if (!matched) {
+                        contentGroups.append(QList<int>() << i);
+                    }
+                }
+
+                foreach (const QList<int> &identicalGroup, contentGroups) {
+                    if (identicalGroup.size() < 2 || searchJob->isCanceled()) {
+                        continue;
+                    }
+
+                    QStringList identicalFiles;
+                    foreach (int i, identicalGroup) {
+                        identicalFiles.append(fileFullPaths.at(i));
+                        isCopy[i] = true;
+                    }
+                    isCopy[identicalGroup.first()] = false;
+                    QMetaObject::invokeMethod(this, "duplicatesFound", Qt::QueuedConnection,
+                                              Q_ARG(QStringList, identicalFiles));
+                }
+            }
+        }
+    }
+
+    QStringList distinctFiles;
+    for (int i = 0; i < fileFullPaths.size(); ++i) {
+        if (!isCopy.at(i)) {
+            distinctFiles.append(fileFullPaths.at(i));
+        }
+    }
+    return distinctFiles;
+}
+
+void ExactDuplicateFinder::onSearchFinished(bool canceled) {
+    searchJob = 0;
+    emit finished(distinctFiles, canceled);
+}
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EXACT_DUPLICATE_FINDER_H
+#define EXACT_DUPLICATE_FINDER_H
+
+#include <QtWidgets>
+#include "JobScheduler.h"
+
+/*
+ * Finds byte-identical files without decoding them. Files are grouped by size, files sharing a
+ * size are told apart by a hash of their first and last PartialHashSize bytes, and only files
+ * that still collide are hashed completely, in streaming reads. Files with equal hashes are
+ * compared byte by byte before they are reported. Most files are never read at all.
+ * The search runs as a single item job of a JobScheduler, results are delivered on the thread that
+ * owns the finder.
+ */
+class ExactDuplicateFinder : public QObject {
+Q_OBJECT
+
+public:
+    static const qint64 PartialHashSize = 64 * 1024;
+
+    ExactDuplicateFinder(QObject *parent, JobScheduler *jobScheduler);
+
+    // Returns false when a previous search is still going
+    bool start(const QStringList &fileFullPaths);
+
+    // Stops the search after the file being read, finished() follows
+    void cancel();
+
+    bool isRunning() const;
+
+    // Non-cryptographic 64 bit hashes, false when the file could not be read
+    static bool partialHash(const QString &fileFullPath, quint64 &hash);
+
+    static bool fullHash(const QString &fileFullPath, quint64 &hash);
+
+    // False as well when either file could not be read
+    static bool sameContents(const QString &firstFullPath, const QString &secondFullPath);
+
+    // Runs on a worker thread, returns every file except the copies
+    QStringList findDuplicates(const QStringList &fileFullPaths);
+
+signals:
+
+    // Identical files in the order they were given, the first one is taken as the original
+    void duplicatesFound(const QStringList &identicalFiles);
+
+    // Every file except the copies of the originals, to be compared by other means
+    void finished(const QStringList &distinctFiles, bool canceled);
+
+private slots:
+
+    void onSearchFinished(bool canceled);
+
+private:
+    JobScheduler *jobScheduler;
+    // Set while a search runs, the worker polls it for cancellation
+    Job *searchJob;
+    // Written by the worker, read once the job is done
+    QStringList distinctFiles;
+};
+
+#endif // EXACT_DUPLICATE_FINDER_H
@@ -0,0 +1,307 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cerrno>
+#include <cstring>
+#ifdef Q_OS_LINUX
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "FileTransfer.h"
+
+namespace {
+// Large requests keep network file systems streaming instead of waiting for each reply
+const qint64 StreamChunkSize = 4 * 1024 * 1024;
+// Kernel copies are split so a cancel is noticed within seconds even on slow links
+const qint64 KernelCopyChunkSize = 64 * 1024 * 1024;
+
+#ifdef Q_OS_LINUX
+/*
+ * Copies in the kernel and returns the number of bytes copied before it had to stop, which is
+ * less than size when it was canceled or the fast paths are not available. The file offsets are
+ * advanced past the copied bytes. Only real I/O errors are set in error.
+ */
+qint64 kernelCopy(int sourceFd, int destFd, qint64 size, const Job *job, QString &error) {
+#ifdef FICLONE
+    if (ioctl(destFd, FICLONE, sourceFd) == 0) {
+        return size;
+    }
+#endif
+
+    qint64 copied = 0;
+#ifdef SYS_copy_file_range
+    while (copied < size && !(job && job->isCanceled())) {
+        long result = syscall(SYS_copy_file_range, sourceFd, static_cast<void *>(0), destFd, static_cast<void *>(0),
+                              size_t(qMin(size - copied, KernelCopyChunkSize)), 0u);
+        if (result > 0) {
+            copied += result;
+            continue;
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // Older kernels do not copy across file systems, some file systems not at all
+        if (result < 0 && errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP
+            && errno != EPERM && errno != EBADF) {
+            error = QString::fromLocal8Bit(strerror(errno));
+        }
+        break;
+    }
+#else
+    Q_UNUSED(job)
+    Q_UNUSED(error)
+#endif
+    return copied;
+}
+#endif
+}
+
+FileTransfer::FileTransfer(QObject *parent, const QStringList &sourceFiles, const QString &destDir, bool isCopy)
+        : QObject(parent), sources(sourceFiles), destDir(destDir) {
+    copy = isCopy;
+    transferJob = 0;
+    prepared = false;
+    totalBytes = 0;
+    doneBytes = 0;
+}
+
+void FileTransfer::start(JobScheduler *jobScheduler) {
+    int fileCount = sources.size();
+    results.fill(false, fileCount);
+    errors.fill(QString(), fileCount);
+    bool *fileResults = results.data();
+    QString *fileErrors = errors.data();
+
+    QString title = copy ? tr("Copy %n file(s) to %1", "", fileCount) : tr("Move %n file(s) to %1", "", fileCount);
+    transferJob = new Job(title.arg(destDir), fileCount, [this, fileResults, fileErrors](int item, QString &error) {
+        prepare();
+        fileResults[item] = transferFile(sources.at(item), destinations.at(item), copy, transferJob, error);
+        fileErrors[item] = error;
+        return fileResults[item];
+    });
+    transferJob->setMaxParallelItems(FilesInFlight);
+    connect(transferJob, SIGNAL(itemFinished(int, bool, QString)), this, SLOT(onFileProcessed(int)));
+    connect(transferJob, SIGNAL(finished(bool)), this, SLOT(onJobFinished(bool)));
+    jobScheduler->submit(transferJob);
+}
+
+Job *FileTransfer::job() const {
+    return transferJob;
+}
+
+bool FileTransfer::isCopy() const {
+    return copy;
+}
+
+QString FileTransfer::destinationDir() const {
+    return destDir;
+}
+
+QStringList FileTransfer::transferredSources() const {
+    return transferredFiles;
+}
+
+QStringList FileTransfer::transferredDestinations() const {
+    return transferredDestFiles;
+}
+
+QStringList FileTransfer::failedFiles() const {
+    return failedFileList;
+}
+
+void FileTransfer::prepare() {
+    QMutexLocker locker(&prepareMutex);
+    if (prepared) {
+        return;
+    }
+
+    // One listing of the destination instead of probing every candidate name on the share
+    QSet<QString> takenNames = listFileNames(destDir);
+    fileSizes.reserve(sources.size());
+    foreach (const QString &sourcePath, sources) {
+        QFileInfo sourceInfo(sourcePath);
+        destinations.append(destDir + QDir::separator() + uniqueFileName(sourceInfo.fileName(), takenNames));
+        fileSizes.append(sourceInfo.size());
+        totalBytes += sourceInfo.size();
+    }
+    prepared = true;
+}
+
+void FileTransfer::onFileProcessed(int item) {
+    // Each item waited for prepare(), so the sizes are complete
+    doneBytes += fileSizes.at(item);
+    transferJob->progress()->setBytes(doneBytes, totalBytes);
+}
+
+void FileTransfer::onJobFinished(bool canceled) {
+    for (int i = 0; i < sources.size(); ++i) {
+        // Files finished after a cancel count too, a moved file is gone from the source either way
+        if (results.at(i)) {
+            transferredFiles.append(sources.at(i));
+            transferredDestFiles.append(destinations.at(i));
+        } else if (!errors.at(i).isEmpty()) {
+            qWarning() << "Failed to copy or move" << sources.at(i) << errors.at(i);
+            failedFileList.append(sources.at(i) + ": " + errors.at(i));
+        }
+    }
+
+    emit finished(canceled);
+}
+
+bool FileTransfer::copyOrMoveFile(bool isCopy, const QString &sourcePath, const QString &destDir, QString &destPath,
+                                  QString &error) {
+    QString fileName = QFileInfo(sourcePath).fileName();
+    destPath = destDir + QDir::separator() + fileName;
+    if (QFileInfo::exists(destPath)) {
+        QSet<QString> takenNames = listFileNames(destDir);
+        destPath = destDir + QDir::separator() + uniqueFileName(fileName, takenNames);
+    }
+
+    return transferFile(sourcePath, destPath, isCopy, 0, error);
+}
+
+bool FileTransfer::transferFile(const QString &sourcePath, const QString &destPath, bool isCopy, const Job *job,
+                                QString &error) {
+    if (!isCopy) {
+        // Unlike QFile::rename(), never falls back to a copy of its own and never replaces the target
+        if (QDir().rename(sourcePath, destPath)) {
+            return true;
+        }
+        if (!QFileInfo::exists(sourcePath)) {
+            error = tr("File not found");
+            return false;
+        }
+    }
+
+    if (!copyFile(sourcePath, destPath, job, error)) {
+        return false;
+    }
+
+    if (!isCopy && !QFile::remove(sourcePath)) {
+        error = tr("Copied, but the original could not be removed");
+        return false;
+    }
+    return true;
+}
+
+bool FileTransfer::copyFile(const QString &sourcePath, const QString &destPath, const Job *job, QString &error) {
+    QFile sourceFile(sourcePath);
+    if (!sourceFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        error = sourceFile.errorString();
+        return false;
+    }
+
+    QFile destFile(destPath);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    QIODevice::OpenMode destMode = QIODevice::WriteOnly | QIODevice::NewOnly | QIODevice::Unbuffered;
+#else
+    if (destFile.exists()) {
+        error = tr("Destination file already exists");
+        return false;
+    }
+    QIODevice::OpenMode destMode = QIODevice::WriteOnly | QIODevice::Unbuffered;
+#endif
+    if (!destFile.open(destMode)) {
+        error = destFile.errorString();
+        return false;
+    }
+
+    bool succeeded = copyData(sourceFile, destFile, job, error);
+
+    // Network file systems report failed writes as late as on close
+    destFile.close();
+    if (succeeded && destFile.error() != QFileDevice::NoError) {
+        error = destFile.errorString();
+        succeeded = false;
+    }
+
+    if (!succeeded) {
+        destFile.remove();
+        return false;
+    }
+
+    destFile.setPermissions(sourceFile.permissions());
+    return true;
+}
+
+bool FileTransfer::copyData(QFile &sourceFile, QFile &destFile, const Job *job, QString &error) {
+#ifdef Q_OS_LINUX
+    qint64 size = sourceFile.size();
+    qint64 copied = kernelCopy(sourceFile.handle(), destFile.handle(), size, job, error);
+    if (!error.isEmpty()) {
+        return false;
+    }
+    if (copied >= size) {
+        return true;
+    }
+    if (copied > 0 && (!sourceFile.seek(copied) || !destFile.seek(copied))) {
+        error = sourceFile.errorString();
+        return false;
+    }
+#endif
+
+    QByteArray buffer(int(StreamChunkSize), Qt::Uninitialized);
+    for (;;) {
+        if (job && job->isCanceled()) {
+            return false;
+        }
+
+        qint64 readBytes = sourceFile.read(buffer.data(), StreamChunkSize);
+        if (readBytes < 0) {
+            error = sourceFile.errorString();
+            return false;
+        }
+        if (readBytes == 0) {
+            return true;
+        }
+        if (destFile.write(buffer.constData(), readBytes) != readBytes) {
+            error = destFile.errorString();
+            return false;
+        }
+    }
+}
+
+QSet<QString> FileTransfer::listFileNames(const QString &dirPath) {
+    QSet<QString> fileNames;
+    QDirIterator iterator(dirPath, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot);
+    while (iterator.hasNext()) {
+        iterator.next();
+        fileNames.insert(iterator.fileName().toLower());
+    }
+    return fileNames;
+}
+
+QString FileTransfer::uniqueFileName(const QString &fileName, QSet<QString> &takenNames) {
+    QString uniqueName = fileName;
+    if (takenNames.contains(uniqueName.toLower())) {
+        int extensionStart = fileName.lastIndexOf('.');
+        QString baseName = extensionStart > 0 ? fileName.left(extensionStart) : fileName;
+        QString extension = extensionStart > 0 ? fileName.mid(extensionStart) : QString();
+
+        int copyNumber = 1;
+        do {
+            uniqueName = QString("%1_copy_%2%3").arg(baseName, QString::number(copyNumber++), extension);
+        } while (takenNames.contains(uniqueName.toLower()));
+    }
+
+    takenNames.insert(uniqueName.toLower());
+    return uniqueName;
+}
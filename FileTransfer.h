@@ -0,0 +1,112 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FILE_TRANSFER_H
+#define FILE_TRANSFER_H
+
+#include <QtWidgets>
+#include "JobScheduler.h"
+
+/*
+ * Copies or moves files into a directory as a job of a JobScheduler, FilesInFlight files at a
+ * time so network shares are never left waiting for the next request. A move within a file system
+ * is a rename. Copies take the kernel fast paths where there are some: a reflink on file systems
+ * that share extents, and copy_file_range(), which lets NFS and SMB servers copy on their side;
+ * otherwise the data is streamed in large blocks. Name conflicts are resolved against a single
+ * listing of the destination, names are compared case-insensitively for the sake of SMB shares.
+ */
+class FileTransfer : public QObject {
+Q_OBJECT
+
+public:
+    static const int FilesInFlight = 4;
+
+    FileTransfer(QObject *parent, const QStringList &sourceFiles, const QString &destDir, bool isCopy);
+
+    void start(JobScheduler *jobScheduler);
+
+    Job *job() const;
+
+    bool isCopy() const;
+
+    QString destinationDir() const;
+
+    // Known once finished() was emitted, in the order of the source files
+    QStringList transferredSources() const;
+
+    QStringList transferredDestinations() const;
+
+    // "path: error" lines
+    QStringList failedFiles() const;
+
+    // Blocking, for a single file. destPath gets the name the file was given.
+    static bool copyOrMoveFile(bool isCopy, const QString &sourcePath, const QString &destDir, QString &destPath,
+                               QString &error);
+
+    // Stops early without an error when job is canceled
+    static bool transferFile(const QString &sourcePath, const QString &destPath, bool isCopy, const Job *job,
+                             QString &error);
+
+    // Never replaces an existing file
+    static bool copyFile(const QString &sourcePath, const QString &destPath, const Job *job, QString &error);
+
+    // Lower-cased names of the directory entries
+    static QSet<QString> listFileNames(const QString &dirPath);
+
+    // fileName, or fileName_copy_N when it is taken, which is added to takenNames
+    static QString uniqueFileName(const QString &fileName, QSet<QString> &takenNames);
+
+signals:
+
+    void finished(bool canceled);
+
+private slots:
+
+    void onFileProcessed(int item);
+
+    void onJobFinished(bool canceled);
+
+private:
+    // Runs on the first worker, the others wait for it
+    void prepare();
+
+    static bool copyData(QFile &sourceFile, QFile &destFile, const Job *job, QString &error);
+
+    QStringList sources;
+    QString destDir;
+    bool copy;
+    Job *transferJob;
+
+    QMutex prepareMutex;
+    bool prepared;
+    // Filled by prepare()
+    QStringList destinations;
+    QVector<qint64> fileSizes;
+    qint64 totalBytes;
+
+    // One slot per file, written by the workers and read once the job is done
+    QVector<bool> results;
+    QVector<QString> errors;
+
+    qint64 doneBytes;
+    QStringList transferredFiles;
+    QStringList transferredDestFiles;
+    QStringList failedFileList;
+};
+
+#endif // FILE_TRANSFER_H
@@ -0,0 +1,100 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HammingBkTree.h"
+
+HammingBkTree::HammingBkTree() {
+}
+
+void HammingBkTree::clear() {
+    nodes.clear();
+}
+
+int HammingBkTree::size() const {
+    return nodes.size();
+}
+
+void HammingBkTree::insert(const ImageHash &hash, int value) {
+    Node newNode;
+    newNode.hash = hash;
+    newNode.value = value;
+    newNode.distanceToParent = 0;
+    newNode.firstChild = -1;
+    newNode.nextSibling = -1;
+
+    if (nodes.isEmpty()) {
+        nodes.append(newNode);
+        return;
+    }
+
+    int current = 0;
+    for (;;) {
+        const int currentDistance = ImageHash::distance(nodes.at(current).hash, hash);
+        if (currentDistance == 0) {
+            return;
+        }
+
+        int child = nodes.at(current).firstChild;
+        while (child >= 0 && nodes.at(child).distanceToParent != currentDistance) {
+            child = nodes.at(child).nextSibling;
+        }
+
+        if (child < 0) {
+            newNode.distanceToParent = currentDistance;
+            newNode.nextSibling = nodes.at(current).firstChild;
+            nodes.append(newNode);
+            nodes[current].firstChild = nodes.size() - 1;
+            return;
+        }
+        current = child;
+    }
+}
+
+bool HammingBkTree::findNearest(const ImageHash &hash, int maxDistance, int &value, int &nearestDistance) const {
+    if (nodes.isEmpty()) {
+        return false;
+    }
+
+    bool found = false;
+    int radius = maxDistance;
+    QVector<int> pendingNodes;
+    pendingNodes.append(0);
+
+    while (!pendingNodes.isEmpty()) {
+        const Node &node = nodes.at(pendingNodes.takeLast());
+        const int nodeDistance = ImageHash::distance(node.hash, hash);
+        if (nodeDistance <= radius && (!found || nodeDistance < nearestDistance)) {
+            found = true;
+            value = node.value;
+            nearestDistance = nodeDistance;
+            // Only strictly nearer hashes can replace this one
+            radius = nodeDistance - 1;
+            if (radius < 0) {
+                break;
+            }
+        }
+
+        for (int child = node.firstChild; child >= 0; child = nodes.at(child).nextSibling) {
+            if (qAbs(nodes.at(child).distanceToParent - nodeDistance) <= radius) {
+                pendingNodes.append(child);
+            }
+        }
+    }
+
+    return found;
+}
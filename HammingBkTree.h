@@ -0,0 +1,58 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAMMING_BK_TREE_H
+#define HAMMING_BK_TREE_H
+
+#include <QVector>
+#include "ImageHash.h"
+
+/*
+ * BK-tree over image hashes with the Hamming distance as metric. A search within distance d only
+ * descends into the children whose edge distance is within d of the distance to their parent, so
+ * small thresholds visit a small part of the tree. Nodes are kept in one array with the children
+ * of a node linked as a list, which keeps millions of hashes compact.
+ */
+class HammingBkTree {
+
+public:
+    HammingBkTree();
+
+    void clear();
+
+    int size() const;
+
+    // A hash that is already in the tree keeps its first value
+    void insert(const ImageHash &hash, int value);
+
+    // Value and distance of the nearest hash within maxDistance, false when there is none
+    bool findNearest(const ImageHash &hash, int maxDistance, int &value, int &nearestDistance) const;
+
+private:
+    struct Node {
+        ImageHash hash;
+        int value;
+        int distanceToParent;
+        int firstChild;
+        int nextSibling;
+    };
+
+    QVector<Node> nodes;
+};
+
+#endif // HAMMING_BK_TREE_H
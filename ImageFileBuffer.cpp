@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QFile>
+#include <QFileInfo>
+#include "ImageFileBuffer.h"
+
+ImageFileBuffer::ImageFileBuffer(const QString &imageFullPath) : imageFullPath(imageFullPath) {
+    loaded = false;
+}
+
+void ImageFileBuffer::load() const {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+
+    QFile imageFile(imageFullPath);
+    if (imageFile.open(QIODevice::ReadOnly)) {
+        imageData = imageFile.readAll();
+        if (imageFile.error() != QFileDevice::NoError) {
+            readError = imageFile.errorString();
+            imageData.clear();
+        }
+    } else {
+        readError = imageFile.errorString();
+    }
+}
+
+QString ImageFileBuffer::fileName() const {
+    return imageFullPath;
+}
+
+bool ImageFileBuffer::isValid() const {
+    load();
+    return readError.isEmpty();
+}
+
+QString ImageFileBuffer::errorString() const {
+    load();
+    return readError;
+}
+
+const QByteArray &ImageFileBuffer::data() const {
+    load();
+    return imageData;
+}
+
+QImageReader &ImageFileBuffer::reader() {
+    if (!imageBuffer.isOpen()) {
+        load();
+        imageBuffer.setBuffer(&imageData);
+        imageBuffer.open(QIODevice::ReadOnly);
+        imageReader.setDevice(&imageBuffer);
+
+        // The format comes from the content, formats without a signature (TGA, ...) need the suffix
+        if (!imageReader.canRead()) {
+            imageReader.setFormat(QFileInfo(imageFullPath).suffix().toLower().toLatin1());
+        }
+    }
+    return imageReader;
+}
+
+Exiv2::Image::AutoPtr ImageFileBuffer::readMetadata() const {
+    if (!isValid()) {
+        throw Exiv2::Error(Exiv2::kerDataSourceOpenFailed, imageFullPath.toStdString(), readError.toStdString());
+    }
+
+    // MemIo references the bytes instead of copying them
+    Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(
+            reinterpret_cast<const Exiv2::byte *>(imageData.constData()), imageData.size());
+    image->readMetadata();
+    return image;
+}
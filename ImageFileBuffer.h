@@ -0,0 +1,66 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_FILE_BUFFER_H
+#define IMAGE_FILE_BUFFER_H
+
+#include <QBuffer>
+#include <QImageReader>
+#include <exiv2/exiv2.hpp>
+
+/*
+ * Reads an image file once and serves the same bytes to QImageReader and to Exiv2, so decoding
+ * an image and parsing its metadata open and read the file a single time. The file is read on
+ * first use, so a buffer whose metadata comes from the index and is never decoded costs nothing.
+ */
+class ImageFileBuffer {
+
+public:
+    explicit ImageFileBuffer(const QString &imageFullPath);
+
+    QString fileName() const;
+
+    bool isValid() const;
+
+    QString errorString() const;
+
+    const QByteArray &data() const;
+
+    // Reads from the buffer and detects the format from the content, the suffix is only a fallback
+    QImageReader &reader();
+
+    /*
+     * Exiv2 image on top of the buffer with its metadata read, the buffer must outlive it.
+     * Writing its metadata does not change the file. Throws Exiv2::Error.
+     */
+    Exiv2::Image::AutoPtr readMetadata() const;
+
+private:
+    Q_DISABLE_COPY(ImageFileBuffer)
+
+    void load() const;
+
+    QString imageFullPath;
+    mutable bool loaded;
+    mutable QByteArray imageData;
+    mutable QString readError;
+    QBuffer imageBuffer;
+    QImageReader imageReader;
+};
+
+#endif // IMAGE_FILE_BUFFER_H
@@ -0,0 +1,54 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_HASH_H
+#define IMAGE_HASH_H
+
+#include <QMetaType>
+#include <QtAlgorithms>
+
+/*
+ * Perceptual hash of up to 128 bits, compared by the number of differing bits. The 64 bit
+ * algorithms leave high at zero, so hashes of different algorithms must not be compared.
+ */
+struct ImageHash {
+    enum Algorithm {
+        // Horizontal gradients of a 9x9 gray image
+        DifferenceHash64,
+        // Horizontal and vertical gradients, the vertical ones in high
+        DifferenceHash128,
+        // Signs of the 8x8 lowest frequencies of a 32x32 DCT against their median
+        DctHash,
+        // Means of 8x8 blocks of a 32x32 image against their median
+        BlockMeanHash
+    };
+
+    ImageHash() : low(0), high(0) {
+    }
+
+    static int distance(const ImageHash &hash, const ImageHash &otherHash) {
+        return int(qPopulationCount(hash.low ^ otherHash.low) + qPopulationCount(hash.high ^ otherHash.high));
+    }
+
+    quint64 low;
+    quint64 high;
+};
+
+Q_DECLARE_METATYPE(ImageHash)
+
+#endif // IMAGE_HASH_H
@@ -0,0 +1,207 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QSaveFile>
+#include <QStandardPaths>
+#include "ImageHashIndex.h"
+
+namespace {
+const quint32 IndexMagic = 0x50544849; // "PTHI"
+const quint32 IndexVersion = 2;
+
+// Superseded records tolerated before the log is rewritten
+const int CompactionSlack = 1000;
+
+void writeHeader(QDataStream &out) {
+    out << IndexMagic << IndexVersion;
+}
+
+void writeRecord(QDataStream &out, const QString &imageFullPath, qint64 size, qint64 modified, qint32 algorithm,
+                 const ImageHash &hash) {
+    out << imageFullPath << size << modified << algorithm << hash.low << hash.high;
+}
+}
+
+ImageHashIndex::ImageHashIndex() {
+    indexFilePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                    + QDir::separator() + "phototonic" + QDir::separator() + "hashes.idx";
+    recordsInFile = 0;
+    loaded = false;
+    hitCount = 0;
+    missCount = 0;
+}
+
+ImageHashIndex::~ImageHashIndex() {
+    sync();
+}
+
+void ImageHashIndex::load() {
+    loaded = true;
+
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 fileSize = file.size();
+    uchar *mapped = file.map(0, fileSize);
+    QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), (int) fileSize)
+                             : file.readAll();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion) {
+        if (mapped) {
+            file.unmap(mapped);
+        }
+        file.close();
+        file.remove();
+        return;
+    }
+
+    QString imageFullPath;
+    Entry entry;
+    while (!in.atEnd()) {
+        in >> imageFullPath >> entry.size >> entry.modified >> entry.algorithm >> entry.hash.low >> entry.hash.high;
+        if (in.status() != QDataStream::Ok) {
+            break;
+        }
+        ++recordsInFile;
+        entries.insert(imageFullPath, entry);
+    }
+    const bool truncated = in.status() != QDataStream::Ok;
+
+    // Every string read above is a deep copy, so the mapping can go now
+    if (mapped) {
+        file.unmap(mapped);
+    }
+    file.close();
+
+    // A partially written tail (crash during sync) would corrupt the records appended after it
+    if (truncated) {
+        qWarning() << "Image hash index is truncated, rewriting" << indexFilePath;
+        compact();
+    }
+}
+
+bool ImageHashIndex::lookup(const QFileInfo &fileInfo, ImageHash::Algorithm algorithm, ImageHash &hash) {
+    const QString imageFullPath = fileInfo.absoluteFilePath();
+    const qint64 size = fileInfo.size();
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        load();
+    }
+
+    QHash<QString, Entry>::const_iterator it = entries.constFind(imageFullPath);
+    if (it == entries.constEnd() || it->size != size || it->modified != modified || it->algorithm != algorithm) {
+        ++missCount;
+        return false;
+    }
+
+    hash = it->hash;
+    ++hitCount;
+    return true;
+}
+
+void ImageHashIndex::insert(const QFileInfo &fileInfo, ImageHash::Algorithm algorithm, const ImageHash &hash) {
+    Entry entry;
+    entry.size = fileInfo.size();
+    entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    entry.algorithm = algorithm;
+    entry.hash = hash;
+    const QString imageFullPath = fileInfo.absoluteFilePath();
+
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        load();
+    }
+
+    entries.insert(imageFullPath, entry);
+
+    QDataStream out(&pendingRecords, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_0);
+    writeRecord(out, imageFullPath, entry.size, entry.modified, entry.algorithm, entry.hash);
+    ++recordsInFile;
+}
+
+void ImageHashIndex::sync() {
+    QMutexLocker locker(&mutex);
+    if (pendingRecords.isEmpty()) {
+        return;
+    }
+
+    if (recordsInFile > 2 * entries.size() + CompactionSlack) {
+        compact();
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to write image hash index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    if (file.size() == 0) {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_0);
+        writeHeader(out);
+    }
+
+    file.write(pendingRecords);
+    pendingRecords.clear();
+}
+
+void ImageHashIndex::compact() {
+    QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+    QSaveFile file(indexFilePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write image hash index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    writeHeader(out);
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        writeRecord(out, it.key(), it->size, it->modified, it->algorithm, it->hash);
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write image hash index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    pendingRecords.clear();
+    recordsInFile = entries.size();
+}
+
+quint64 ImageHashIndex::hits() const {
+    QMutexLocker locker(&mutex);
+    return hitCount;
+}
+
+quint64 ImageHashIndex::misses() const {
+    QMutexLocker locker(&mutex);
+    return missCount;
+}
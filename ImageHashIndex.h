@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_HASH_INDEX_H
+#define IMAGE_HASH_INDEX_H
+
+#include <QtWidgets>
+#include "ImageHash.h"
+
+/*
+ * Persistent perceptual hashes of images, so duplicate searches only decode files that are new or
+ * changed since they were last hashed. Entries are keyed by path and are valid only while the file
+ * size and modification time match what was recorded. A path holds the hash of one algorithm,
+ * switching algorithms rehashes the files.
+ *
+ * Same log format as MetadataIndex: QDataStream records appended by sync(), the last record of a
+ * path wins and the log is rewritten when superseded records outnumber the live ones. Records of
+ * deleted files are kept, pruning them would mean a stat per indexed path. All members are thread
+ * safe.
+ */
+class ImageHashIndex {
+
+public:
+    ImageHashIndex();
+
+    ~ImageHashIndex();
+
+    bool lookup(const QFileInfo &fileInfo, ImageHash::Algorithm algorithm, ImageHash &hash);
+
+    void insert(const QFileInfo &fileInfo, ImageHash::Algorithm algorithm, const ImageHash &hash);
+
+    void sync();
+
+    quint64 hits() const;
+
+    quint64 misses() const;
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        qint32 algorithm;
+        ImageHash hash;
+    };
+
+    void load();
+
+    void compact();
+
+    mutable QMutex mutex;
+    QString indexFilePath;
+    QHash<QString, Entry> entries;
+    QByteArray pendingRecords;
+    int recordsInFile;
+    bool loaded;
+    quint64 hitCount;
+    quint64 missCount;
+};
+
+#endif // IMAGE_HASH_INDEX_H
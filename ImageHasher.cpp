@@ -0,0 +1,216 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <QtMath>
+#include "ImageHasher.h"
+
+namespace {
+// Decoding at this size keeps enough detail for the 9x9 and 32x32 hash images
+const int HashDecodeSize = 32;
+// Side of the image the DCT and block mean hashes are computed on
+const int HashImageSize = 32;
+// Bit i of the hash is set when values[i] is above the median of the 64 values
+quint64 medianHash(const float *values) {
+    float sortedValues[64];
+    std::copy(values, values + 64, sortedValues);
+    std::nth_element(sortedValues, sortedValues + 32, sortedValues + 64);
+    const float median = sortedValues[32];
+
+    quint64 hash = 0;
+    for (int i = 0; i < 64; ++i) {
+        if (values[i] > median) {
+            hash |= quint64(1) << i;
+        }
+    }
+    return hash;
+}
+
+quint64 differenceHash(const QImage &image, bool vertical) {
+    quint64 hash = 0;
+    for (int y = 0; y < 8; ++y) {
+        const uchar *line = image.scanLine(y);
+        const uchar *nextLine = image.scanLine(y + 1);
+        for (int x = 0; x < 8; ++x) {
+            if (vertical ? line[x] > nextLine[x] : line[x] > line[x + 1]) {
+                hash |= quint64(1) << (y * 8 + x);
+            }
+        }
+    }
+    return hash;
+}
+
+/*
+ * Only the 8x8 lowest frequencies are used, so the separable DCT computes 8 coefficients per row
+ * and per column instead of the full 32x32 transform. The DC term is replaced by its neighbour
+ * since it carries only the overall brightness.
+ */
+quint64 dctHash(const QImage &image) {
+    static const QVector<float> cosines = [] {
+        QVector<float> table(8 * HashImageSize);
+        for (int u = 0; u < 8; ++u) {
+            for (int x = 0; x < HashImageSize; ++x) {
+                table[u * HashImageSize + x] = float(qCos((2 * x + 1) * u * M_PI / (2 * HashImageSize)));
+            }
+        }
+        return table;
+    }();
+
+    float rowCoefficients[HashImageSize][8];
+    for (int y = 0; y < HashImageSize; ++y) {
+        const uchar *line = image.scanLine(y);
+        for (int u = 0; u < 8; ++u) {
+            const float *cosine = cosines.constData() + u * HashImageSize;
+            float sum = 0;
+            for (int x = 0; x < HashImageSize; ++x) {
+                sum += line[x] * cosine[x];
+            }
+            rowCoefficients[y][u] = sum;
+        }
+    }
+
+    float coefficients[64];
+    for (int v = 0; v < 8; ++v) {
+        const float *cosine = cosines.constData() + v * HashImageSize;
+        for (int u = 0; u < 8; ++u) {
+            float sum = 0;
+            for (int y = 0; y < HashImageSize; ++y) {
+                sum += rowCoefficients[y][u] * cosine[y];
+            }
+            coefficients[v * 8 + u] = sum;
+        }
+    }
+    coefficients[0] = coefficients[1];
+
+    return medianHash(coefficients);
+}
+
+quint64 blockMeanHash(const QImage &image) {
+    const int blockSize = HashImageSize / 8;
+    float blockSums[64] = {0};
+    for (int y = 0; y < HashImageSize; ++y) {
+        const uchar *line = image.scanLine(y);
+        for (int x = 0; x < HashImageSize; ++x) {
+            blockSums[(y / blockSize) * 8 + x / blockSize] += line[x];
+        }
+    }
+
+    // Sums of equally sized blocks order the same as their means
+    return medianHash(blockSums);
+}
+}
+
+ImageHasher::ImageHasher(QObject *parent, JobScheduler *jobScheduler) : QObject(parent) {
+    qRegisterMetaType<ImageHash>("ImageHash");
+    this->jobScheduler = jobScheduler;
+}
+
+bool ImageHasher::computeHash(const QString &imageFullPath, ImageHash::Algorithm algorithm, ImageHash &hash) {
+    QImageReader imageReader(imageFullPath);
+    QSize imageSize = imageReader.size();
+    if (imageSize.isValid() && (imageSize.width() > HashDecodeSize || imageSize.height() > HashDecodeSize)) {
+        imageReader.setScaledSize(imageSize.scaled(HashDecodeSize, HashDecodeSize, Qt::KeepAspectRatioByExpanding));
+    }
+
+    QImage image;
+    if (!imageReader.read(&image)) {
+        return false;
+    }
+
+    image = image.convertToFormat(QImage::Format_Grayscale8);
+    hash = ImageHash();
+    switch (algorithm) {
+        case ImageHash::DifferenceHash64:
+        case ImageHash::DifferenceHash128:
+            image = image.scaled(9, 9, Qt::KeepAspectRatioByExpanding);
+            hash.low = differenceHash(image, false);
+            if (algorithm == ImageHash::DifferenceHash128) {
+                hash.high = differenceHash(image, true);
+            }
+            break;
+        case ImageHash::DctHash:
+            hash.low = dctHash(image.scaled(HashImageSize, HashImageSize, Qt::IgnoreAspectRatio,
+                                            Qt::SmoothTransformation));
+            break;
+        case ImageHash::BlockMeanHash:
+            hash.low = blockMeanHash(image.scaled(HashImageSize, HashImageSize, Qt::IgnoreAspectRatio,
+                                                  Qt::SmoothTransformation));
+            break;
+    }
+
+    return true;
+}
+
+bool ImageHasher::hashImage(const QString &imageFullPath, ImageHash::Algorithm algorithm, ImageHash &hash) {
+    QFileInfo imageFileInfo(imageFullPath);
+    if (hashIndex.lookup(imageFileInfo, algorithm, hash)) {
+        return true;
+    }
+
+    if (!computeHash(imageFullPath, algorithm, hash)) {
+        return false;
+    }
+
+    hashIndex.insert(imageFileInfo, algorithm, hash);
+    return true;
+}
+
+bool ImageHasher::start(const QStringList &imageFullPaths, ImageHash::Algorithm algorithm) {
+    if (isRunning()) {
+        return false;
+    }
+
+    this->imageFullPaths = imageFullPaths;
+    hashes.fill(ImageHash(), imageFullPaths.size());
+    ImageHash *results = hashes.data();
+
+    Job *job = new Job(tr("Hash %n image(s) for duplicates", "", imageFullPaths.size()), imageFullPaths.size(),
+                       [this, imageFullPaths, algorithm, results](int item, QString &) {
+                           return hashImage(imageFullPaths.at(item), algorithm, results[item]);
+                       });
+    connect(job, SIGNAL(itemFinished(int, bool, QString)), this, SLOT(onImageProcessed(int, bool)));
+    connect(job, SIGNAL(finished(bool)), this, SLOT(onJobFinished(bool)));
+    hashJob = job;
+    jobScheduler->submit(job);
+    return true;
+}
+
+void ImageHasher::cancel() {
+    if (hashJob) {
+        hashJob->cancel();
+    }
+}
+
+bool ImageHasher::isRunning() const {
+    return hashJob && !hashJob->isDone();
+}
+
+void ImageHasher::onImageProcessed(int item, bool succeeded) {
+    // Items that finish after the job was canceled are not reported
+    if (succeeded) {
+        emit imageHashed(imageFullPaths.at(item), hashes.at(item));
+    } else {
+        emit hashFailed(imageFullPaths.at(item));
+    }
+}
+
+void ImageHasher::onJobFinished(bool canceled) {
+    hashJob = 0;
+    hashIndex.sync();
+    emit finished(canceled);
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_HASHER_H
+#define IMAGE_HASHER_H
+
+#include <QtWidgets>
+#include "ImageHashIndex.h"
+#include "JobScheduler.h"
+
+/*
+ * Computes perceptual hashes of images as a job of a JobScheduler, with the algorithm chosen per
+ * run. Images are decoded at a reduced size, which JPEG does through DCT scaling, and the
+ * scheduler only hands out as many images as it has threads, so cancel() returns quickly even for
+ * large libraries. Hashes are kept in an ImageHashIndex, so only new or changed files are decoded.
+ * Results are delivered as they come in, on the thread that owns the hasher.
+ */
+class ImageHasher : public QObject {
+Q_OBJECT
+
+public:
+    ImageHasher(QObject *parent, JobScheduler *jobScheduler);
+
+    // Returns false when a previous run is still going
+    bool start(const QStringList &imageFullPaths, ImageHash::Algorithm algorithm);
+
+    // Drops the images not started yet, finished() follows once the running ones are done
+    void cancel();
+
+    bool isRunning() const;
+
+    static bool computeHash(const QString &imageFullPath, ImageHash::Algorithm algorithm, ImageHash &hash);
+
+    // Hash from the index, or computed and added to it, thread safe
+    bool hashImage(const QString &imageFullPath, ImageHash::Algorithm algorithm, ImageHash &hash);
+
+signals:
+
+    void imageHashed(const QString &imageFullPath, const ImageHash &hash);
+
+    void hashFailed(const QString &imageFullPath);
+
+    void finished(bool canceled);
+
+private slots:
+
+    void onImageProcessed(int item, bool succeeded);
+
+    void onJobFinished(bool canceled);
+
+private:
+    ImageHashIndex hashIndex;
+    JobScheduler *jobScheduler;
+    QPointer<Job> hashJob;
+    QStringList imageFullPaths;
+    // One slot per image, written by the workers and only resized while no job runs
+    QVector<ImageHash> hashes;
+};
+
+#endif // IMAGE_HASHER_H
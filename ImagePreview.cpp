@@ -19,6 +19,7 @@
 #include "ImagePreview.h"
 #include "Settings.h"
 #include "ThumbsViewer.h"
+#include "ImageFileBuffer.h"
 
 ImagePreview::ImagePreview(QWidget *parent) : QWidget(parent) {
 
@@ -46,14 +47,15 @@ ImagePreview::ImagePreview(QWidget *parent) : QWidget(parent) {
 }
 
 QPixmap& ImagePreview::loadImage(QString imageFileName) {
-    QImageReader imageReader(imageFileName);
+    ImageFileBuffer imageFile(imageFileName);
+    QImageReader &imageReader = imageFile.reader();
     if (imageReader.size().isValid()) {
         QSize resize = imageReader.size();
         resize.scale(QSize(imageLabel->width(), imageLabel->height()), Qt::KeepAspectRatio);
         QImage previewImage;
         imageReader.read(&previewImage);
         if (Settings::exifRotationEnabled) {
-            imageViewer->rotateByExifRotation(previewImage, imageFileName);
+            imageViewer->rotateByExifRotation(previewImage, imageFile);
         }
         previewPixmap = QPixmap::fromImage(previewImage);
     } else {
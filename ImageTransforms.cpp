@@ -0,0 +1,224 @@
+/*
+ *  Copyright (C) 2013-2014 Ofer Kashayov - oferkv@live.com
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ImageTransforms.h"
+
+namespace {
+// Destination tile edge in pixels, small enough for a tile of source and destination
+// rows to stay in L1/L2 when the source is walked column-wise
+const int TileSize = 64;
+
+struct Pixel24 {
+    uchar bytes[3];
+};
+
+/*
+ * Every orientation maps destination pixel (x, y) to a source address of the form
+ * origin + x * stepX + y * stepY, so one blocked copy loop serves all eight of them.
+ */
+template<typename Pixel>
+void copyPixels(const uchar *origin, qptrdiff stepX, qptrdiff stepY, uchar *destination,
+                int destinationBytesPerLine, int width, int height) {
+    for (int tileY = 0; tileY < height; tileY += TileSize) {
+        int tileBottom = qMin(tileY + TileSize, height);
+        for (int tileX = 0; tileX < width; tileX += TileSize) {
+            int tileRight = qMin(tileX + TileSize, width);
+            for (int y = tileY; y < tileBottom; ++y) {
+                Pixel *destinationPixel = reinterpret_cast<Pixel *>(destination + y * destinationBytesPerLine) + tileX;
+                const uchar *sourcePixel = origin + tileX * stepX + y * stepY;
+                for (int x = tileX; x < tileRight; ++x) {
+                    *destinationPixel++ = *reinterpret_cast<const Pixel *>(sourcePixel);
+                    sourcePixel += stepX;
+                }
+            }
+        }
+    }
+}
+}
+
+namespace ImageTransforms {
+
+    bool isTransposing(int orientation) {
+        return orientation >= Transpose && orientation <= Rotate270;
+    }
+
+    QTransform orientationMatrix(int orientation) {
+        switch (orientation) {
+            case MirrorHorizontal:
+                return QTransform(-1, 0, 0, 1, 0, 0);
+            case Rotate180:
+                return QTransform(-1, 0, 0, -1, 0, 0);
+            case MirrorVertical:
+                return QTransform(1, 0, 0, -1, 0, 0);
+            case Transpose:
+                return QTransform(0, 1, 1, 0, 0, 0);
+            case Rotate90:
+                return QTransform(0, 1, -1, 0, 0, 0);
+            case Transverse:
+                return QTransform(0, -1, -1, 0, 0, 0);
+            case Rotate270:
+                return QTransform(0, -1, 1, 0, 0, 0);
+            default:
+                return QTransform();
+        }
+    }
+
+    int orientationFromMatrix(const QTransform &matrix) {
+        if (matrix.type() == QTransform::TxProject) {
+            return 0;
+        }
+
+        const qreal values[4] = {matrix.m11(), matrix.m12(), matrix.m21(), matrix.m22()};
+        int rounded[4];
+        for (int i = 0; i < 4; ++i) {
+            rounded[i] = qRound(values[i]);
+            if (qAbs(rounded[i]) > 1 || qAbs(values[i] - rounded[i]) > 1e-6) {
+                return 0;
+            }
+        }
+
+        for (int orientation = Normal; orientation <= Rotate270; ++orientation) {
+            QTransform candidate = orientationMatrix(orientation);
+            if (qRound(candidate.m11()) == rounded[0] && qRound(candidate.m12()) == rounded[1]
+                && qRound(candidate.m21()) == rounded[2] && qRound(candidate.m22()) == rounded[3]) {
+                return orientation;
+            }
+        }
+        return 0;
+    }
+
+    QImage orient(const QImage &image, int orientation, const QRect &sourceRect) {
+        QRect rect = sourceRect.isNull() ? image.rect() : sourceRect.intersected(image.rect());
+        if (image.isNull() || rect.isEmpty()) {
+            return QImage();
+        }
+        if (orientation < Normal || orientation > Rotate270) {
+            orientation = Normal;
+        }
+        if (orientation == Normal) {
+            return rect == image.rect() ? image : image.copy(rect);
+        }
+
+        const int bytesPerPixel = image.depth() / 8;
+        if (image.depth() % 8 || (bytesPerPixel > 4 && bytesPerPixel != 8)) {
+            // Packed sub-byte formats; an orthogonal matrix with fast transformation is still exact
+            return image.copy(rect).transformed(orientationMatrix(orientation), Qt::FastTransformation);
+        }
+
+        const bool transposing = isTransposing(orientation);
+        const int width = rect.width();
+        const int height = rect.height();
+        QImage result(transposing ? height : width, transposing ? width : height, image.format());
+        if (result.isNull()) {
+            return result;
+        }
+        result.setColorTable(image.colorTable());
+        result.setDotsPerMeterX(transposing ? image.dotsPerMeterY() : image.dotsPerMeterX());
+        result.setDotsPerMeterY(transposing ? image.dotsPerMeterX() : image.dotsPerMeterY());
+        result.setDevicePixelRatio(image.devicePixelRatio());
+
+        const qptrdiff bytesPerLine = image.bytesPerLine();
+        int originX = 0, originY = 0;
+        qptrdiff stepX = bytesPerPixel, stepY = bytesPerLine;
+        switch (orientation) {
+            case MirrorHorizontal:
+                originX = width - 1;
+                stepX = -bytesPerPixel;
+                stepY = bytesPerLine;
+                break;
+            case Rotate180:
+                originX = width - 1;
+                originY = height - 1;
+                stepX = -bytesPerPixel;
+                stepY = -bytesPerLine;
+                break;
+            case MirrorVertical:
+                originY = height - 1;
+                stepX = bytesPerPixel;
+                stepY = -bytesPerLine;
+                break;
+            case Transpose:
+                stepX = bytesPerLine;
+                stepY = bytesPerPixel;
+                break;
+            case Rotate90:
+                originY = height - 1;
+                stepX = -bytesPerLine;
+                stepY = bytesPerPixel;
+                break;
+            case Transverse:
+                originX = width - 1;
+                originY = height - 1;
+                stepX = -bytesPerLine;
+                stepY = -bytesPerPixel;
+                break;
+            case Rotate270:
+                originX = width - 1;
+                stepX = bytesPerLine;
+                stepY = -bytesPerPixel;
+                break;
+        }
+
+        const uchar *origin = image.constBits() + (rect.y() + originY) * bytesPerLine
+                              + (rect.x() + originX) * bytesPerPixel;
+        switch (bytesPerPixel) {
+            case 1:
+                copyPixels<quint8>(origin, stepX, stepY, result.bits(), result.bytesPerLine(),
+                                   result.width(), result.height());
+                break;
+            case 2:
+                copyPixels<quint16>(origin, stepX, stepY, result.bits(), result.bytesPerLine(),
+                                    result.width(), result.height());
+                break;
+            case 3:
+                copyPixels<Pixel24>(origin, stepX, stepY, result.bits(), result.bytesPerLine(),
+                                    result.width(), result.height());
+                break;
+            case 4:
+                copyPixels<quint32>(origin, stepX, stepY, result.bits(), result.bytesPerLine(),
+                                    result.width(), result.height());
+                break;
+            case 8:
+                copyPixels<quint64>(origin, stepX, stepY, result.bits(), result.bytesPerLine(),
+                                    result.width(), result.height());
+                break;
+        }
+
+        return result;
+    }
+
+    QImage rotate90(const QImage &image) {
+        return orient(image, Rotate90);
+    }
+
+    QImage rotate180(const QImage &image) {
+        return orient(image, Rotate180);
+    }
+
+    QImage rotate270(const QImage &image) {
+        return orient(image, Rotate270);
+    }
+
+    QImage transpose(const QImage &image) {
+        return orient(image, Transpose);
+    }
+
+    QImage transverse(const QImage &image) {
+        return orient(image, Transverse);
+    }
+}
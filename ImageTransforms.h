@@ -0,0 +1,65 @@
+/*
+ *  Copyright (C) 2013-2014 Ofer Kashayov - oferkv@live.com
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGE_TRANSFORMS_H
+#define IMAGE_TRANSFORMS_H
+
+#include <QImage>
+#include <QTransform>
+
+/*
+ * Exact, unfiltered orthogonal transforms. Every output pixel is a copy of
+ * exactly one input pixel, so these are lossless and much cheaper than
+ * QImage::transformed() with Qt::SmoothTransformation.
+ */
+namespace ImageTransforms {
+    // Values match the Exif orientation tag
+    typedef enum {
+        Normal = 1,
+        MirrorHorizontal,
+        Rotate180,
+        MirrorVertical,
+        Transpose,
+        Rotate90,
+        Transverse,
+        Rotate270
+    } Orientation;
+
+    QImage rotate90(const QImage &image);
+
+    QImage rotate180(const QImage &image);
+
+    QImage rotate270(const QImage &image);
+
+    QImage transpose(const QImage &image);
+
+    QImage transverse(const QImage &image);
+
+    // Applies the orientation to the sourceRect part of the image (the whole image if null)
+    QImage orient(const QImage &image, int orientation, const QRect &sourceRect = QRect());
+
+    bool isTransposing(int orientation);
+
+    // Linear (no translation) part of the orientation, in Qt's y-down coordinates
+    QTransform orientationMatrix(int orientation);
+
+    // Returns the orientation of an orthogonal matrix, 0 if the matrix is not orthogonal
+    int orientationFromMatrix(const QTransform &matrix);
+}
+
+#endif // IMAGE_TRANSFORMS_H
@@ -19,6 +19,10 @@
 #include "ImageViewer.h"
 #include "Phototonic.h"
 #include "MessageBox.h"
+#include "ImageTransforms.h"
+#include "LosslessJpeg.h"
+#include "ImageFileBuffer.h"
+#include "XmpSidecar.h"
 
 #define CLIPBOARD_IMAGE_NAME "clipboard.png"
 #define ROUND(x) ((int) ((x) + 0.5))
@@ -276,134 +280,202 @@ void ImageViewer::centerImage(QSize &imgSize) {
 }
 
 void ImageViewer::rotateByExifRotation(QImage &image, QString &imageFullPath) {
-    QTransform trans;
     long orientation = metadataCache->getImageOrientation(imageFullPath);
 
-    switch (orientation) {
-        case 1:
-            break;
-        case 2:
-            image = image.mirrored(true, false);
-            break;
-        case 3:
-            trans.rotate(180);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        case 4:
-            image = image.mirrored(false, true);
-            break;
-        case 5:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            image = image.mirrored(true, false);
-            break;
-        case 6:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        case 7:
-            trans.rotate(90);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            image = image.mirrored(false, true);
-            break;
-        case 8:
-            trans.rotate(270);
-            image = image.transformed(trans, Qt::SmoothTransformation);
-            break;
-        default:
-            break;
+    if (orientation > ImageTransforms::Normal && orientation <= ImageTransforms::Rotate270) {
+        image = ImageTransforms::orient(image, orientation);
     }
 }
 
-void ImageViewer::transform() {
-    if (Settings::exifRotationEnabled) {
-        rotateByExifRotation(viewerImage, viewerImageFullPath);
+void ImageViewer::rotateByExifRotation(QImage &image, const ImageFileBuffer &imageFile) {
+    QString imageFullPath = imageFile.fileName();
+    if (!metadataCache->contains(imageFullPath)) {
+        metadataCache->loadImageMetadata(imageFile);
     }
+    rotateByExifRotation(image, imageFullPath);
+}
+
+ImageEdits ImageEdits::current(int mirrorLayout) {
+    ImageEdits edits;
+    edits.exifRotationEnabled = Settings::exifRotationEnabled;
+    edits.rotation = Settings::rotation;
+    edits.flipH = Settings::flipH;
+    edits.flipV = Settings::flipV;
+    edits.cropLeft = Settings::cropLeft;
+    edits.cropTop = Settings::cropTop;
+    edits.cropWidth = Settings::cropWidth;
+    edits.cropHeight = Settings::cropHeight;
+    edits.cropLeftPercent = Settings::cropLeftPercent;
+    edits.cropTopPercent = Settings::cropTopPercent;
+    edits.cropWidthPercent = Settings::cropWidthPercent;
+    edits.cropHeightPercent = Settings::cropHeightPercent;
+    edits.applyColors = Settings::colorsActive || Settings::keepTransform;
+    edits.hueVal = Settings::hueVal;
+    edits.saturationVal = Settings::saturationVal;
+    edits.lightnessVal = Settings::lightnessVal;
+    edits.contrastVal = Settings::contrastVal;
+    edits.brightVal = Settings::brightVal;
+    edits.redVal = Settings::redVal;
+    edits.greenVal = Settings::greenVal;
+    edits.blueVal = Settings::blueVal;
+    edits.colorizeEnabled = Settings::colorizeEnabled;
+    edits.rNegateEnabled = Settings::rNegateEnabled;
+    edits.gNegateEnabled = Settings::gNegateEnabled;
+    edits.bNegateEnabled = Settings::bNegateEnabled;
+    edits.hueRedChannel = Settings::hueRedChannel;
+    edits.hueGreenChannel = Settings::hueGreenChannel;
+    edits.hueBlueChannel = Settings::hueBlueChannel;
+    edits.mirrorLayout = mirrorLayout;
+    edits.saveDirectory = Settings::saveDirectory;
+    edits.saveQuality = Settings::defaultSaveQuality;
+    return edits;
+}
+
+bool ImageEdits::colorsUnchanged() const {
+    return hueVal == 0 && saturationVal == 100 && lightnessVal == 100
+           && (contrastVal == 78 || contrastVal == 79) && brightVal == 100
+           && redVal == 0 && greenVal == 0 && blueVal == 0
+           && !colorizeEnabled && !rNegateEnabled && !gNegateEnabled && !bNegateEnabled;
+}
 
-    if (!qFuzzyCompare(Settings::rotation, 0)) {
+QTransform ImageViewer::transformMatrix(const QSize &imageSize, long exifOrientation, const ImageEdits &edits) {
+    const int width = imageSize.width();
+    const int height = imageSize.height();
+    QTransform matrix;
+
+    if (edits.exifRotationEnabled && exifOrientation > ImageTransforms::Normal
+        && exifOrientation <= ImageTransforms::Rotate270) {
+        matrix = ImageTransforms::orientationMatrix(exifOrientation);
+    }
+
+    if (!qFuzzyCompare(edits.rotation, 0)) {
         QTransform trans;
-        trans.rotate(Settings::rotation);
-        viewerImage = viewerImage.transformed(trans, Qt::SmoothTransformation);
+        trans.rotate(edits.rotation);
+        matrix *= trans;
+    }
+
+    // Move the transformed image back to the origin, like QImage::transformed() does
+    matrix = QImage::trueMatrix(matrix, width, height);
+
+    if (edits.flipH || edits.flipV) {
+        QSize transformedSize = matrix.mapRect(QRectF(0, 0, width, height)).toAlignedRect().size();
+        matrix *= QTransform(edits.flipH ? -1 : 1, 0, 0, edits.flipV ? -1 : 1,
+                             edits.flipH ? transformedSize.width() : 0,
+                             edits.flipV ? transformedSize.height() : 0);
     }
 
-    if (Settings::flipH || Settings::flipV) {
-        viewerImage = viewerImage.mirrored(Settings::flipH, Settings::flipV);
+    return matrix;
+}
+
+QRect ImageViewer::cropRect(const QSize &transformedSize, const ImageEdits &edits) {
+    int width = transformedSize.width();
+    int height = transformedSize.height();
+    int cropLeftPercentPixels = (width * edits.cropLeftPercent) / 100;
+    int cropTopPercentPixels = (height * edits.cropTopPercent) / 100;
+    int cropWidthPercentPixels = (width * edits.cropWidthPercent) / 100;
+    int cropHeightPercentPixels = (height * edits.cropHeightPercent) / 100;
+
+    QRect rect(edits.cropLeft + cropLeftPercentPixels,
+               edits.cropTop + cropTopPercentPixels,
+               width - edits.cropLeft - edits.cropWidth - cropLeftPercentPixels - cropWidthPercentPixels,
+               height - edits.cropTop - edits.cropHeight - cropTopPercentPixels - cropHeightPercentPixels);
+    return rect.intersected(QRect(QPoint(0, 0), transformedSize));
+}
+
+/*
+ * Exif orientation, rotation, flip and crop are combined into one matrix and applied in a
+ * single pass over the destination (crop) rectangle, so only the pixels that survive the
+ * crop are ever sampled.
+ */
+QImage ImageViewer::transformed(const QImage &image, long exifOrientation, const ImageEdits &edits) {
+    const QRectF sourceRect(QPointF(0, 0), image.size());
+    QTransform matrix = transformMatrix(image.size(), exifOrientation, edits);
+    QSize transformedSize = matrix.mapRect(sourceRect).toAlignedRect().size();
+    QRect destinationRect = cropRect(transformedSize, edits);
+
+    if (matrix.isIdentity() && destinationRect == image.rect()) {
+        return image;
     }
 
-    int cropLeftPercentPixels = 0, cropTopPercentPixels = 0, cropWidthPercentPixels = 0, cropHeightPercentPixels = 0;
-    bool croppingOn = false;
-    if (Settings::cropLeftPercent || Settings::cropTopPercent
-        || Settings::cropWidthPercent || Settings::cropHeightPercent) {
-        croppingOn = true;
-        cropLeftPercentPixels = (viewerImage.width() * Settings::cropLeftPercent) / 100;
-        cropTopPercentPixels = (viewerImage.height() * Settings::cropTopPercent) / 100;
-        cropWidthPercentPixels = (viewerImage.width() * Settings::cropWidthPercent) / 100;
-        cropHeightPercentPixels = (viewerImage.height() * Settings::cropHeightPercent) / 100;
+    if (destinationRect.isEmpty()) {
+        return QImage();
     }
 
-    if (Settings::cropLeft || Settings::cropTop || Settings::cropWidth || Settings::cropHeight) {
-        viewerImage = viewerImage.copy(
-                Settings::cropLeft + cropLeftPercentPixels,
-                Settings::cropTop + cropTopPercentPixels,
-                viewerImage.width() - Settings::cropLeft - Settings::cropWidth - cropLeftPercentPixels -
-                cropWidthPercentPixels,
-                viewerImage.height() - Settings::cropTop - Settings::cropHeight - cropTopPercentPixels -
-                cropHeightPercentPixels);
-    } else {
-        if (croppingOn) {
-            viewerImage = viewerImage.copy(
-                    cropLeftPercentPixels,
-                    cropTopPercentPixels,
-                    viewerImage.width() - cropLeftPercentPixels - cropWidthPercentPixels,
-                    viewerImage.height() - cropTopPercentPixels - cropHeightPercentPixels);
-        }
+    int orientation = ImageTransforms::orientationFromMatrix(matrix);
+    if (orientation) {
+        QRect sourceCropRect = matrix.inverted().mapRect(QRectF(destinationRect)).toRect();
+        return ImageTransforms::orient(image, orientation, sourceCropRect);
     }
+
+    QImage transformedImage(destinationRect.size(), QImage::Format_ARGB32_Premultiplied);
+    transformedImage.fill(Qt::transparent);
+    QPainter painter(&transformedImage);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.setTransform(matrix * QTransform::fromTranslate(-destinationRect.x(), -destinationRect.y()));
+    painter.drawImage(QPoint(0, 0), image);
+    painter.end();
+    return transformedImage;
 }
 
-void ImageViewer::mirror() {
+void ImageViewer::transform() {
+    long exifOrientation = metadataCache->getImageOrientation(viewerImageFullPath);
+    exifOrientationApplied = Settings::exifRotationEnabled && exifOrientation > ImageTransforms::Normal
+                             && exifOrientation <= ImageTransforms::Rotate270;
+    viewerImage = transformed(viewerImage, exifOrientation, ImageEdits::current(mirrorLayout));
+}
+
+static void mirrorTiles(int mirrorLayout, int &columns, int &rows) {
+    columns = rows = 1;
     switch (mirrorLayout) {
-        case LayDual: {
-            mirrorImage = QImage(viewerImage.width() * 2, viewerImage.height(),
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
+        case ImageViewer::LayDual:
+            columns = 2;
             break;
-        }
-
-        case LayTriple: {
-            mirrorImage = QImage(viewerImage.width() * 3, viewerImage.height(),
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
-            painter.drawImage(viewerImage.width() * 2, 0, viewerImage.mirrored(false, false));
+        case ImageViewer::LayTriple:
+            columns = 3;
             break;
-        }
-
-        case LayQuad: {
-            mirrorImage = QImage(viewerImage.width() * 2, viewerImage.height() * 2,
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(viewerImage.width(), 0, viewerImage.mirrored(true, false));
-            painter.drawImage(0, viewerImage.height(), viewerImage.mirrored(false, true));
-            painter.drawImage(viewerImage.width(), viewerImage.height(),
-                              viewerImage.mirrored(true, true));
+        case ImageViewer::LayQuad:
+            columns = rows = 2;
             break;
-        }
-
-        case LayVDual: {
-            mirrorImage = QImage(viewerImage.width(), viewerImage.height() * 2,
-                                 QImage::Format_ARGB32);
-            QPainter painter(&mirrorImage);
-            painter.drawImage(0, 0, viewerImage);
-            painter.drawImage(0, viewerImage.height(), viewerImage.mirrored(false, true));
+        case ImageViewer::LayVDual:
+            rows = 2;
             break;
+    }
+}
+
+void ImageViewer::mirror() {
+    int columns, rows;
+    mirrorTiles(mirrorLayout, columns, rows);
+    imageWidget->setMirrorTiles(columns, rows);
+}
+
+// Only used when the mirror layout leaves the viewer (saving, copying), the viewer itself paints it on the fly
+QImage ImageViewer::mirroredImage(const QImage &image, int mirrorLayout) {
+    if (!mirrorLayout || image.isNull()) {
+        return image;
+    }
+
+    int columns, rows;
+    mirrorTiles(mirrorLayout, columns, rows);
+    QImage composedImage(image.width() * columns, image.height() * rows, QImage::Format_ARGB32);
+    QPainter painter(&composedImage);
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            bool mirrorHorizontally = column % 2;
+            bool mirrorVertically = row % 2;
+            painter.save();
+            painter.translate((column + (mirrorHorizontally ? 1 : 0)) * image.width(),
+                              (row + (mirrorVertically ? 1 : 0)) * image.height());
+            painter.scale(mirrorHorizontally ? -1 : 1, mirrorVertically ? -1 : 1);
+            painter.drawImage(0, 0, image);
+            painter.restore();
         }
     }
+    return composedImage;
+}
 
-    viewerImage = mirrorImage;
+QImage ImageViewer::mirroredImage() {
+    return mirroredImage(viewerImage, mirrorLayout);
 }
 
 static inline int bound0To255(int val) {
@@ -504,23 +576,23 @@ void hslToRgb(double h, double s, double l,
     }
 }
 
-void ImageViewer::colorize() {
+void ImageViewer::colorize(QImage &image, const ImageEdits &edits) {
     int y, x;
     unsigned char hr, hg, hb;
     int r, g, b;
     QRgb *line;
     unsigned char h, s, l;
-    static unsigned char contrastTransform[256];
-    static unsigned char brightTransform[256];
-    bool hasAlpha = viewerImage.hasAlphaChannel();
+    unsigned char contrastTransform[256];
+    unsigned char brightTransform[256];
+    bool hasAlpha = image.hasAlphaChannel();
 
-    if (viewerImage.colorCount()) {
-        viewerImage = viewerImage.convertToFormat(QImage::Format_RGB32);
+    if (image.colorCount()) {
+        image = image.convertToFormat(QImage::Format_RGB32);
     }
 
     int i;
-    float contrast = ((float) Settings::contrastVal / 100.0);
-    float brightness = ((float) Settings::brightVal / 100.0);
+    float contrast = ((float) edits.contrastVal / 100.0);
+    float brightness = ((float) edits.brightVal / 100.0);
 
     for (i = 0; i < 256; ++i) {
         if (i < (int) (128.0f + 128.0f * tan(contrast)) && i > (int) (128.0f - 128.0f * tan(contrast))) {
@@ -536,17 +608,17 @@ void ImageViewer::colorize() {
         brightTransform[i] = MIN(255, (int) ((255.0 * pow(i / 255.0, 1.0 / brightness)) + 0.5));
     }
 
-    for (y = 0; y < viewerImage.height(); ++y) {
+    for (y = 0; y < image.height(); ++y) {
 
-        line = (QRgb *) viewerImage.scanLine(y);
-        for (x = 0; x < viewerImage.width(); ++x) {
-            r = Settings::rNegateEnabled ? bound0To255(255 - qRed(line[x])) : qRed(line[x]);
-            g = Settings::gNegateEnabled ? bound0To255(255 - qGreen(line[x])) : qGreen(line[x]);
-            b = Settings::bNegateEnabled ? bound0To255(255 - qBlue(line[x])) : qBlue(line[x]);
+        line = (QRgb *) image.scanLine(y);
+        for (x = 0; x < image.width(); ++x) {
+            r = edits.rNegateEnabled ? bound0To255(255 - qRed(line[x])) : qRed(line[x]);
+            g = edits.gNegateEnabled ? bound0To255(255 - qGreen(line[x])) : qGreen(line[x]);
+            b = edits.bNegateEnabled ? bound0To255(255 - qBlue(line[x])) : qBlue(line[x]);
 
-            r = bound0To255((r * (Settings::redVal + 100)) / 100);
-            g = bound0To255((g * (Settings::greenVal + 100)) / 100);
-            b = bound0To255((b * (Settings::blueVal + 100)) / 100);
+            r = bound0To255((r * (edits.redVal + 100)) / 100);
+            g = bound0To255((g * (edits.greenVal + 100)) / 100);
+            b = bound0To255((b * (edits.blueVal + 100)) / 100);
 
             r = bound0To255(brightTransform[r]);
             g = bound0To255(brightTransform[g]);
@@ -557,14 +629,14 @@ void ImageViewer::colorize() {
             b = bound0To255(contrastTransform[b]);
 
             rgbToHsl(r, g, b, &h, &s, &l);
-            h = Settings::colorizeEnabled ? Settings::hueVal : h + Settings::hueVal;
-            s = bound0To255(((s * Settings::saturationVal) / 100));
-            l = bound0To255(((l * Settings::lightnessVal) / 100));
+            h = edits.colorizeEnabled ? edits.hueVal : h + edits.hueVal;
+            s = bound0To255(((s * edits.saturationVal) / 100));
+            l = bound0To255(((l * edits.lightnessVal) / 100));
             hslToRgb(h, s, l, &hr, &hg, &hb);
 
-            r = Settings::hueRedChannel ? hr : qRed(line[x]);
-            g = Settings::hueGreenChannel ? hg : qGreen(line[x]);
-            b = Settings::hueBlueChannel ? hb : qBlue(line[x]);
+            r = edits.hueRedChannel ? hr : qRed(line[x]);
+            g = edits.hueGreenChannel ? hg : qGreen(line[x]);
+            b = edits.hueBlueChannel ? hb : qBlue(line[x]);
 
             if (hasAlpha) {
                 line[x] = qRgba(r, g, b, qAlpha(line[x]));
@@ -575,6 +647,10 @@ void ImageViewer::colorize() {
     }
 }
 
+void ImageViewer::colorize() {
+    colorize(viewerImage, ImageEdits::current(mirrorLayout));
+}
+
 void ImageViewer::refresh() {
     if (isAnimation) {
         return;
@@ -593,10 +669,7 @@ void ImageViewer::refresh() {
         colorize();
     }
 
-    if (mirrorLayout) {
-        mirror();
-    }
-
+    mirror();
     imageWidget->setImage(viewerImage);
     resizeImage();
 }
@@ -624,6 +697,7 @@ QImage createImageWithOverlay(const QImage &baseImage, const QImage &overlayImag
 
 void ImageViewer::reload() {
     isAnimation = false;
+    exifOrientationApplied = false;
     if (Settings::showImageName) {
         if (viewerImageFullPath.left(1) == ":") {
             setInfo("No Image");
@@ -640,25 +714,22 @@ void ImageViewer::reload() {
         Settings::flipH = Settings::flipV = false;
     }
     Settings::scaledWidth = Settings::scaledHeight = 0;
-    if (!batchMode) {
-        if (!Settings::keepTransform)
-            Settings::cropLeft = Settings::cropTop = Settings::cropWidth = Settings::cropHeight = 0;
-        if (newImage || viewerImageFullPath.isEmpty()) {
-            newImage = true;
-            viewerImageFullPath = CLIPBOARD_IMAGE_NAME;
-            origImage.load(":/images/no_image.png");
-            viewerImage = origImage;
-            imageWidget->setImage(viewerImage);
-            pasteImage();
-            return;
-        }
-    }
-
-    QImageReader imageReader(viewerImageFullPath);
-    if (batchMode && imageReader.supportsAnimation()) {
-        qWarning() << tr("skipping animation in batch mode:") << viewerImageFullPath;
+    if (!Settings::keepTransform)
+        Settings::cropLeft = Settings::cropTop = Settings::cropWidth = Settings::cropHeight = 0;
+    if (newImage || viewerImageFullPath.isEmpty()) {
+        newImage = true;
+        viewerImageFullPath = CLIPBOARD_IMAGE_NAME;
+        origImage.load(":/images/no_image.png");
+        viewerImage = origImage;
+        imageWidget->setMirrorTiles(1, 1);
+        imageWidget->setImage(viewerImage);
+        pasteImage();
         return;
     }
+
+    ImageFileBuffer imageFile(viewerImageFullPath);
+    QImageReader &imageReader = imageFile.reader();
+    viewerImageFormat = imageReader.format();
     if (Settings::enableAnimations && imageReader.supportsAnimation()) {
         if (animation) {
             delete animation;
@@ -689,16 +760,18 @@ void ImageViewer::reload() {
     }
 
     if (imageReader.size().isValid() && imageReader.read(&origImage)) {
+        if (!metadataCache->contains(viewerImageFullPath)) {
+            metadataCache->loadImageMetadata(imageFile);
+        }
         viewerImage = origImage;
         if (Settings::colorsActive || Settings::keepTransform) {
             colorize();
         }
-        if (mirrorLayout) {
-            mirror();
-        }
+        mirror();
     } else {
         viewerImage = QIcon::fromTheme("image-missing",
                                         QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE, BAD_IMAGE_SIZE).toImage();
+        imageWidget->setMirrorTiles(1, 1);
         setInfo(imageReader.errorString());
     }
 
@@ -757,6 +830,7 @@ void ImageViewer::loadImage(QString imageFileName) {
 void ImageViewer::clearImage() {
     origImage.load(":/images/no_image.png");
     viewerImage = origImage;
+    imageWidget->setMirrorTiles(1, 1);
     imageWidget->setImage(viewerImage);
 }
 
@@ -853,20 +927,11 @@ void ImageViewer::applyCropAndRotation() {
 
         bandTopLeft = imageWidget->mapToImage(imageWidget->mapFromGlobal(bandTopLeft));
         bandBottomRight = imageWidget->mapToImage(imageWidget->mapFromGlobal(bandBottomRight));
-        double scaledX = imageWidget->imageSize().width();
-        double scaledY = imageWidget->imageSize().height();
-        scaledX = viewerImage.width() / scaledX;
-        scaledY = viewerImage.height() / scaledY;
-
-        bandTopLeft.setX(int(bandTopLeft.x() * scaledX));
-        bandTopLeft.setY(int(bandTopLeft.y() * scaledY));
-        bandBottomRight.setX(int(bandBottomRight.x() * scaledX));
-        bandBottomRight.setY(int(bandBottomRight.y() * scaledY));
 
         Settings::cropLeft = bandTopLeft.x();
         Settings::cropTop = bandTopLeft.y();
-        Settings::cropWidth = viewerImage.width() - bandBottomRight.x();
-        Settings::cropHeight = viewerImage.height() - bandBottomRight.y();
+        Settings::cropWidth = imageWidget->imageSize().width() - bandBottomRight.x();
+        Settings::cropHeight = imageWidget->imageSize().height() - bandBottomRight.y();
         Settings::rotation = imageWidget->rotation();
 
         cropRubberBand->hide();
@@ -1007,61 +1072,244 @@ void ImageViewer::keyMoveEvent(int direction) {
     }
 }
 
-void ImageViewer::saveImage() {
-    Exiv2::Image::AutoPtr image;
-    bool exifError = false;
-    static bool showExifError = true;
+QString ImageViewer::saveFilePath(const QString &imageFullPath, const ImageEdits &edits) {
+    if (edits.saveDirectory.isEmpty()) {
+        return imageFullPath;
+    }
 
-    if (newImage) {
-        saveImageAs();
-        return;
+    QDir saveDir(edits.saveDirectory);
+    return saveDir.filePath(QFileInfo(imageFullPath).fileName());
+}
+
+/*
+ * Saves the rotation, flip and crop of the edits to a JPEG by rearranging its DCT coefficients instead
+ * of decoding and re-encoding it. Returns false when the edit can not be done that way (colors,
+ * mirroring, free rotation, crop not on the MCU grid, not a JPEG), the caller then re-encodes.
+ * Scaling is not part of the edits, callers that scale must not use this.
+ */
+bool ImageViewer::saveLosslessly(const QString &imageFullPath, const ImageEdits &edits, bool applyExifOrientation,
+                                 MetadataCache *metadataCache) {
+    if (edits.mirrorLayout != LayNone || !edits.colorsUnchanged()) {
+        return false;
     }
 
-    setFeedback(tr("Saving..."));
+    QFile sourceFile(imageFullPath);
+    if (!sourceFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QByteArray sourceData = sourceFile.readAll();
+    sourceFile.close();
+    if (!LosslessJpeg::isJpeg(sourceData)) {
+        return false;
+    }
 
+    QBuffer sourceBuffer(&sourceData);
+    QImageReader imageReader(&sourceBuffer);
+    QSize imageSize = imageReader.size();
+    if (!imageSize.isValid()) {
+        return false;
+    }
+
+    QString imagePath = imageFullPath;
+    long exifOrientation = applyExifOrientation ? metadataCache->getImageOrientation(imagePath) : 0;
+    if (exifOrientation <= ImageTransforms::Normal || exifOrientation > ImageTransforms::Rotate270) {
+        exifOrientation = ImageTransforms::Normal;
+    }
+    QTransform matrix = transformMatrix(imageSize, exifOrientation, edits);
+    QRect destinationRect = cropRect(matrix.mapRect(QRectF(QPointF(0, 0), imageSize)).toAlignedRect().size(), edits);
+    int orientation = ImageTransforms::orientationFromMatrix(matrix);
+    if (!orientation || destinationRect.isEmpty()) {
+        return false;
+    }
+    QRect sourceRect = matrix.inverted().mapRect(QRectF(destinationRect)).toRect();
+
+    QByteArray transformedData;
+    QString error;
+    LosslessJpeg::Result result = LosslessJpeg::transform(sourceData, orientation, sourceRect, transformedData, error);
+    if (result != LosslessJpeg::Success) {
+        if (result == LosslessJpeg::Error) {
+            qWarning() << tr("Lossless transformation failed:") << imageFullPath << error;
+        }
+        return false;
+    }
+
+    // Attach the metadata in memory so the file is only written once
     try {
-        image = Exiv2::ImageFactory::open(viewerImageFullPath.toStdString());
-        image->readMetadata();
+        Exiv2::Image::AutoPtr sourceImage = Exiv2::ImageFactory::open(
+                reinterpret_cast<const Exiv2::byte *>(sourceData.constData()), sourceData.size());
+        sourceImage->readMetadata();
+        Exiv2::Image::AutoPtr transformedImage = Exiv2::ImageFactory::open(
+                reinterpret_cast<const Exiv2::byte *>(transformedData.constData()), transformedData.size());
+        transformedImage->setMetadata(*sourceImage);
+        if (exifOrientation != ImageTransforms::Normal) {
+            transformedImage->exifData()["Exif.Image.Orientation"] = static_cast<uint16_t>(ImageTransforms::Normal);
+        }
+        if (orientation != ImageTransforms::Normal || sourceRect != QRect(QPoint(0, 0), imageSize)) {
+            Exiv2::ExifThumb thumb(transformedImage->exifData());
+            thumb.erase();
+        }
+        transformedImage->writeMetadata();
+
+        Exiv2::BasicIo &io = transformedImage->io();
+        io.seek(0, Exiv2::BasicIo::beg);
+        Exiv2::DataBuf buffer = io.read(io.size());
+        transformedData = QByteArray(reinterpret_cast<const char *>(buffer.pData_), int(buffer.size_));
     }
     catch (Exiv2::Error &error) {
-        exifError = true;
+        qWarning() << tr("Failed to copy Exif metadata:") << imageFullPath << error.what();
+        return false;
     }
 
-    QImageReader imageReader(viewerImageFullPath);
-    QString savePath = viewerImageFullPath;
-    if (!Settings::saveDirectory.isEmpty()) {
-        QDir saveDir(Settings::saveDirectory);
-        savePath = saveDir.filePath(QFileInfo(viewerImageFullPath).fileName());
+    QSaveFile saveFile(saveFilePath(imageFullPath, edits));
+    if (!saveFile.open(QIODevice::WriteOnly) || saveFile.write(transformedData) != transformedData.size()
+        || !saveFile.commit()) {
+        return false;
     }
-    if (!viewerImage.save(savePath, imageReader.format().toUpper(), Settings::defaultSaveQuality)) {
-        MessageBox msgBox(this);
-        msgBox.critical(tr("Error"), tr("Failed to save image."));
-        return;
+
+    if (exifOrientation != ImageTransforms::Normal && edits.saveDirectory.isEmpty()) {
+        QString error;
+        if (!XmpSidecar::resetOrientation(imageFullPath, error)) {
+            qWarning() << tr("Failed to reset the sidecar orientation:") << imageFullPath << error;
+        }
+        metadataCache->setImageOrientation(imagePath, ImageTransforms::Normal);
+    }
+    return true;
+}
+
+bool ImageViewer::saveImageFile(const QImage &image, const QString &imageFullPath, const QByteArray &format,
+                                const ImageEdits &edits, bool exifOrientationApplied, MetadataCache *metadataCache,
+                                QString &error, QString &metadataError) {
+    Exiv2::Image::AutoPtr exifImage;
+    bool exifError = false;
+
+    try {
+        exifImage = Exiv2::ImageFactory::open(imageFullPath.toStdString());
+        exifImage->readMetadata();
+    }
+    catch (Exiv2::Error &exiv2Error) {
+        exifError = true;
+    }
+
+    QString savePath = saveFilePath(imageFullPath, edits);
+    if (!mirroredImage(image, edits.mirrorLayout).save(savePath, format.toUpper(), edits.saveQuality)) {
+        error = tr("Failed to save image.");
+        return false;
     }
 
     if (!exifError) {
         try {
-            if (Settings::saveDirectory.isEmpty()) {
-                image->writeMetadata();
+            // The saved pixels are already upright
+            if (exifOrientationApplied) {
+                exifImage->exifData()["Exif.Image.Orientation"] = static_cast<uint16_t>(ImageTransforms::Normal);
+            }
+
+            if (edits.saveDirectory.isEmpty()) {
+                exifImage->writeMetadata();
+                if (exifOrientationApplied) {
+                    QString sidecarError;
+                    if (!XmpSidecar::resetOrientation(imageFullPath, sidecarError)) {
+                        qWarning() << tr("Failed to reset the sidecar orientation:") << imageFullPath << sidecarError;
+                    }
+                    metadataCache->setImageOrientation(imageFullPath, ImageTransforms::Normal);
+                }
             } else {
                 Exiv2::Image::AutoPtr imageOut = Exiv2::ImageFactory::open(savePath.toStdString());
-                imageOut->setMetadata(*image);
+                imageOut->setMetadata(*exifImage);
                 Exiv2::ExifThumb thumb(imageOut->exifData());
                 thumb.erase();
                 // TODO: thumb.setJpegThumbnail(thumbnailPath);
                 imageOut->writeMetadata();
             }
         }
-        catch (Exiv2::Error &error) {
-            if (showExifError) {
-                MessageBox msgBox(this);
-                QCheckBox cb(tr("Don't show this message again"));
-                msgBox.setCheckBox(&cb);
-                msgBox.critical(tr("Error"), tr("Failed to save Exif metadata."));
-                showExifError = !(cb.isChecked());
-            } else {
-                qWarning() << tr("Failed to safe Exif metadata:") << error.what();
-            }
+        catch (Exiv2::Error &exiv2Error) {
+            metadataError = QString::fromUtf8(exiv2Error.what());
+        }
+    }
+
+    return true;
+}
+
+bool ImageViewer::transformImageFile(const QString &imageFullPath, const ImageEdits &edits,
+                                     MetadataCache *metadataCache, QString &error) {
+    // JPEGs whose crop falls on the MCU grid do not need to be decoded at all
+    if (saveLosslessly(imageFullPath, edits, edits.exifRotationEnabled, metadataCache)) {
+        return true;
+    }
+
+    ImageFileBuffer imageFile(imageFullPath);
+    QImageReader &imageReader = imageFile.reader();
+    if (imageReader.supportsAnimation() && imageReader.imageCount() > 1) {
+        error = tr("Animations are not transformed.");
+        return false;
+    }
+
+    QImage image;
+    if (!imageReader.read(&image)) {
+        error = imageReader.errorString();
+        return false;
+    }
+    if (!metadataCache->contains(imageFullPath)) {
+        metadataCache->loadImageMetadata(imageFile);
+    }
+
+    long exifOrientation = metadataCache->getImageOrientation(imageFullPath);
+    bool exifOrientationApplied = edits.exifRotationEnabled && exifOrientation > ImageTransforms::Normal
+                                  && exifOrientation <= ImageTransforms::Rotate270;
+    image = transformed(image, exifOrientation, edits);
+    if (image.isNull()) {
+        error = tr("The crop leaves no pixels.");
+        return false;
+    }
+    if (edits.applyColors) {
+        colorize(image, edits);
+    }
+
+    QString metadataError;
+    if (!saveImageFile(image, imageFullPath, imageReader.format(), edits, exifOrientationApplied, metadataCache,
+                       error, metadataError)) {
+        return false;
+    }
+    if (!metadataError.isEmpty()) {
+        qWarning() << tr("Failed to safe Exif metadata:") << imageFullPath << metadataError;
+    }
+    return true;
+}
+
+void ImageViewer::saveImage() {
+    static bool showExifError = true;
+
+    if (newImage) {
+        saveImageAs();
+        return;
+    }
+
+    setFeedback(tr("Saving..."));
+
+    ImageEdits edits = ImageEdits::current(mirrorLayout);
+    if (!Settings::scaledWidth && saveLosslessly(viewerImageFullPath, edits, exifOrientationApplied, metadataCache)) {
+        reload();
+        setFeedback(tr("Image saved."));
+        return;
+    }
+
+    QString error;
+    QString metadataError;
+    if (!saveImageFile(viewerImage, viewerImageFullPath, viewerImageFormat, edits, exifOrientationApplied,
+                       metadataCache, error, metadataError)) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), error);
+        return;
+    }
+
+    if (!metadataError.isEmpty()) {
+        if (showExifError) {
+            MessageBox msgBox(this);
+            QCheckBox cb(tr("Don't show this message again"));
+            msgBox.setCheckBox(&cb);
+            msgBox.critical(tr("Error"), tr("Failed to save Exif metadata."));
+            showExifError = !(cb.isChecked());
+        } else {
+            qWarning() << tr("Failed to safe Exif metadata:") << metadataError;
         }
     }
 
@@ -1092,7 +1340,7 @@ void ImageViewer::saveImageAs() {
         }
 
 
-        if (!viewerImage.save(fileName, 0, Settings::defaultSaveQuality)) {
+        if (!mirroredImage().save(fileName, 0, Settings::defaultSaveQuality)) {
             MessageBox msgBox(this);
             msgBox.critical(tr("Error"), tr("Failed to save image."));
         } else {
@@ -1136,7 +1384,7 @@ bool ImageViewer::isNewImage() {
 }
 
 void ImageViewer::copyImage() {
-    QApplication::clipboard()->setImage(viewerImage);
+    QApplication::clipboard()->setImage(mirroredImage());
 }
 
 void ImageViewer::pasteImage() {
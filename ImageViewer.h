@@ -28,12 +28,50 @@
 
 class Phototonic;
 
+// The viewer edits in Settings, copied so batch jobs apply the same edits while the user keeps working
+struct ImageEdits {
+    bool exifRotationEnabled;
+    qreal rotation;
+    bool flipH;
+    bool flipV;
+    int cropLeft;
+    int cropTop;
+    int cropWidth;
+    int cropHeight;
+    int cropLeftPercent;
+    int cropTopPercent;
+    int cropWidthPercent;
+    int cropHeightPercent;
+    bool applyColors;
+    int hueVal;
+    int saturationVal;
+    int lightnessVal;
+    int contrastVal;
+    int brightVal;
+    int redVal;
+    int greenVal;
+    int blueVal;
+    bool colorizeEnabled;
+    bool rNegateEnabled;
+    bool gNegateEnabled;
+    bool bNegateEnabled;
+    bool hueRedChannel;
+    bool hueGreenChannel;
+    bool hueBlueChannel;
+    int mirrorLayout;
+    QString saveDirectory;
+    int saveQuality;
+
+    static ImageEdits current(int mirrorLayout);
+
+    bool colorsUnchanged() const;
+};
+
 class ImageViewer : public QWidget {
 Q_OBJECT
 
 public:
     bool tempDisableResize;
-    bool batchMode = false;
     int mirrorLayout;
     QString viewerImageFullPath;
     QMenu *ImagePopUpMenu;
@@ -88,6 +126,16 @@ public:
 
     void rotateByExifRotation(QImage &image, QString &imageFullPath);
 
+    // Takes the orientation of an image that is not cached yet from the bytes read to decode it
+    void rotateByExifRotation(QImage &image, const ImageFileBuffer &imageFile);
+
+    static bool saveLosslessly(const QString &imageFullPath, const ImageEdits &edits, bool applyExifOrientation,
+                               MetadataCache *metadataCache);
+
+    // Applies the edits to an image file and saves it, safe to call from job workers
+    static bool transformImageFile(const QString &imageFullPath, const ImageEdits &edits,
+                                   MetadataCache *metadataCache, QString &error);
+
     void setInfo(QString infoString);
 
     void setFeedback(QString feedbackString, bool timeLimited = true);
@@ -137,7 +185,6 @@ private:
     ImageWidget *imageWidget = nullptr;
     QImage origImage;
     QImage viewerImage;
-    QImage mirrorImage;
     QTimer *mouseMovementTimer;
     QMovie *animation;
     bool newImage;
@@ -149,6 +196,9 @@ private:
     int layoutX;
     int layoutY;
     bool isAnimation;
+    bool exifOrientationApplied = false;
+    // Format of the loaded file, so saving in place does not open it again to detect it
+    QByteArray viewerImageFormat;
     QLabel *feedbackLabel;
     QPoint cropOrigin;
     QPoint contextMenuPosition;
@@ -158,10 +208,30 @@ private:
 
     void centerImage(QSize &imgSize);
 
+    static QString saveFilePath(const QString &imageFullPath, const ImageEdits &edits);
+
+    static QTransform transformMatrix(const QSize &imageSize, long exifOrientation, const ImageEdits &edits);
+
+    static QRect cropRect(const QSize &transformedSize, const ImageEdits &edits);
+
+    static QImage transformed(const QImage &image, long exifOrientation, const ImageEdits &edits);
+
+    // Writes the pixels, then the metadata of the original file. Returns false only if the pixels were not saved,
+    // metadataError tells whether the metadata was lost.
+    static bool saveImageFile(const QImage &image, const QString &imageFullPath, const QByteArray &format,
+                              const ImageEdits &edits, bool exifOrientationApplied, MetadataCache *metadataCache,
+                              QString &error, QString &metadataError);
+
     void transform();
 
     void mirror();
 
+    static QImage mirroredImage(const QImage &image, int mirrorLayout);
+
+    QImage mirroredImage();
+
+    static void colorize(QImage &image, const ImageEdits &edits);
+
     void colorize();
 };
 
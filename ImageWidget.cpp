@@ -47,30 +47,39 @@ void ImageWidget::setRotation(qreal r)
     update();
 }
 
+void ImageWidget::setMirrorTiles(int columns, int rows)
+{
+    m_mirrorColumns = qMax(1, columns);
+    m_mirrorRows = qMax(1, rows);
+    update();
+}
+
 QPoint ImageWidget::mapToImage(QPoint p)
 {
+    QSize size = imageSize();
     QPoint upperLeft;
     QPoint center(width() / 2, height() / 2);
-    if (width() > m_image.width())
-        upperLeft.setX(center.x() - m_image.width() / 2);
-    if (height() > m_image.height())
-        upperLeft.setY(center.y() - m_image.height() / 2);
+    if (width() > size.width())
+        upperLeft.setX(center.x() - size.width() / 2);
+    if (height() > size.height())
+        upperLeft.setY(center.y() - size.height() / 2);
     return QPoint(p.x() - upperLeft.x(), p.y() - upperLeft.y());
 }
 
 QSize ImageWidget::imageSize() const
 {
-    return m_image.size();
+    return QSize(m_image.width() * m_mirrorColumns, m_image.height() * m_mirrorRows);
 }
 
 QSize ImageWidget::sizeHint() const
 {
-    return m_image.size();
+    return imageSize();
 }
 
 void ImageWidget::paintEvent(QPaintEvent *)
 {
-    float scale = qMax(float(width()) / m_image.width(), float(height()) / m_image.height());
+    QSize size = imageSize();
+    float scale = qMax(float(width()) / size.width(), float(height()) / size.height());
 
     QPainter painter(this);
     painter.scale(scale, scale);
@@ -80,9 +89,27 @@ void ImageWidget::paintEvent(QPaintEvent *)
     painter.rotate(m_rotation);
     painter.translate(center * -1);
     QPoint upperLeft;
-    if (width() > m_image.width() * scale)
-        upperLeft.setX(center.x() - scale*m_image.width() / 2);
-    if (height() > m_image.height() * scale)
-        upperLeft.setY(center.y() - scale*m_image.height() / 2);
-    painter.drawImage(upperLeft, m_image);
+    if (width() > size.width() * scale)
+        upperLeft.setX(center.x() - scale*size.width() / 2);
+    if (height() > size.height() * scale)
+        upperLeft.setY(center.y() - scale*size.height() / 2);
+
+    if (m_mirrorColumns == 1 && m_mirrorRows == 1) {
+        painter.drawImage(upperLeft, m_image);
+        return;
+    }
+
+    // Mirror layouts are composed here, the mirrored copies are never stored
+    for (int row = 0; row < m_mirrorRows; ++row) {
+        for (int column = 0; column < m_mirrorColumns; ++column) {
+            bool mirrorHorizontally = column % 2;
+            bool mirrorVertically = row % 2;
+            painter.save();
+            painter.translate(upperLeft.x() + (column + (mirrorHorizontally ? 1 : 0)) * m_image.width(),
+                              upperLeft.y() + (row + (mirrorVertically ? 1 : 0)) * m_image.height());
+            painter.scale(mirrorHorizontally ? -1 : 1, mirrorVertically ? -1 : 1);
+            painter.drawImage(0, 0, m_image);
+            painter.restore();
+        }
+    }
 }
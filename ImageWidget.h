@@ -31,6 +31,8 @@ public:
     void setImage(const QImage &i);
     qreal rotation() { return m_rotation; }
     void setRotation(qreal r);
+    // Tiles the image, mirroring odd columns horizontally and odd rows vertically
+    void setMirrorTiles(int columns, int rows);
     QPoint mapToImage(QPoint p);
     QSize imageSize() const;
 
@@ -43,6 +45,8 @@ protected:
 private:
     QImage m_image;
     qreal m_rotation = 0;
+    int m_mirrorColumns = 1;
+    int m_mirrorRows = 1;
 };
 
 #endif // IMAGEWIDGET_H
@@ -19,6 +19,79 @@
 #include "InfoViewer.h"
 #include "ThumbsViewer.h"
 
+class InfoModel : public QAbstractTableModel {
+
+public:
+    explicit InfoModel(QObject *parent) : QAbstractTableModel(parent) {
+    }
+
+    void setEntries(const InfoEntryList &entries) {
+        beginResetModel();
+        this->entries = entries;
+        endResetModel();
+    }
+
+    const InfoEntry &entry(int row) const {
+        return entries.at(row);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : entries.size();
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        return parent.isValid() ? 0 : 2;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if (!index.isValid() || index.row() >= entries.size()) {
+            return QVariant();
+        }
+
+        const InfoEntry &infoEntry = entries.at(index.row());
+        switch (role) {
+            case Qt::DisplayRole:
+                if (index.column() == 0) {
+                    return infoEntry.key;
+                }
+                return infoEntry.isTitle ? QVariant() : QVariant(infoEntry.value);
+            case Qt::ToolTipRole:
+                return index.column() == 1 && !infoEntry.isTitle ? QVariant(infoEntry.value) : QVariant();
+            case Qt::FontRole:
+                if (infoEntry.isTitle && index.column() == 0) {
+                    QFont boldFont;
+                    boldFont.setBold(true);
+                    return boldFont;
+                }
+                return QVariant();
+            default:
+                return QVariant();
+        }
+    }
+
+private:
+    InfoEntryList entries;
+};
+
+// Matches keys only and keeps the section titles
+class InfoFilterModel : public QSortFilterProxyModel {
+
+public:
+    explicit InfoFilterModel(QObject *parent) : QSortFilterProxyModel(parent) {
+        setFilterCaseSensitivity(Qt::CaseInsensitive);
+        setFilterKeyColumn(0);
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override {
+        const InfoModel *infoModel = static_cast<const InfoModel *>(sourceModel());
+        if (infoModel->entry(sourceRow).isTitle) {
+            return true;
+        }
+        return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+    }
+};
+
 InfoView::InfoView(QWidget *parent) : QWidget(parent) {
 
     infoViewerTable = new QTableView();
@@ -32,9 +105,10 @@ InfoView::InfoView(QWidget *parent) : QWidget(parent) {
     infoViewerTable->setTabKeyNavigation(false);
     infoViewerTable->setShowGrid(false);
 
-    imageInfoModel = new QStandardItemModel(this);
-    infoViewerTable->setModel(imageInfoModel);
-
+    imageInfoModel = new InfoModel(this);
+    filterModel = new InfoFilterModel(this);
+    filterModel->setSourceModel(imageInfoModel);
+    infoViewerTable->setModel(filterModel);
     // Menu
     QAction *copyAction = new QAction(tr("Copy"), this);
     infoViewerTable->connect(copyAction, SIGNAL(triggered()), this, SLOT(copyEntry()));
@@ -68,32 +142,26 @@ void InfoView::showInfoViewMenu(QPoint pt) {
 }
 
 void InfoView::clear() {
-    imageInfoModel->clear();
+    imageInfoModel->setEntries(InfoEntryList());
 }
 
-void InfoView::addEntry(QString &key, QString &value) {
-    if (!filterLineEdit->text().isEmpty() && !key.toLower().contains(filterLineEdit->text().toLower())) {
-        return;
-    }
-
-    int atRow = imageInfoModel->rowCount();
-    QStandardItem *itemKey = new QStandardItem(key);
-    imageInfoModel->insertRow(atRow, itemKey);
-    if (!value.isEmpty()) {
-        QStandardItem *itemVal = new QStandardItem(value);
-        itemVal->setToolTip(value);
-        imageInfoModel->setItem(atRow, 1, itemVal);
-    }
+void InfoView::setEntries(const InfoEntryList &entries) {
+    imageInfoModel->setEntries(entries);
 }
 
-void InfoView::addTitleEntry(QString title) {
-    int atRow = imageInfoModel->rowCount();
-    QStandardItem *itemKey = new QStandardItem(title);
-    imageInfoModel->insertRow(atRow, itemKey);
+void InfoView::addEntry(InfoEntryList &entries, const QString &key, const QString &value) {
+    InfoEntry infoEntry;
+    infoEntry.key = key;
+    infoEntry.value = value;
+    infoEntry.isTitle = false;
+    entries.append(infoEntry);
+}
 
-    QFont boldFont;
-    boldFont.setBold(true);
-    itemKey->setData(boldFont, Qt::FontRole);
+void InfoView::addTitleEntry(InfoEntryList &entries, const QString &title) {
+    InfoEntry infoEntry;
+    infoEntry.key = title;
+    infoEntry.isTitle = true;
+    entries.append(infoEntry);
 }
 
 void InfoView::showEvent(QShowEvent *event)
@@ -105,10 +173,10 @@ void InfoView::showEvent(QShowEvent *event)
 
 void InfoView::copyEntry() {
     if (selectedEntry.isValid()) {
-        QApplication::clipboard()->setText(imageInfoModel->itemFromIndex(selectedEntry)->toolTip());
+        QApplication::clipboard()->setText(selectedEntry.data(Qt::ToolTipRole).toString());
     }
 }
 
 void InfoView::filterItems() {
-    emit updateInfo();
+    filterModel->setFilterFixedString(filterLineEdit->text());
 }
@@ -21,6 +21,22 @@
 
 #include <QtWidgets>
 
+struct InfoEntry {
+    QString key;
+    QString value;
+    bool isTitle;
+};
+
+typedef QVector<InfoEntry> InfoEntryList;
+
+class InfoModel;
+
+class InfoFilterModel;
+
+/*
+ * Shows key/value entries through a model that hands the table only the rows it paints, the
+ * filter box filters them in memory without asking for the entries again.
+ */
 class InfoView : public QWidget {
 Q_OBJECT
 
@@ -29,9 +45,11 @@ public:
 
     void clear();
 
-    void addEntry(QString &key, QString &value);
+    void setEntries(const InfoEntryList &entries);
+
+    static void addEntry(InfoEntryList &entries, const QString &key, const QString &value);
 
-    void addTitleEntry(QString title);
+    static void addTitleEntry(InfoEntryList &entries, const QString &title);
 
 
 signals:
@@ -53,7 +71,8 @@ private slots:
 
 private:
     QTableView *infoViewerTable;
-    QStandardItemModel *imageInfoModel;
+    InfoModel *imageInfoModel;
+    InfoFilterModel *filterModel;
     QModelIndex selectedEntry;
     QMenu *infoMenu;
     QLineEdit *filterLineEdit;
@@ -0,0 +1,39 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ItemModelRows.h"
+
+int ItemModelRows::removeRows(QStandardItemModel *model, int role, const QSet<QString> &values) {
+    int firstRemovedRow = -1;
+    int row = model->rowCount() - 1;
+    while (row >= 0) {
+        if (!values.contains(model->item(row)->data(role).toString())) {
+            --row;
+            continue;
+        }
+
+        int lastRow = row;
+        while (row > 0 && values.contains(model->item(row - 1)->data(role).toString())) {
+            --row;
+        }
+        model->removeRows(row, lastRow - row + 1);
+        firstRemovedRow = row;
+        --row;
+    }
+    return firstRemovedRow;
+}
@@ -0,0 +1,34 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ITEM_MODEL_ROWS_H
+#define ITEM_MODEL_ROWS_H
+
+#include <QSet>
+#include <QStandardItemModel>
+
+namespace ItemModelRows {
+    /*
+     * Removes the rows whose role data is one of the values, adjacent rows in one call so removing
+     * a block does not shift the rows after it one row at a time. Returns the first removed row or
+     * -1 when none matched.
+     */
+    int removeRows(QStandardItemModel *model, int role, const QSet<QString> &values);
+}
+
+#endif // ITEM_MODEL_ROWS_H
@@ -0,0 +1,321 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <climits>
+#include "JobScheduler.h"
+
+namespace {
+class ItemTask : public QRunnable {
+public:
+    ItemTask(Job *job, int item, const Job::WorkFunction &work) : job(job), item(item), work(work) {
+    }
+
+    void run() {
+        QString error;
+        bool succeeded = !job->isCanceled() && work(item, error);
+        QMetaObject::invokeMethod(job, "onItemProcessed", Qt::QueuedConnection,
+                                  Q_ARG(int, item), Q_ARG(bool, succeeded), Q_ARG(QString, error));
+    }
+
+private:
+    // Jobs are only deleted once their items are done
+    Job *job;
+    int item;
+    Job::WorkFunction work;
+};
+}
+
+Job::Job(const QString &title, int itemCount, const WorkFunction &work, Priority priority)
+        : jobTitle(title), work(work) {
+    scheduler = 0;
+    jobPriority = priority;
+    jobState = Waiting;
+    progressReporter = new ProgressReporter(this);
+    items = itemCount;
+    nextItem = 0;
+    runningItems = 0;
+    doneItems = 0;
+    failedCount = 0;
+    maxParallel = INT_MAX;
+}
+
+QString Job::title() const {
+    return jobTitle;
+}
+
+Job::Priority Job::priority() const {
+    return jobPriority;
+}
+
+Job::State Job::state() const {
+    return jobState;
+}
+
+bool Job::isDone() const {
+    return jobState == Finished || jobState == Canceled;
+}
+
+int Job::itemCount() const {
+    return items;
+}
+
+int Job::failedItems() const {
+    return failedCount;
+}
+
+ProgressReporter *Job::progress() const {
+    return progressReporter;
+}
+
+void Job::setMaxParallelItems(int maxParallelItems) {
+    maxParallel = qMax(1, maxParallelItems);
+}
+
+void Job::addDependency(Job *job) {
+    dependencies.append(job);
+}
+
+void Job::cancel() {
+    if (isDone() || isCanceled()) {
+        return;
+    }
+
+    canceled.store(1);
+    finishIfDone();
+    if (scheduler) {
+        scheduler->dispatch();
+    }
+}
+
+bool Job::isCanceled() const {
+    return canceled.load() != 0;
+}
+
+void Job::setState(State newState) {
+    if (jobState == Waiting || jobState == Queued) {
+        if (newState == Running) {
+            progressReporter->start(items);
+        }
+    }
+
+    jobState = newState;
+    emit stateChanged();
+}
+
+void Job::finishIfDone() {
+    if (isDone() || runningItems > 0 || (nextItem < items && !isCanceled())) {
+        return;
+    }
+
+    progressReporter->stop();
+    setState(isCanceled() ? Canceled : Finished);
+    emit finished(isCanceled());
+
+    // Releases what the work function captured, the job itself may stay listed for a while
+    work = WorkFunction();
+    if (scheduler) {
+        scheduler->schedulePrune();
+    }
+}
+
+void Job::onItemProcessed(int item, bool succeeded, const QString &error) {
+    --runningItems;
+    --scheduler->runningTasks;
+
+    if (!isCanceled()) {
+        ++doneItems;
+        if (!succeeded) {
+            ++failedCount;
+        }
+        progressReporter->setProgress(doneItems);
+        emit itemFinished(item, succeeded, error);
+    }
+
+    finishIfDone();
+    scheduler->dispatch();
+}
+
+JobScheduler::JobScheduler(QObject *parent) : QObject(parent) {
+    threadPool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+    runningTasks = 0;
+    dispatching = false;
+    dispatchAgain = false;
+    pruneScheduled = false;
+}
+
+JobScheduler::~JobScheduler() {
+    waitForDone();
+}
+
+void JobScheduler::submit(Job *job) {
+    job->setParent(this);
+    job->scheduler = this;
+    jobList.append(job);
+    emit jobAdded(job);
+    dispatch();
+}
+
+QList<Job *> JobScheduler::jobs() const {
+    return jobList;
+}
+
+bool JobScheduler::hasActiveJobs() const {
+    foreach (Job *job, jobList) {
+        if (!job->isDone()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::removeDoneJobs() {
+    QList<Job *> removedJobs;
+    for (int i = jobList.size() - 1; i >= 0; --i) {
+        if (jobList.at(i)->isDone()) {
+            removedJobs.prepend(jobList.takeAt(i));
+        }
+    }
+
+    deleteJobs(removedJobs);
+}
+
+void JobScheduler::schedulePrune() {
+    if (!pruneScheduled) {
+        pruneScheduled = true;
+        QMetaObject::invokeMethod(this, "pruneDoneJobs", Qt::QueuedConnection);
+    }
+}
+
+void JobScheduler::pruneDoneJobs() {
+    pruneScheduled = false;
+
+    QList<Job *> removedJobs;
+    int doneJobs = 0;
+    for (int i = jobList.size() - 1; i >= 0; --i) {
+        if (jobList.at(i)->isDone() && ++doneJobs > KeptDoneJobs) {
+            removedJobs.prepend(jobList.takeAt(i));
+        }
+    }
+
+    deleteJobs(removedJobs);
+}
+
+void JobScheduler::deleteJobs(const QList<Job *> &removedJobs) {
+    if (!removedJobs.isEmpty()) {
+        emit jobsRemoved(removedJobs);
+        qDeleteAll(removedJobs);
+    }
+}
+
+void JobScheduler::cancelAll() {
+    foreach (Job *job, jobList) {
+        job->cancel();
+    }
+}
+
+void JobScheduler::waitForDone() {
+    cancelAll();
+    while (runningTasks > 0) {
+        threadPool.waitForDone();
+
+        // Delivers the queued item completions
+        foreach (Job *job, jobList) {
+            QCoreApplication::sendPostedEvents(job, QEvent::MetaCall);
+        }
+
+        // Also cancels jobs that were submitted by the completion handlers
+        cancelAll();
+    }
+}
+
+void JobScheduler::dispatch() {
+    // Finishing or canceling a job from here dispatches again, which is done by the outer loop
+    if (dispatching) {
+        dispatchAgain = true;
+        return;
+    }
+
+    dispatching = true;
+    do {
+        dispatchAgain = false;
+
+        for (int i = 0; i < jobList.size(); ++i) {
+            Job *job = jobList.at(i);
+            if (job->state() != Job::Waiting || job->isCanceled()) {
+                continue;
+            }
+
+            bool dependenciesDone = true;
+            bool dependencyCanceled = false;
+            foreach (const QPointer<Job> &dependency, job->dependencies) {
+                if (dependency && !dependency->isDone()) {
+                    dependenciesDone = false;
+                } else if (dependency && dependency->state() == Job::Canceled) {
+                    dependencyCanceled = true;
+                }
+            }
+
+            if (dependencyCanceled) {
+                job->cancel();
+            } else if (dependenciesDone) {
+                job->setState(Job::Queued);
+                job->finishIfDone();
+            }
+        }
+
+        while (runningTasks < threadPool.maxThreadCount()) {
+            Job *nextJob = 0;
+            foreach (Job *job, jobList) {
+                if ((job->state() == Job::Queued || job->state() == Job::Running) && !job->isCanceled()
+                    && job->nextItem < job->items && job->runningItems < job->maxParallel
+                    && (!nextJob || job->priority() > nextJob->priority())) {
+                    nextJob = job;
+                }
+            }
+            if (!nextJob) {
+                break;
+            }
+
+            if (nextJob->state() == Job::Queued) {
+                nextJob->setState(Job::Running);
+            }
+            ++nextJob->runningItems;
+            ++runningTasks;
+            threadPool.start(new ItemTask(nextJob, nextJob->nextItem++, nextJob->work));
+        }
+    } while (dispatchAgain);
+    dispatching = false;
+}
+
+QMutex FileLock::mutex;
+QWaitCondition FileLock::released;
+QSet<QString> FileLock::lockedPaths;
+
+FileLock::FileLock(const QString &fileFullPath) : lockedPath(fileFullPath) {
+    QMutexLocker locker(&mutex);
+    while (lockedPaths.contains(lockedPath)) {
+        released.wait(&mutex);
+    }
+    lockedPaths.insert(lockedPath);
+}
+
+FileLock::~FileLock() {
+    QMutexLocker locker(&mutex);
+    lockedPaths.remove(lockedPath);
+    released.wakeAll();
+}
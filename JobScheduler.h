@@ -0,0 +1,204 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+#include <QtWidgets>
+#include <functional>
+#include "ProgressReporter.h"
+
+class JobScheduler;
+
+/*
+ * A long operation split into independent items that a JobScheduler processes on its worker
+ * threads, up to maxParallelItems of them at once. The work function runs on a worker thread and
+ * must only touch thread safe state, the signals are emitted on the GUI thread as items complete.
+ * Cancellation is cooperative: items not started yet are dropped, a running work function may poll
+ * isCanceled() to stop early, and the results of items that finish after cancel() are discarded.
+ */
+class Job : public QObject {
+Q_OBJECT
+
+public:
+    enum Priority {
+        LowPriority,
+        NormalPriority,
+        HighPriority
+    };
+    enum State {
+        // For the jobs it depends on
+        Waiting,
+        Queued,
+        Running,
+        Finished,
+        Canceled
+    };
+
+    // Processes one item, returns false and sets error when it failed
+    typedef std::function<bool(int item, QString &error)> WorkFunction;
+
+    Job(const QString &title, int itemCount, const WorkFunction &work, Priority priority = NormalPriority);
+
+    QString title() const;
+
+    Priority priority() const;
+
+    State state() const;
+
+    // Finished or canceled
+    bool isDone() const;
+
+    int itemCount() const;
+
+    int failedItems() const;
+
+    // Items done, with rate and remaining time
+    ProgressReporter *progress() const;
+
+    // Set before submitting, 1 processes the items in order
+    void setMaxParallelItems(int maxParallelItems);
+
+    // Starts once the job is finished, and is canceled along with it. Set before submitting.
+    void addDependency(Job *job);
+
+    void cancel();
+
+    // Thread safe
+    bool isCanceled() const;
+
+signals:
+
+    void itemFinished(int item, bool succeeded, const QString &error);
+
+    void stateChanged();
+
+    void finished(bool canceled);
+
+private slots:
+
+    void onItemProcessed(int item, bool succeeded, const QString &error);
+
+private:
+    friend class JobScheduler;
+
+    void setState(State newState);
+
+    void finishIfDone();
+
+    JobScheduler *scheduler;
+    QString jobTitle;
+    Priority jobPriority;
+    State jobState;
+    WorkFunction work;
+    QList<QPointer<Job> > dependencies;
+    ProgressReporter *progressReporter;
+    QAtomicInt canceled;
+    int items;
+    int nextItem;
+    int runningItems;
+    int doneItems;
+    int failedCount;
+    int maxParallel;
+};
+
+/*
+ * Runs the jobs of the application on one pool of worker threads, so several operations can run
+ * at once without blocking the window or each other's threads. Free threads go to the job with the
+ * highest priority that has items left, jobs of equal priority are served in submission order.
+ * Jobs are owned by the scheduler. Done jobs stay listed until removeDoneJobs(), or until more than
+ * KeptDoneJobs of them have piled up, then the oldest ones are deleted.
+ */
+class JobScheduler : public QObject {
+Q_OBJECT
+
+public:
+    static const int KeptDoneJobs = 20;
+
+    explicit JobScheduler(QObject *parent);
+
+    ~JobScheduler();
+
+    // Takes ownership of the job
+    void submit(Job *job);
+
+    QList<Job *> jobs() const;
+
+    bool hasActiveJobs() const;
+
+public slots:
+
+    void removeDoneJobs();
+
+    void cancelAll();
+
+private slots:
+
+    void pruneDoneJobs();
+
+public:
+    // Cancels all jobs and blocks until their running items are done, used on shutdown
+    void waitForDone();
+
+signals:
+
+    void jobAdded(Job *job);
+
+    // Emitted before the jobs are deleted
+    void jobsRemoved(const QList<Job *> &removedJobs);
+
+private:
+    friend class Job;
+
+    void dispatch();
+
+    // Deferred, so the finished handlers are done with a job before it is deleted
+    void schedulePrune();
+
+    void deleteJobs(const QList<Job *> &removedJobs);
+
+    QThreadPool threadPool;
+    QList<Job *> jobList;
+    int runningTasks;
+    bool dispatching;
+    bool dispatchAgain;
+    bool pruneScheduled;
+};
+
+/*
+ * Held by work functions that read, modify and write a file, so items of different jobs never
+ * rewrite the same file at once. Unlike a dependency between the jobs, canceling one of them does
+ * not cancel the others.
+ */
+class FileLock {
+public:
+    // Blocks while another worker holds the lock of the file
+    explicit FileLock(const QString &fileFullPath);
+
+    ~FileLock();
+
+private:
+    Q_DISABLE_COPY(FileLock)
+
+    QString lockedPath;
+    static QMutex mutex;
+    static QWaitCondition released;
+    static QSet<QString> lockedPaths;
+};
+
+#endif // JOB_SCHEDULER_H
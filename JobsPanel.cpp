@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "JobsPanel.h"
+
+namespace {
+enum Columns {
+    TitleColumn,
+    ProgressColumn,
+    StateColumn
+};
+}
+
+JobsPanel::JobsPanel(QWidget *parent, JobScheduler *jobScheduler) : QWidget(parent) {
+    this->jobScheduler = jobScheduler;
+
+    jobsTree = new QTreeWidget(this);
+    jobsTree->setColumnCount(3);
+    jobsTree->setHeaderLabels(QStringList() << tr("Job") << tr("Progress") << tr("State"));
+    jobsTree->setRootIsDecorated(false);
+    jobsTree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    jobsTree->header()->setSectionResizeMode(TitleColumn, QHeaderView::Stretch);
+    jobsTree->header()->setStretchLastSection(false);
+    connect(jobsTree, SIGNAL(itemSelectionChanged()), this, SLOT(updateButtons()));
+
+    cancelButton = new QPushButton(tr("Cancel"));
+    connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancelSelectedJobs()));
+    clearButton = new QPushButton(tr("Clear Finished"));
+    connect(clearButton, SIGNAL(clicked()), jobScheduler, SLOT(removeDoneJobs()));
+
+    QHBoxLayout *buttonsLayout = new QHBoxLayout;
+    buttonsLayout->addStretch(1);
+    buttonsLayout->addWidget(cancelButton);
+    buttonsLayout->addWidget(clearButton);
+
+    QVBoxLayout *mainLayout = new QVBoxLayout;
+    mainLayout->setContentsMargins(0, 0, 0, 0);
+    mainLayout->addWidget(jobsTree);
+    mainLayout->addLayout(buttonsLayout);
+    setLayout(mainLayout);
+
+    connect(jobScheduler, SIGNAL(jobAdded(Job *)), this, SLOT(addJob(Job *)));
+    connect(jobScheduler, SIGNAL(jobsRemoved(QList<Job *>)), this, SLOT(removeJobs(QList<Job *>)));
+    updateButtons();
+}
+
+void JobsPanel::addJob(Job *job) {
+    QTreeWidgetItem *jobItem = new QTreeWidgetItem(jobsTree);
+    jobItem->setText(TitleColumn, job->title());
+    jobItem->setToolTip(TitleColumn, job->title());
+    jobItems.insert(job, jobItem);
+
+    QProgressBar *progressBar = new QProgressBar;
+    progressBar->setRange(0, qMax(1, job->itemCount()));
+    progressBar->setValue(0);
+    jobsTree->setItemWidget(jobItem, ProgressColumn, progressBar);
+
+    // Both are owned by the job, so the connections go with it
+    connect(job->progress(), &ProgressReporter::updated, this, [this, job]() {
+        updateJobItem(job);
+    });
+    connect(job, &Job::stateChanged, this, [this, job]() {
+        updateJobItem(job);
+        updateButtons();
+    });
+
+    updateJobItem(job);
+    updateButtons();
+}
+
+void JobsPanel::removeJobs(const QList<Job *> &removedJobs) {
+    foreach (Job *job, removedJobs) {
+        delete jobItems.take(job);
+    }
+    updateButtons();
+}
+
+void JobsPanel::cancelSelectedJobs() {
+    QList<QTreeWidgetItem *> selectedItems = jobsTree->selectedItems();
+    for (QHash<Job *, QTreeWidgetItem *>::const_iterator it = jobItems.constBegin(); it != jobItems.constEnd(); ++it) {
+        if (selectedItems.contains(it.value())) {
+            it.key()->cancel();
+        }
+    }
+}
+
+void JobsPanel::updateButtons() {
+    bool canCancel = false;
+    bool canClear = false;
+    for (QHash<Job *, QTreeWidgetItem *>::const_iterator it = jobItems.constBegin(); it != jobItems.constEnd(); ++it) {
+        if (it.key()->isDone()) {
+            canClear = true;
+        } else if (it.value()->isSelected()) {
+            canCancel = true;
+        }
+    }
+    cancelButton->setEnabled(canCancel);
+    clearButton->setEnabled(canClear);
+}
+
+void JobsPanel::updateJobItem(Job *job) {
+    QTreeWidgetItem *jobItem = jobItems.value(job);
+    if (!jobItem) {
+        return;
+    }
+
+    ProgressReporter *progress = job->progress();
+    QProgressBar *progressBar = qobject_cast<QProgressBar *>(jobsTree->itemWidget(jobItem, ProgressColumn));
+    if (progressBar) {
+        progressBar->setValue(job->state() == Job::Finished ? progressBar->maximum() : progress->doneItems());
+    }
+
+    QString state;
+    switch (job->state()) {
+        case Job::Waiting:
+            state = tr("Waiting");
+            break;
+        case Job::Queued:
+            state = tr("Queued");
+            break;
+        case Job::Running:
+            state = progress->rateText();
+            if (state.isEmpty()) {
+                state = tr("Running");
+            }
+            break;
+        case Job::Finished:
+            state = job->failedItems() ? tr("Done, %n failed", "", job->failedItems()) : tr("Done");
+            break;
+        case Job::Canceled:
+            state = tr("Canceled");
+            break;
+    }
+    jobItem->setText(StateColumn, state);
+}
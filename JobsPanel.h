@@ -1,5 +1,5 @@
 /*
- *  Copyright (C) 2013-2014 Ofer Kashayov <oferkv@live.com>
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
  *  This file is part of Phototonic Image Viewer.
  *
  *  Phototonic is free software: you can redistribute it and/or modify
@@ -16,33 +16,37 @@
  *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef COPY_MOVE_DIALOG_H
-#define COPY_MOVE_DIALOG_H
+#ifndef JOBS_PANEL_H
+#define JOBS_PANEL_H
 
-#include <QtWidgets/qdialog.h>
-#include "ThumbsViewer.h"
+#include <QtWidgets>
+#include "JobScheduler.h"
 
-class CopyMoveDialog : public QDialog {
+// Lists the jobs of a JobScheduler with their progress, and cancels or clears them
+class JobsPanel : public QWidget {
 Q_OBJECT
 
-public slots:
+public:
+    JobsPanel(QWidget *parent, JobScheduler *jobScheduler);
 
-    void abort();
+private slots:
 
-public:
-    CopyMoveDialog(QWidget *parent);
+    void addJob(Job *job);
 
-    static int copyOrMoveFile(bool isCopy, QString &srcFile, QString &srcPath, QString &dstPath, QString &dstDir);
+    void removeJobs(const QList<Job *> &removedJobs);
 
-    void exec(ThumbsViewer *thumbView, QString &destDir, bool pasteInCurrDir);
+    void cancelSelectedJobs();
 
-    int nFiles;
-    int latestRow;
+    void updateButtons();
 
 private:
-    QLabel *opLabel;
+    void updateJobItem(Job *job);
+
+    JobScheduler *jobScheduler;
+    QTreeWidget *jobsTree;
+    QHash<Job *, QTreeWidgetItem *> jobItems;
     QPushButton *cancelButton;
-    bool abortOp;
+    QPushButton *clearButton;
 };
 
-#endif // COPY_MOVE_DIALOG_H
\ No newline at end of file
+#endif // JOBS_PANEL_H
@@ -0,0 +1,312 @@
+/*
+ *  Copyright (C) 2013-2014 Ofer Kashayov - oferkv@live.com
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "LosslessJpeg.h"
+#include "ImageTransforms.h"
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+
+namespace {
+struct ErrorManager {
+    jpeg_error_mgr manager;
+    jmp_buf jumpBuffer;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void exitOnError(j_common_ptr info) {
+    ErrorManager *errorManager = reinterpret_cast<ErrorManager *>(info->err);
+    (*info->err->format_message)(info, errorManager->message);
+    longjmp(errorManager->jumpBuffer, 1);
+}
+
+// The part of one component's block grid covered by the source rectangle
+struct BlockRange {
+    int left;
+    int top;
+    int columns;
+    int rows;
+};
+
+int roundUp(int value, int multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+/*
+ * Blocks can only be moved as a whole, so an edge of the source rectangle that becomes the top or
+ * left edge of the result must sit on the MCU grid. Edges that end up on the bottom or right may
+ * cut through a block, the decoder ignores whatever lies past the new image size.
+ */
+bool isAligned(int orientation, const QRect &rect, int mcuWidth, int mcuHeight) {
+    bool leftLeads = false, rightLeads = false, topLeads = false, bottomLeads = false;
+    switch (orientation) {
+        case ImageTransforms::Normal:
+            leftLeads = topLeads = true;
+            break;
+        case ImageTransforms::MirrorHorizontal:
+            rightLeads = topLeads = true;
+            break;
+        case ImageTransforms::Rotate180:
+            rightLeads = bottomLeads = true;
+            break;
+        case ImageTransforms::MirrorVertical:
+            leftLeads = bottomLeads = true;
+            break;
+        case ImageTransforms::Transpose:
+            topLeads = leftLeads = true;
+            break;
+        case ImageTransforms::Rotate90:
+            bottomLeads = leftLeads = true;
+            break;
+        case ImageTransforms::Transverse:
+            bottomLeads = rightLeads = true;
+            break;
+        case ImageTransforms::Rotate270:
+            topLeads = rightLeads = true;
+            break;
+        default:
+            return false;
+    }
+
+    return (!leftLeads || rect.left() % mcuWidth == 0)
+           && (!rightLeads || (rect.right() + 1) % mcuWidth == 0)
+           && (!topLeads || rect.top() % mcuHeight == 0)
+           && (!bottomLeads || (rect.bottom() + 1) % mcuHeight == 0);
+}
+
+// Moving a block around the image also rearranges and negates its frequencies
+void transformBlock(const JCOEF *source, JCOEF *destination, int orientation) {
+    const bool transposing = ImageTransforms::isTransposing(orientation);
+    for (int row = 0; row < DCTSIZE; ++row) {
+        for (int column = 0; column < DCTSIZE; ++column) {
+            JCOEF value = transposing ? source[column * DCTSIZE + row] : source[row * DCTSIZE + column];
+            bool negate;
+            switch (orientation) {
+                case ImageTransforms::MirrorHorizontal:
+                case ImageTransforms::Rotate90:
+                    negate = column & 1;
+                    break;
+                case ImageTransforms::MirrorVertical:
+                case ImageTransforms::Rotate270:
+                    negate = row & 1;
+                    break;
+                case ImageTransforms::Rotate180:
+                case ImageTransforms::Transverse:
+                    negate = (row + column) & 1;
+                    break;
+                default:
+                    negate = false;
+                    break;
+            }
+            destination[row * DCTSIZE + column] = negate ? -value : value;
+        }
+    }
+}
+
+void destinationBlock(int orientation, const BlockRange &range, int sourceColumn, int sourceRow,
+                      int &destinationColumn, int &destinationRow) {
+    const int x = sourceColumn - range.left;
+    const int y = sourceRow - range.top;
+    const int lastColumn = range.columns - 1;
+    const int lastRow = range.rows - 1;
+    switch (orientation) {
+        case ImageTransforms::MirrorHorizontal:
+            destinationColumn = lastColumn - x;
+            destinationRow = y;
+            break;
+        case ImageTransforms::Rotate180:
+            destinationColumn = lastColumn - x;
+            destinationRow = lastRow - y;
+            break;
+        case ImageTransforms::MirrorVertical:
+            destinationColumn = x;
+            destinationRow = lastRow - y;
+            break;
+        case ImageTransforms::Transpose:
+            destinationColumn = y;
+            destinationRow = x;
+            break;
+        case ImageTransforms::Rotate90:
+            destinationColumn = lastRow - y;
+            destinationRow = x;
+            break;
+        case ImageTransforms::Transverse:
+            destinationColumn = lastRow - y;
+            destinationRow = lastColumn - x;
+            break;
+        case ImageTransforms::Rotate270:
+            destinationColumn = y;
+            destinationRow = lastColumn - x;
+            break;
+        default:
+            destinationColumn = x;
+            destinationRow = y;
+            break;
+    }
+}
+
+void transposeQuantizationTables(j_compress_ptr destination) {
+    for (int table = 0; table < NUM_QUANT_TBLS; ++table) {
+        JQUANT_TBL *quantizationTable = destination->quant_tbl_ptrs[table];
+        if (!quantizationTable) {
+            continue;
+        }
+        for (int row = 0; row < DCTSIZE; ++row) {
+            for (int column = row + 1; column < DCTSIZE; ++column) {
+                UINT16 value = quantizationTable->quantval[row * DCTSIZE + column];
+                quantizationTable->quantval[row * DCTSIZE + column] = quantizationTable->quantval[column * DCTSIZE + row];
+                quantizationTable->quantval[column * DCTSIZE + row] = value;
+            }
+        }
+    }
+}
+}
+
+namespace LosslessJpeg {
+
+    bool isJpeg(const QByteArray &data) {
+        return data.size() > 3 && uchar(data.at(0)) == 0xFF && uchar(data.at(1)) == 0xD8 && uchar(data.at(2)) == 0xFF;
+    }
+
+    Result transform(const QByteArray &jpegData, int orientation, const QRect &sourceRect,
+                     QByteArray &transformedData, QString &error) {
+        jpeg_decompress_struct source;
+        jpeg_compress_struct destination;
+        ErrorManager errorManager;
+        unsigned char *outputBuffer = nullptr;
+        unsigned long outputSize = 0;
+        jvirt_barray_ptr destinationArrays[MAX_COMPONENTS];
+        BlockRange ranges[MAX_COMPONENTS];
+
+        if (!isJpeg(jpegData) || orientation < ImageTransforms::Normal || orientation > ImageTransforms::Rotate270) {
+            return NotLossless;
+        }
+
+        source.err = jpeg_std_error(&errorManager.manager);
+        destination.err = source.err;
+        errorManager.manager.error_exit = exitOnError;
+        jpeg_create_decompress(&source);
+        jpeg_create_compress(&destination);
+
+        if (setjmp(errorManager.jumpBuffer)) {
+            error = QString::fromLocal8Bit(errorManager.message);
+            jpeg_destroy_compress(&destination);
+            jpeg_destroy_decompress(&source);
+            free(outputBuffer);
+            return Error;
+        }
+
+        jpeg_mem_src(&source, reinterpret_cast<unsigned char *>(const_cast<char *>(jpegData.constData())),
+                     jpegData.size());
+        // Keep the ICC profile, everything else is restored by Exiv2
+        jpeg_save_markers(&source, JPEG_APP0 + 2, 0xFFFF);
+        jpeg_read_header(&source, TRUE);
+
+        // A single component image is not interleaved, its MCU is one block whatever the sampling factors say
+        const bool singleComponent = source.num_components == 1;
+        const int maxHorizontalSampling = singleComponent ? 1 : source.max_h_samp_factor;
+        const int maxVerticalSampling = singleComponent ? 1 : source.max_v_samp_factor;
+        const QRect rect = sourceRect.intersected(QRect(0, 0, int(source.image_width), int(source.image_height)));
+        const bool transposing = ImageTransforms::isTransposing(orientation);
+
+        if (rect.isEmpty() || source.num_components > MAX_COMPONENTS
+            || !isAligned(orientation, rect, maxHorizontalSampling * DCTSIZE, maxVerticalSampling * DCTSIZE)) {
+            jpeg_destroy_compress(&destination);
+            jpeg_destroy_decompress(&source);
+            return NotLossless;
+        }
+
+        // The destination arrays have to be requested before the source coefficients are read
+        for (int component = 0; component < source.num_components; ++component) {
+            jpeg_component_info *componentInfo = source.comp_info + component;
+            const int horizontalSampling = singleComponent ? 1 : componentInfo->h_samp_factor;
+            const int verticalSampling = singleComponent ? 1 : componentInfo->v_samp_factor;
+            const int blockWidth = DCTSIZE * maxHorizontalSampling / horizontalSampling;
+            const int blockHeight = DCTSIZE * maxVerticalSampling / verticalSampling;
+
+            BlockRange &range = ranges[component];
+            range.left = rect.left() / blockWidth;
+            range.top = rect.top() / blockHeight;
+            range.columns = qMin(int(componentInfo->width_in_blocks), (rect.right() + blockWidth) / blockWidth) - range.left;
+            range.rows = qMin(int(componentInfo->height_in_blocks), (rect.bottom() + blockHeight) / blockHeight) - range.top;
+
+            const int destinationColumns = roundUp(transposing ? range.rows : range.columns,
+                                                   transposing ? verticalSampling : horizontalSampling);
+            const int destinationRows = roundUp(transposing ? range.columns : range.rows,
+                                                transposing ? horizontalSampling : verticalSampling);
+            destinationArrays[component] = (*source.mem->request_virt_barray)(
+                    reinterpret_cast<j_common_ptr>(&source), JPOOL_IMAGE, TRUE,
+                    JDIMENSION(destinationColumns), JDIMENSION(destinationRows), JDIMENSION(destinationRows));
+        }
+
+        jvirt_barray_ptr *sourceArrays = jpeg_read_coefficients(&source);
+
+        jpeg_copy_critical_parameters(&source, &destination);
+        destination.image_width = JDIMENSION(transposing ? rect.height() : rect.width());
+        destination.image_height = JDIMENSION(transposing ? rect.width() : rect.height());
+        for (int component = 0; component < destination.num_components; ++component) {
+            jpeg_component_info *componentInfo = destination.comp_info + component;
+            if (singleComponent) {
+                componentInfo->h_samp_factor = componentInfo->v_samp_factor = 1;
+            } else if (transposing) {
+                int horizontalSampling = componentInfo->h_samp_factor;
+                componentInfo->h_samp_factor = componentInfo->v_samp_factor;
+                componentInfo->v_samp_factor = horizontalSampling;
+            }
+        }
+        if (transposing) {
+            transposeQuantizationTables(&destination);
+        }
+        if (source.progressive_mode) {
+            jpeg_simple_progression(&destination);
+        }
+
+        for (int component = 0; component < source.num_components; ++component) {
+            const BlockRange &range = ranges[component];
+            JBLOCKARRAY destinationBlocks = (*source.mem->access_virt_barray)(
+                    reinterpret_cast<j_common_ptr>(&source), destinationArrays[component], 0,
+                    JDIMENSION(transposing ? range.columns : range.rows), TRUE);
+
+            for (int row = range.top; row < range.top + range.rows; ++row) {
+                JBLOCKARRAY sourceBlocks = (*source.mem->access_virt_barray)(
+                        reinterpret_cast<j_common_ptr>(&source), sourceArrays[component], JDIMENSION(row), 1, FALSE);
+                for (int column = range.left; column < range.left + range.columns; ++column) {
+                    int destinationColumn, destinationRow;
+                    destinationBlock(orientation, range, column, row, destinationColumn, destinationRow);
+                    transformBlock(sourceBlocks[0][column], destinationBlocks[destinationRow][destinationColumn],
+                                   orientation);
+                }
+            }
+        }
+
+        jpeg_mem_dest(&destination, &outputBuffer, &outputSize);
+        jpeg_write_coefficients(&destination, destinationArrays);
+        for (jpeg_saved_marker_ptr marker = source.marker_list; marker; marker = marker->next) {
+            jpeg_write_marker(&destination, marker->marker, marker->data, marker->data_length);
+        }
+        jpeg_finish_compress(&destination);
+        jpeg_finish_decompress(&source);
+
+        transformedData = QByteArray(reinterpret_cast<const char *>(outputBuffer), int(outputSize));
+        jpeg_destroy_compress(&destination);
+        jpeg_destroy_decompress(&source);
+        free(outputBuffer);
+        return Success;
+    }
+}
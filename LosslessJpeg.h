@@ -0,0 +1,50 @@
+/*
+ *  Copyright (C) 2013-2014 Ofer Kashayov - oferkv@live.com
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOSSLESS_JPEG_H
+#define LOSSLESS_JPEG_H
+
+#include <QByteArray>
+#include <QRect>
+#include <QString>
+
+/*
+ * Rotates, flips and crops JPEG files in the DCT domain, the way jpegtran does, so the
+ * image is neither decoded nor re-encoded. Only the DCT coefficients are rearranged.
+ */
+namespace LosslessJpeg {
+    typedef enum
+    {
+        Success,
+        NotLossless,
+        Error
+    } Result;
+
+    bool isJpeg(const QByteArray &data);
+
+    /*
+     * Applies an Exif style orientation (see ImageTransforms::Orientation) to the sourceRect part
+     * of the image. Returns NotLossless when an edge of the rectangle that ends up on the top or
+     * left of the result is not aligned to the MCU grid, in which case the caller re-encodes.
+     * Metadata other than the ICC profile is not copied, use Exiv2 for that.
+     */
+    Result transform(const QByteArray &jpegData, int orientation, const QRect &sourceRect,
+                     QByteArray &transformedData, QString &error);
+}
+
+#endif // LOSSLESS_JPEG_H
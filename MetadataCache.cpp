@@ -17,73 +17,242 @@
  */
 
 #include <exiv2/exiv2.hpp>
+#include "BoundedFileIo.h"
+#include "ImageFileBuffer.h"
 #include "Settings.h"
 #include "MetadataCache.h"
+#include "XmpSidecar.h"
 
-void MetadataCache::updateImageTags(QString &imageFileName, QSet<QString> tags) {
-    cache[imageFileName].tags = tags;
+MetadataCache::Shard &MetadataCache::shardOf(const QString &imageFileName) {
+    return shards[qHash(imageFileName) % ShardCount];
 }
 
-bool MetadataCache::removeTagFromImage(QString &imageFileName, const QString &tagName) {
-    return cache[imageFileName].tags.remove(tagName);
+const MetadataCache::Shard &MetadataCache::shardOf(const QString &imageFileName) const {
+    return shards[qHash(imageFileName) % ShardCount];
 }
 
-void MetadataCache::removeImage(QString &imageFileName) {
-    cache.remove(imageFileName);
+void MetadataCache::updateImageTags(const QString &imageFileName, QSet<QString> tags) {
+    Shard &shard = shardOf(imageFileName);
+    QWriteLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::iterator it = shard.images.find(imageFileName);
+    if (it != shard.images.end()) {
+        it->tagIds = TagDictionary::intern(tags);
+    }
 }
 
-QSet<QString> &MetadataCache::getImageTags(QString &imageFileName) {
-    return cache[imageFileName].tags;
+bool MetadataCache::removeTagFromImage(const QString &imageFileName, const QString &tagName) {
+    const int tagId = TagDictionary::find(tagName);
+    if (tagId < 0) {
+        return false;
+    }
+
+    Shard &shard = shardOf(imageFileName);
+    QWriteLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::iterator it = shard.images.find(imageFileName);
+    return it != shard.images.end() && TagDictionary::remove(it->tagIds, tagId);
 }
 
-long MetadataCache::getImageOrientation(QString &imageFileName) {
-    if (cache.contains(imageFileName) || loadImageMetadata(imageFileName)) {
-        return cache[imageFileName].orientation;
+void MetadataCache::removeImage(const QString &imageFileName) {
+    Shard &shard = shardOf(imageFileName);
+    {
+        QWriteLocker locker(&shard.lock);
+        shard.images.remove(imageFileName);
     }
+    metadataIndex.remove(imageFileName);
+}
+
+bool MetadataCache::contains(const QString &imageFileName) const {
+    const Shard &shard = shardOf(imageFileName);
+    QReadLocker locker(&shard.lock);
+    return shard.images.contains(imageFileName);
+}
+
+QSet<QString> MetadataCache::getImageTags(const QString &imageFileName) const {
+    const Shard &shard = shardOf(imageFileName);
+    QReadLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::const_iterator it = shard.images.constFind(imageFileName);
+    return it != shard.images.constEnd() ? TagDictionary::names(it->tagIds) : QSet<QString>();
+}
+
+TagIdList MetadataCache::getImageTagIds(const QString &imageFileName) const {
+    const Shard &shard = shardOf(imageFileName);
+    QReadLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::const_iterator it = shard.images.constFind(imageFileName);
+    return it != shard.images.constEnd() ? it->tagIds : TagIdList();
+}
+
+long MetadataCache::getImageOrientation(const QString &imageFileName) {
+    Shard &shard = shardOf(imageFileName);
+    {
+        QReadLocker locker(&shard.lock);
+        QHash<QString, ImageMetadata>::const_iterator it = shard.images.constFind(imageFileName);
+        if (it != shard.images.constEnd()) {
+            return it->orientation;
+        }
+    }
+
+    ImageMetadata imageMetadata;
+    if (!parseImageMetadata(QFileInfo(imageFileName), imageMetadata)) {
+        return 0;
+    }
+
+    QHash<QString, ImageMetadata> images;
+    images.insert(imageFileName, imageMetadata);
+    insertImages(images);
+    return imageMetadata.orientation;
+}
 
-    return 0;
+void MetadataCache::setImageOrientation(const QString &imageFileName, long orientation) {
+    Shard &shard = shardOf(imageFileName);
+    QWriteLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::iterator it = shard.images.find(imageFileName);
+    if (it != shard.images.end()) {
+        it->orientation = orientation;
+    }
 }
 
 void MetadataCache::setImageTags(const QString &imageFileName, QSet<QString> tags) {
     ImageMetadata imageMetadata;
+    imageMetadata.tagIds = TagDictionary::intern(tags);
+
+    Shard &shard = shardOf(imageFileName);
+    QWriteLocker locker(&shard.lock);
+    shard.images.insert(imageFileName, imageMetadata);
+}
 
-    imageMetadata.tags = tags;
-    cache.insert(imageFileName, imageMetadata);
+void MetadataCache::addTagToImage(const QString &imageFileName, const QString &tagName) {
+    const int tagId = TagDictionary::intern(tagName);
+
+    Shard &shard = shardOf(imageFileName);
+    QWriteLocker locker(&shard.lock);
+    QHash<QString, ImageMetadata>::iterator it = shard.images.find(imageFileName);
+    if (it != shard.images.end()) {
+        TagDictionary::insert(it->tagIds, tagId);
+    }
 }
 
-void MetadataCache::addTagToImage(QString &imageFileName, QString &tagName) {
-    if (cache[imageFileName].tags.contains(tagName)) {
-        return;
+void MetadataCache::insertImages(const QHash<QString, ImageMetadata> &images) {
+    QVector<QHash<QString, ImageMetadata>::const_iterator> imagesByShard[ShardCount];
+    TagIdList tagIds;
+    for (QHash<QString, ImageMetadata>::const_iterator it = images.constBegin(); it != images.constEnd(); ++it) {
+        imagesByShard[qHash(it.key()) % ShardCount].append(it);
+        for (int i = 0; i < it->tagIds.size(); ++i) {
+            TagDictionary::insert(tagIds, it->tagIds.at(i));
+        }
     }
 
-    cache[imageFileName].tags.insert(tagName);
+    for (int shardIndex = 0; shardIndex < ShardCount; ++shardIndex) {
+        if (imagesByShard[shardIndex].isEmpty()) {
+            continue;
+        }
+
+        QWriteLocker locker(&shards[shardIndex].lock);
+        for (int i = 0; i < imagesByShard[shardIndex].size(); ++i) {
+            shards[shardIndex].images.insert(imagesByShard[shardIndex][i].key(), imagesByShard[shardIndex][i].value());
+        }
+    }
+
+    if (!tagIds.isEmpty()) {
+        QSet<QString> tags = TagDictionary::names(tagIds);
+        QMutexLocker locker(&Settings::knownTagsMutex);
+        Settings::knownTags.unite(tags);
+    }
 }
 
 void MetadataCache::clear() {
-    cache.clear();
+    for (int shardIndex = 0; shardIndex < ShardCount; ++shardIndex) {
+        QWriteLocker locker(&shards[shardIndex].lock);
+        shards[shardIndex].images.clear();
+    }
 }
 
 bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
+    return loadImageMetadata(QFileInfo(imageFullPath));
+}
+
+bool MetadataCache::loadImageMetadata(const QFileInfo &imageFileInfo) {
+    return loadImageMetadata(imageFileInfo, 0);
+}
+
+bool MetadataCache::loadImageMetadata(const ImageFileBuffer &imageFile) {
+    return loadImageMetadata(QFileInfo(imageFile.fileName()), &imageFile);
+}
+
+bool MetadataCache::loadImageMetadata(const QFileInfo &imageFileInfo, const ImageFileBuffer *imageFile) {
+    ImageMetadata imageMetadata;
+    if (!parseImageMetadata(imageFileInfo, imageMetadata, imageFile)) {
+        return false;
+    }
+
+    QHash<QString, ImageMetadata> images;
+    images.insert(imageFileInfo.filePath(), imageMetadata);
+    insertImages(images);
+    return true;
+}
+
+bool MetadataCache::parseImageMetadata(const QFileInfo &imageFileInfo, ImageMetadata &imageMetadata) {
+    return parseImageMetadata(imageFileInfo, imageMetadata, 0);
+}
+
+bool MetadataCache::parseImageMetadata(const QFileInfo &imageFileInfo, ImageMetadata &imageMetadata,
+                                       const ImageFileBuffer *imageFile) {
+    if (metadataIndex.lookup(imageFileInfo, imageMetadata)) {
+        return true;
+    }
+
+    if (!readImageMetadata(imageFileInfo.filePath(), imageMetadata, imageFile)) {
+        return false;
+    }
+
+    metadataIndex.insert(imageFileInfo, imageMetadata);
+    return true;
+}
+
+bool MetadataCache::readImageMetadata(const QString &imageFullPath, ImageMetadata &imageMetadata,
+                                      const ImageFileBuffer *imageFile) {
     Exiv2::Image::AutoPtr exifImage;
-    QSet<QString> tags;
-    long orientation = 0;
 
+    qint64 bytesRead = 0;
     try {
-        exifImage = Exiv2::ImageFactory::open(imageFullPath.toStdString());
-        exifImage->readMetadata();
+        exifImage = imageFile ? imageFile->readMetadata() : BoundedFileIo::readMetadata(imageFullPath, bytesRead);
     } catch (Exiv2::Error &error) {
+        metadataBytesRead.fetchAndAddRelaxed(bytesRead);
         qWarning() << "Error loading image for reading metadata" << error.what();
         return false;
     }
+    metadataBytesRead.fetchAndAddRelaxed(bytesRead);
 
     if (!exifImage->good()) {
         return false;
     }
 
+    imageMetadata.width = exifImage->pixelWidth();
+    imageMetadata.height = exifImage->pixelHeight();
+
     if (exifImage->supportsMetadata(Exiv2::mdExif)) try {
-        Exiv2::ExifData::const_iterator it = Exiv2::orientation(exifImage->exifData());
-        if (it != exifImage->exifData().end()) {
-            orientation = it->toLong();
+        Exiv2::ExifData &exifData = exifImage->exifData();
+        Exiv2::ExifData::const_iterator it = Exiv2::orientation(exifData);
+        if (it != exifData.end()) {
+            imageMetadata.orientation = it->toLong();
+        }
+
+        it = exifData.findKey(Exiv2::ExifKey("Exif.Photo.DateTimeOriginal"));
+        if (it == exifData.end()) {
+            it = exifData.findKey(Exiv2::ExifKey("Exif.Image.DateTime"));
+        }
+        if (it != exifData.end()) {
+            imageMetadata.captureTime = QDateTime::fromString(QString::fromStdString(it->toString()),
+                                                              "yyyy:MM:dd HH:mm:ss");
+        }
+
+        it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Make"));
+        if (it != exifData.end()) {
+            imageMetadata.cameraMake = QString::fromUtf8(it->toString().c_str()).trimmed();
+        }
+
+        it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Model"));
+        if (it != exifData.end()) {
+            imageMetadata.cameraModel = QString::fromUtf8(it->toString().c_str()).trimmed();
         }
     } catch (Exiv2::Error &error) {
         qWarning() << "Failed to read Exif metadata" << error.what();
@@ -92,7 +261,6 @@ bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
     if (exifImage->supportsMetadata(Exiv2::mdIptc)) try {
         Exiv2::IptcData &iptcData = exifImage->iptcData();
         if (!iptcData.empty()) {
-            QString key;
             Exiv2::IptcData::iterator end = iptcData.end();
 
             // Finds the first ID, but we need to loop over the rest in case there are more
@@ -102,28 +270,34 @@ bool MetadataCache::loadImageMetadata(const QString &imageFullPath) {
                     continue;
                 }
 
-                QString tagName = QString::fromUtf8(iptcIt->toString().c_str());
-                tags.insert(tagName);
-                Settings::knownTags.insert(tagName);
+                int tagId = TagDictionary::intern(QString::fromUtf8(iptcIt->toString().c_str()));
+                TagDictionary::insert(imageMetadata.tagIds, tagId);
             }
         }
     } catch (Exiv2::Error &error) {
         qWarning() << "Failed to read Iptc metadata";
     }
 
-    ImageMetadata imageMetadata;
-    if (tags.size()) {
-        imageMetadata.tags = tags;
-    }
+    XmpSidecar::read(imageFullPath, imageMetadata);
+    return true;
+}
 
-    if (orientation) {
-        imageMetadata.orientation = orientation;
-    }
+void MetadataCache::sync() {
+    metadataIndex.sync();
+}
 
-    if (tags.size() || orientation) {
-        cache.insert(imageFullPath, imageMetadata);
-    }
+quint64 MetadataCache::indexHits() const {
+    return metadataIndex.hits();
+}
 
-    return true;
+quint64 MetadataCache::indexMisses() const {
+    return metadataIndex.misses();
+}
+
+qreal MetadataCache::indexHitRate() const {
+    return metadataIndex.hitRate();
 }
 
+qint64 MetadataCache::bytesRead() const {
+    return metadataBytesRead.load();
+}
@@ -20,38 +20,93 @@
 #define META_DATA_CACHE_H
 
 #include <QtWidgets>
+#include "MetadataIndex.h"
 
-class ImageMetadata {
-public:
-    QSet<QString> tags;
-    long orientation;
-};
+class ImageFileBuffer;
 
+/*
+ * Thread safe. Images are spread over independently locked shards by the hash of their path, so
+ * thumbnail and metadata workers rarely contend with each other or with the GUI thread. Getters
+ * return copies and, except for getImageOrientation(), never create entries, neither do the
+ * updaters: an image that is not cached, for example after clear(), is left alone and read from
+ * the file when it is next needed.
+ */
 class MetadataCache {
 
 private:
-    QMap<QString, ImageMetadata> cache;
+    static const int ShardCount = 16;
+
+    struct Shard {
+        mutable QReadWriteLock lock;
+        QHash<QString, ImageMetadata> images;
+    };
+
+    Shard shards[ShardCount];
+    MetadataIndex metadataIndex;
+    QAtomicInteger<qint64> metadataBytesRead;
+
+    Shard &shardOf(const QString &imageFileName);
+
+    const Shard &shardOf(const QString &imageFileName) const;
+
+    // Parses imageFile when given, otherwise reads only the metadata parts of the file
+    bool readImageMetadata(const QString &imageFullPath, ImageMetadata &imageMetadata,
+                           const ImageFileBuffer *imageFile = 0);
+
+    bool parseImageMetadata(const QFileInfo &imageFileInfo, ImageMetadata &imageMetadata,
+                            const ImageFileBuffer *imageFile);
+
+    bool loadImageMetadata(const QFileInfo &imageFileInfo, const ImageFileBuffer *imageFile);
 
 public:
-    void updateImageTags(QString &imageFileName, QSet<QString> tags);
+    void updateImageTags(const QString &imageFileName, QSet<QString> tags);
+
+    void addTagToImage(const QString &imageFileName, const QString &tagName);
 
-    void addTagToImage(QString &imageFileName, QString &tagName);
+    bool removeTagFromImage(const QString &imageFileName, const QString &tagName);
 
-    bool removeTagFromImage(QString &imageFileName, const QString &tagName);
+    void removeImage(const QString &imageFileName);
 
-    void removeImage(QString &imageFileName);
+    bool contains(const QString &imageFileName) const;
 
-    QSet<QString> &getImageTags(QString &imageFileName);
+    QSet<QString> getImageTags(const QString &imageFileName) const;
+
+    TagIdList getImageTagIds(const QString &imageFileName) const;
 
     void setImageTags(const QString &imageFileName, QSet<QString> tags);
 
+    // Inserts results of parser workers, taking each shard lock once
+    void insertImages(const QHash<QString, ImageMetadata> &images);
+
     void clear();
 
+    // Index lookup or Exiv2 parse without touching the cache, for workers that bulk insert
+    bool parseImageMetadata(const QFileInfo &imageFileInfo, ImageMetadata &imageMetadata);
+
     bool loadImageMetadata(const QString &imageFullPath);
 
-    long getImageOrientation(QString &imageFileName);
+    bool loadImageMetadata(const QFileInfo &imageFileInfo);
+
+    // For images that are being decoded anyway, parses the bytes already read for the decoder
+    bool loadImageMetadata(const ImageFileBuffer &imageFile);
+
+    // Parses the file on a miss and caches what it read, 0 when it cannot be read
+    long getImageOrientation(const QString &imageFileName);
+
+    void setImageOrientation(const QString &imageFileName, long orientation);
+
+    // Writes metadata read since the last call to the persistent index
+    void sync();
+
+    quint64 indexHits() const;
+
+    quint64 indexMisses() const;
+
+    qreal indexHitRate() const;
+
+    // Bytes fetched from image files to parse their metadata, index hits read nothing
+    qint64 bytesRead() const;
 
 };
 
 #endif // META_DATA_CACHE_H
-
@@ -0,0 +1,270 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QSaveFile>
+#include <QStandardPaths>
+#include "MetadataIndex.h"
+#include "XmpSidecar.h"
+
+namespace {
+const quint32 IndexMagic = 0x50544d49; // "PTMI"
+const quint32 IndexVersion = 2;
+
+// Superseded records tolerated before the log is rewritten
+const int CompactionSlack = 1000;
+
+void writeHeader(QDataStream &out) {
+    out << IndexMagic << IndexVersion;
+}
+}
+
+MetadataIndex::MetadataIndex() {
+    indexFilePath = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+                    + QDir::separator() + "phototonic" + QDir::separator() + "metadata.idx";
+    recordsInFile = 0;
+    loaded = false;
+    hitCount = 0;
+    missCount = 0;
+}
+
+MetadataIndex::~MetadataIndex() {
+    sync();
+}
+
+void MetadataIndex::writeRecord(QDataStream &out, const QString &imageFullPath, const Entry &entry) {
+    out << imageFullPath << entry.size << entry.modified << entry.sidecarModified;
+    if (entry.size < 0) {
+        return;
+    }
+
+    const ImageMetadata &metadata = entry.metadata;
+    // IDs are only meaningful within one process, so names are stored
+    out << TagDictionary::names(metadata.tagIds) << (qint32) metadata.orientation << (qint32) metadata.width << (qint32) metadata.height
+        << metadata.captureTime << metadata.cameraMake << metadata.cameraModel;
+}
+
+bool MetadataIndex::readRecord(QDataStream &in, QString &imageFullPath, Entry &entry) {
+    in >> imageFullPath >> entry.size >> entry.modified >> entry.sidecarModified;
+    if (in.status() == QDataStream::Ok && entry.size >= 0) {
+        QSet<QString> tags;
+        qint32 orientation, width, height;
+        ImageMetadata &metadata = entry.metadata;
+        in >> tags >> orientation >> width >> height
+           >> metadata.captureTime >> metadata.cameraMake >> metadata.cameraModel;
+        metadata.tagIds = TagDictionary::intern(tags);
+        metadata.orientation = orientation;
+        metadata.width = width;
+        metadata.height = height;
+    }
+
+    return in.status() == QDataStream::Ok;
+}
+
+void MetadataIndex::load() {
+    loaded = true;
+
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    const qint64 fileSize = file.size();
+    uchar *mapped = file.map(0, fileSize);
+    QByteArray data = mapped ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), (int) fileSize)
+                             : file.readAll();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+    if (in.status() != QDataStream::Ok || magic != IndexMagic || version != IndexVersion) {
+        if (mapped) {
+            file.unmap(mapped);
+        }
+        file.close();
+        file.remove();
+        return;
+    }
+
+    QString imageFullPath;
+    Entry entry;
+    while (!in.atEnd() && readRecord(in, imageFullPath, entry)) {
+        ++recordsInFile;
+        if (entry.size < 0) {
+            entries.remove(imageFullPath);
+        } else {
+            entries.insert(imageFullPath, entry);
+        }
+    }
+    const bool truncated = in.status() != QDataStream::Ok;
+
+    // Every string read above is a deep copy, so the mapping can go now
+    if (mapped) {
+        file.unmap(mapped);
+    }
+    file.close();
+
+    // A partially written tail (crash during sync) would corrupt the records appended after it
+    if (truncated) {
+        qWarning() << "Metadata index is truncated, rewriting" << indexFilePath;
+        compact();
+    }
+}
+
+bool MetadataIndex::lookup(const QFileInfo &fileInfo, ImageMetadata &imageMetadata) {
+    const QString imageFullPath = fileInfo.absoluteFilePath();
+    const qint64 size = fileInfo.size();
+    const qint64 modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    const qint64 sidecarModifiedTime = XmpSidecar::lastModified(imageFullPath);
+
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        load();
+    }
+
+    QHash<QString, Entry>::const_iterator it = entries.constFind(imageFullPath);
+    if (it == entries.constEnd() || it->size != size || it->modified != modified
+        || it->sidecarModified != sidecarModifiedTime) {
+        ++missCount;
+        return false;
+    }
+
+    imageMetadata = it->metadata;
+    ++hitCount;
+    return true;
+}
+
+void MetadataIndex::insert(const QFileInfo &fileInfo, const ImageMetadata &imageMetadata) {
+    Entry entry;
+    entry.size = fileInfo.size();
+    entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    entry.metadata = imageMetadata;
+    const QString imageFullPath = fileInfo.absoluteFilePath();
+    entry.sidecarModified = XmpSidecar::lastModified(imageFullPath);
+
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        load();
+    }
+
+    entries.insert(imageFullPath, entry);
+
+    QDataStream out(&pendingRecords, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_0);
+    writeRecord(out, imageFullPath, entry);
+    ++recordsInFile;
+}
+
+void MetadataIndex::remove(const QString &imageFullPath) {
+    const QString absolutePath = QFileInfo(imageFullPath).absoluteFilePath();
+
+    QMutexLocker locker(&mutex);
+    if (!loaded) {
+        load();
+    }
+
+    if (!entries.remove(absolutePath)) {
+        return;
+    }
+
+    // A tombstone, so a stale record is not revived by a file that keeps its size and time stamp
+    Entry tombstone;
+    tombstone.size = -1;
+    tombstone.modified = 0;
+    tombstone.sidecarModified = 0;
+
+    QDataStream out(&pendingRecords, QIODevice::WriteOnly | QIODevice::Append);
+    out.setVersion(QDataStream::Qt_5_0);
+    writeRecord(out, absolutePath, tombstone);
+    ++recordsInFile;
+}
+
+void MetadataIndex::sync() {
+    QMutexLocker locker(&mutex);
+    if (pendingRecords.isEmpty()) {
+        return;
+    }
+
+    if (recordsInFile > 2 * entries.size() + CompactionSlack) {
+        compact();
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Failed to write metadata index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    if (file.size() == 0) {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_0);
+        writeHeader(out);
+    }
+
+    file.write(pendingRecords);
+    pendingRecords.clear();
+}
+
+void MetadataIndex::compact() {
+    QDir().mkpath(QFileInfo(indexFilePath).absolutePath());
+    QSaveFile file(indexFilePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to write metadata index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    writeHeader(out);
+    for (QHash<QString, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        writeRecord(out, it.key(), it.value());
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write metadata index" << indexFilePath << file.errorString();
+        return;
+    }
+
+    pendingRecords.clear();
+    recordsInFile = entries.size();
+}
+
+quint64 MetadataIndex::hits() const {
+    QMutexLocker locker(&mutex);
+    return hitCount;
+}
+
+quint64 MetadataIndex::misses() const {
+    QMutexLocker locker(&mutex);
+    return missCount;
+}
+
+qreal MetadataIndex::hitRate() const {
+    QMutexLocker locker(&mutex);
+    const quint64 lookups = hitCount + missCount;
+    return lookups ? qreal(hitCount) / lookups : 0;
+}
+
+void MetadataIndex::resetStatistics() {
+    QMutexLocker locker(&mutex);
+    hitCount = 0;
+    missCount = 0;
+}
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <QtWidgets>
+#include "TagDictionary.h"
+
+class ImageMetadata {
+public:
+    ImageMetadata() : orientation(0), width(0), height(0) {
+    }
+
+    TagIdList tagIds;
+    long orientation;
+    int width;
+    int height;
+    QDateTime captureTime;
+    QString cameraMake;
+    QString cameraModel;
+};
+
+/*
+ * Persistent index of the metadata read by MetadataCache, so Exiv2 only runs on files that are new
+ * or changed since they were last seen. Entries are keyed by path and are valid only while the
+ * file size and modification time, and those of its XMP sidecar, match what was recorded.
+ *
+ * The file is an append-only log of QDataStream records, the last record of a path wins. It is
+ * memory mapped and read once on first use, new records are appended by sync() and the log is
+ * rewritten when superseded records outnumber the live ones. All members are thread safe.
+ */
+class MetadataIndex {
+
+public:
+    MetadataIndex();
+
+    ~MetadataIndex();
+
+    bool lookup(const QFileInfo &fileInfo, ImageMetadata &imageMetadata);
+
+    void insert(const QFileInfo &fileInfo, const ImageMetadata &imageMetadata);
+
+    void remove(const QString &imageFullPath);
+
+    void sync();
+
+    quint64 hits() const;
+
+    quint64 misses() const;
+
+    // Fraction of lookups answered from the index, 0 when there were none
+    qreal hitRate() const;
+
+    void resetStatistics();
+
+private:
+    struct Entry {
+        qint64 size;
+        qint64 modified;
+        // 0 when the image had no sidecar
+        qint64 sidecarModified;
+        ImageMetadata metadata;
+    };
+
+    void load();
+
+    void writeRecord(QDataStream &out, const QString &imageFullPath, const Entry &entry);
+
+    bool readRecord(QDataStream &in, QString &imageFullPath, Entry &entry);
+
+    void compact();
+
+    mutable QMutex mutex;
+    QString indexFilePath;
+    QHash<QString, Entry> entries;
+    QByteArray pendingRecords;
+    int recordsInFile;
+    bool loaded;
+    quint64 hitCount;
+    quint64 missCount;
+};
+
+#endif // METADATA_INDEX_H
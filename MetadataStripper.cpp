@@ -0,0 +1,49 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exiv2/exiv2.hpp>
+#include "MetadataStripper.h"
+
+namespace {
+// Every image is rewritten, more threads than this only make the disk seek
+const int MaxStripThreads = 4;
+}
+
+Job *MetadataStripper::createJob(const QStringList &imageFullPaths) {
+    Job *job = new Job(tr("Remove metadata from %n image(s)", "", imageFullPaths.size()), imageFullPaths.size(),
+                       [imageFullPaths](int item, QString &error) {
+                           return stripMetadata(imageFullPaths.at(item), error);
+                       });
+    job->setMaxParallelItems(MaxStripThreads);
+    return job;
+}
+
+bool MetadataStripper::stripMetadata(const QString &imageFullPath, QString &error) {
+    FileLock fileLock(imageFullPath);
+    try {
+        Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(imageFullPath.toStdString());
+        image->clearMetadata();
+        image->writeMetadata();
+    }
+    catch (Exiv2::Error &exiv2Error) {
+        error = QString::fromUtf8(exiv2Error.what());
+        return false;
+    }
+
+    return true;
+}
@@ -1,5 +1,5 @@
 /*
- *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
  *  This file is part of Phototonic Image Viewer.
  *
  *  Phototonic is free software: you can redistribute it and/or modify
@@ -16,29 +16,21 @@
  *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef PROGRESS_DIALOG_H
-#define PROGRESS_DIALOG_H
+#ifndef METADATA_STRIPPER_H
+#define METADATA_STRIPPER_H
 
-#include <QtWidgets/qlabel.h>
-#include <QtWidgets/QWidget>
 #include <QtWidgets>
-#include "Settings.h"
+#include "JobScheduler.h"
 
-class ProgressDialog : public QDialog {
-    Q_OBJECT
-
-public slots:
-
-    void abort();
+// Removes all metadata from images, as a job of the JobScheduler
+class MetadataStripper {
+    Q_DECLARE_TR_FUNCTIONS(MetadataStripper)
 
 public:
-    QLabel *opLabel;
-    bool abortOp;
-
-    ProgressDialog(QWidget *parent);
+    // One item per image, in the given order
+    static Job *createJob(const QStringList &imageFullPaths);
 
-private:
-    QPushButton *cancelButton;
+    static bool stripMetadata(const QString &imageFullPath, QString &error);
 };
 
-#endif // PROGRESS_DIALOG_H
+#endif // METADATA_STRIPPER_H
@@ -19,12 +19,10 @@
 #include "DirCompleter.h"
 #include "Phototonic.h"
 #include "Settings.h"
-#include "CopyMoveDialog.h"
 #include "ResizeDialog.h"
 #include "CropDialog.h"
 #include "ColorsDialog.h"
 #include "ExternalAppsDialog.h"
-#include "ProgressDialog.h"
 #include "RangeInputDialog.h"
 #include "ImagePreview.h"
 #include "FileListWidget.h"
@@ -32,6 +30,13 @@
 #include "RenameDialog.h"
 #include "Trashcan.h"
 #include "MessageBox.h"
+#include "ImageTransforms.h"
+#include "XmpSidecar.h"
+
+namespace {
+// Trashing is a rename, deleting an unlink, a few at once hide the latency of network shares
+const int MaxDeleteThreads = 4;
+}
 
 Phototonic::Phototonic(QStringList argumentsList, int filesStartAt, QWidget *parent) : QMainWindow(parent) {
     Settings::appSettings = new QSettings("phototonic", "phototonic");
@@ -46,6 +51,7 @@ Phototonic::Phototonic(QStringList argumentsList, int filesStartAt, QWidget *par
     createBookmarksDock();
     createImagePreviewDock();
     createImageTagsDock();
+    createJobsDock();
     createImageViewer();
     updateExternalApps();
     loadShortcuts();
@@ -111,11 +117,13 @@ QIcon &Phototonic::getDefaultWindowIcon() {
 
 void Phototonic::loadStartupFileList(QStringList argumentsList, int filesStartAt) {
     Settings::filesList.clear();
+    QSet<QString> listedFiles;
     for (int i = filesStartAt; i < argumentsList.size(); i++) {
         QFile currentFileFullPath(argumentsList[i]);
         QFileInfo currentFileInfo(currentFileFullPath);
 
-        if (!Settings::filesList.contains(currentFileInfo.absoluteFilePath())) {
+        if (!listedFiles.contains(currentFileInfo.absoluteFilePath())) {
+            listedFiles.insert(currentFileInfo.absoluteFilePath());
             Settings::filesList << currentFileInfo.absoluteFilePath();
         }
     }
@@ -135,7 +143,10 @@ bool Phototonic::event(QEvent *event) {
 
 void Phototonic::createThumbsViewer() {
     metadataCache = new MetadataCache;
-    thumbsViewer = new ThumbsViewer(this, metadataCache);
+    // Created first so it is deleted, and its jobs are done, before the views they report to
+    jobScheduler = new JobScheduler(this);
+    thumbsViewer = new ThumbsViewer(this, metadataCache, jobScheduler);
+
     thumbsViewer->thumbsSortFlags = (QDir::SortFlags) Settings::appSettings->value(
             Settings::optionThumbsSortFlags).toInt();
     thumbsViewer->thumbsSortFlags |= QDir::IgnoreCase;
@@ -675,6 +686,10 @@ void Phototonic::createActions() {
     findDupesAction->setCheckable(true);
     connect(findDupesAction, SIGNAL(triggered()), this, SLOT(findDuplicateImages()));
 
+    findDupesInReferenceAction = new QAction(tr("Find Duplicates in Reference..."), this);
+    findDupesInReferenceAction->setObjectName("findDupesInReference");
+    connect(findDupesInReferenceAction, SIGNAL(triggered()), this, SLOT(findDuplicatesInReference()));
+
     mirrorDisabledAction = new QAction(tr("Disable Mirror"), this);
     mirrorDisabledAction->setObjectName("mirrorDisabled");
     mirrorDualAction = new QAction(tr("Dual Mirror"), this);
@@ -728,6 +743,14 @@ void Phototonic::createActions() {
     batchTransformAction->setObjectName("batchTransform");
     connect(batchTransformAction, SIGNAL(triggered()), this, SLOT(batchTransform()));
     batchSubMenu->addAction(batchTransformAction);
+    rotateOrientationLeftAction = new QAction(tr("Rotate Orientation Tag 90 degree CCW"), this);
+    rotateOrientationLeftAction->setObjectName("rotateOrientationLeft");
+    connect(rotateOrientationLeftAction, SIGNAL(triggered()), this, SLOT(rotateOrientationLeft()));
+    batchSubMenu->addAction(rotateOrientationLeftAction);
+    rotateOrientationRightAction = new QAction(tr("Rotate Orientation Tag 90 degree CW"), this);
+    rotateOrientationRightAction->setObjectName("rotateOrientationRight");
+    connect(rotateOrientationRightAction, SIGNAL(triggered()), this, SLOT(rotateOrientationRight()));
+    batchSubMenu->addAction(rotateOrientationRightAction);
 
     filterImagesFocusAction = new QAction(tr("Filter by Name"), this);
     filterImagesFocusAction->setObjectName("filterImagesFocus");
@@ -809,6 +832,7 @@ void Phototonic::createMenus() {
     viewMenu->addSeparator();
 
     viewMenu->addAction(findDupesAction);
+    viewMenu->addAction(findDupesInReferenceAction);
 
     // thumbs viewer context menu
     thumbsViewer->addAction(viewImageAction);
@@ -1055,8 +1079,58 @@ void Phototonic::createImageTagsDock() {
 
     connect(tagsDock->toggleViewAction(), SIGNAL(triggered()), this, SLOT(setTagsDockVisibility()));
     connect(tagsDock, SIGNAL(visibilityChanged(bool)), this, SLOT(setTagsDockVisibility()));
-    connect(thumbsViewer->imageTags, SIGNAL(reloadThumbs()), this, SLOT(onReloadThumbs()));
     connect(thumbsViewer->imageTags->removeTagAction, SIGNAL(triggered()), this, SLOT(deleteOperation()));
+    connect(thumbsViewer->imageTags->tagWriteQueue, SIGNAL(progress(int, int)),
+            this, SLOT(onTagWriteProgress(int, int)));
+    tagWriteProgress = new ProgressReporter(this);
+    connect(tagWriteProgress, SIGNAL(updated()), this, SLOT(updateTagWriteStatus()));
+    connect(thumbsViewer->imageTags->tagWriteQueue, SIGNAL(finished(QStringList)),
+            this, SLOT(onTagWritesFinished(QStringList)));
+}
+
+void Phototonic::createJobsDock() {
+    jobsDock = new QDockWidget(tr("Jobs"), this);
+    jobsDock->setObjectName("Jobs");
+    JobsPanel *jobsPanel = new JobsPanel(jobsDock, jobScheduler);
+    jobsDock->setWidget(jobsPanel);
+
+    connect(jobsDock->toggleViewAction(), SIGNAL(triggered()), this, SLOT(setJobsDockVisibility()));
+    connect(jobsDock, SIGNAL(visibilityChanged(bool)), this, SLOT(setJobsDockVisibility()));
+    addDockWidget(Qt::BottomDockWidgetArea, jobsDock);
+
+    // Window states saved before the dock existed do not hide it
+    jobsDock->setVisible(Settings::jobsDockVisible);
+}
+
+void Phototonic::onTagWriteProgress(int writtenImages, int totalImages) {
+    // Edits made while writing extend the running operation
+    if (!tagWriteProgress->isActive()) {
+        tagWriteProgress->start(totalImages);
+    }
+    tagWriteProgress->setTotal(totalImages);
+    tagWriteProgress->setProgress(writtenImages);
+}
+
+void Phototonic::updateTagWriteStatus() {
+    QString status = tr("Saving tags %1 of %2").arg(tagWriteProgress->doneItems()).arg(tagWriteProgress->totalItems());
+    QString rate = tagWriteProgress->rateText();
+    if (!rate.isEmpty()) {
+        status += " (" + rate + ")";
+    }
+    setStatus(status);
+}
+
+void Phototonic::onTagWritesFinished(const QStringList &failedImages) {
+    tagWriteProgress->stop();
+    if (failedImages.isEmpty()) {
+        setStatus(tr("Tags saved"));
+        return;
+    }
+
+    setStatus(tr("Failed to save tags to %n image(s)", "", failedImages.size()));
+    MessageBox msgBox(this);
+    msgBox.critical(tr("Error"), tr("Failed to save tags to %n image(s):", "", failedImages.size())
+                                 + "\n" + failedImages.mid(0, 10).join("\n"));
 }
 
 void Phototonic::sortThumbnails() {
@@ -1377,17 +1451,14 @@ void Phototonic::copyOrMoveImages(bool isMoveOperation) {
                 return;
             }
 
-            QFileInfo fileInfo = QFileInfo(imageViewer->viewerImageFullPath);
-            QString fileName = fileInfo.fileName();
-            QString destFile = copyMoveToDialog->selectedPath + QDir::separator() + fileInfo.fileName();
-
-            int result = CopyMoveDialog::copyOrMoveFile(copyMoveToDialog->copyOp, fileName,
-                                                        imageViewer->viewerImageFullPath,
-                                                        destFile, copyMoveToDialog->selectedPath);
+            QString destFile;
+            QString error;
+            bool result = FileTransfer::copyOrMoveFile(copyMoveToDialog->copyOp, imageViewer->viewerImageFullPath,
+                                                       copyMoveToDialog->selectedPath, destFile, error);
 
             if (!result) {
                 MessageBox msgBox(this);
-                msgBox.critical(tr("Error"), tr("Failed to copy or move image."));
+                msgBox.critical(tr("Error"), tr("Failed to copy or move image.") + "\n" + error);
             } else {
                 if (!copyMoveToDialog->copyOp) {
                     int currentRow = thumbsViewer->getCurrentRow();
@@ -1610,19 +1681,151 @@ void Phototonic::batchTransform() {
     msgBox.setInformativeText(message);
     msgBox.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
     msgBox.setDefaultButton(QMessageBox::Ok);
-    if (msgBox.exec() == QMessageBox::Ok) {
-        bool keepTransformWas = Settings::keepTransform;
-        imageViewer->batchMode = true;
-        Settings::keepTransform = true;
-        for (QModelIndex i : idxs) {
-            qDebug() << thumbsViewer->model()->data(i, ThumbsViewer::FileNameRole);
-            loadSelectedThumbImage(i);
-            imageViewer->applyCropAndRotation();
-            imageViewer->saveImage();
+    if (msgBox.exec() != QMessageBox::Ok) {
+        return;
+    }
+
+    QStringList imageFullPaths;
+    QList<int> rows;
+    for (const QModelIndex &index : idxs) {
+        imageFullPaths.append(thumbsViewer->model()->data(index, ThumbsViewer::FileNameRole).toString());
+        rows.append(index.row());
+    }
+
+    // Edits made in the viewer while the job runs do not change what it applies
+    ImageEdits edits = ImageEdits::current(imageViewer->mirrorLayout);
+    edits.applyColors = !edits.colorsUnchanged();
+    MetadataCache *cache = metadataCache;
+    Job *transformJob = new Job(tr("Transform %n image(s)", "", imageFullPaths.size()), imageFullPaths.size(),
+                                [imageFullPaths, edits, cache](int item, QString &error) {
+        FileLock fileLock(imageFullPaths.at(item));
+        return ImageViewer::transformImageFile(imageFullPaths.at(item), edits, cache, error);
+    });
+
+    connect(transformJob, &Job::itemFinished, this,
+            [this, imageFullPaths, rows, edits](int item, bool succeeded, const QString &error) {
+        const QString &imageFullPath = imageFullPaths.at(item);
+        if (!succeeded) {
+            qWarning() << tr("Failed to transform image:") << imageFullPath << error;
+            return;
+        }
+
+        int row = rows.at(item);
+        if (edits.saveDirectory.isEmpty() && row < thumbsViewer->thumbsViewerModel->rowCount()
+            && thumbsViewer->thumbsViewerModel->item(row)->data(thumbsViewer->FileNameRole).toString() == imageFullPath) {
+            thumbsViewer->reloadThumb(row);
+        }
+    });
+    connect(transformJob, &Job::finished, this, [this, transformJob]() {
+        if (transformJob->failedItems()) {
+            MessageBox msgBox(this);
+            msgBox.critical(tr("Error"), tr("Failed to transform %n image(s).", "", transformJob->failedItems()));
         }
-        Settings::keepTransform = keepTransformWas;
-        imageViewer->batchMode = false;
+
+        thumbsViewer->onSelectionChanged();
+        setStatus(tr("Transformed") + " " + tr("%n image(s)", "",
+                                              transformJob->progress()->doneItems() - transformJob->failedItems()));
+    });
+
+    jobScheduler->submit(transformJob);
+    setStatus(transformJob->title());
+}
+
+void Phototonic::rotateOrientationLeft() {
+    rotateOrientation(ImageTransforms::Rotate270);
+}
+
+void Phototonic::rotateOrientationRight() {
+    rotateOrientation(ImageTransforms::Rotate90);
+}
+
+/*
+ * Rotates the selected images by rewriting only their Exif orientation tag, the pixels are not
+ * touched. The tags are written by a job, thumbnails that are already loaded are rotated in memory
+ * as each image is done.
+ */
+void Phototonic::rotateOrientation(int rotation) {
+    QModelIndexList indexList = thumbsViewer->selectionModel()->selectedIndexes();
+    if (indexList.isEmpty()) {
+        setStatus(tr("No selection"));
+        return;
     }
+
+    if (Settings::slideShowActive) {
+        toggleSlideShow();
+    }
+
+    QStringList imageFullPaths;
+    QList<int> rows;
+    for (const QModelIndex &index : indexList) {
+        imageFullPaths.append(thumbsViewer->thumbsViewerModel->item(index.row())->data(
+                thumbsViewer->FileNameRole).toString());
+        rows.append(index.row());
+    }
+
+    // The work runs on worker threads, which only use the thread safe metadata cache
+    MetadataCache *metadataCache = this->metadataCache;
+    bool toSidecar = Settings::saveMetadataToSidecar;
+    Job *rotateJob = new Job(tr("Rotate %n image(s)", "", imageFullPaths.size()), imageFullPaths.size(),
+                             [imageFullPaths, rotation, toSidecar, metadataCache](int item, QString &error) {
+        const QString &imageFullPath = imageFullPaths.at(item);
+        // Rotations commute, but each one has to read the orientation the one before it wrote
+        FileLock fileLock(imageFullPath);
+        long orientation = metadataCache->getImageOrientation(imageFullPath);
+        if (orientation < ImageTransforms::Normal || orientation > ImageTransforms::Rotate270) {
+            orientation = ImageTransforms::Normal;
+        }
+        int newOrientation = ImageTransforms::orientationFromMatrix(
+                ImageTransforms::orientationMatrix(orientation) * ImageTransforms::orientationMatrix(rotation));
+
+        if (toSidecar) {
+            XmpSidecar::writeOrientation(imageFullPath, newOrientation, error);
+        } else {
+            try {
+                Exiv2::Image::AutoPtr image = Exiv2::ImageFactory::open(imageFullPath.toStdString());
+                image->readMetadata();
+                image->exifData()["Exif.Image.Orientation"] = static_cast<uint16_t>(newOrientation);
+                image->writeMetadata();
+            }
+            catch (Exiv2::Error &exiv2Error) {
+                error = QString::fromUtf8(exiv2Error.what());
+            }
+        }
+        if (!error.isEmpty()) {
+            return false;
+        }
+
+        metadataCache->setImageOrientation(imageFullPath, newOrientation);
+        return true;
+    }, Job::HighPriority);
+
+    connect(rotateJob, &Job::itemFinished, this,
+            [this, imageFullPaths, rows, rotation](int item, bool succeeded, const QString &error) {
+        const QString &imageFullPath = imageFullPaths.at(item);
+        if (!succeeded) {
+            qWarning() << tr("Failed to write orientation:") << imageFullPath << error;
+            return;
+        }
+
+        int row = rows.at(item);
+        if (Settings::exifThumbRotationEnabled && row < thumbsViewer->thumbsViewerModel->rowCount()
+            && thumbsViewer->thumbsViewerModel->item(row)->data(thumbsViewer->FileNameRole).toString() == imageFullPath) {
+            thumbsViewer->rotateThumb(row, rotation);
+        }
+    });
+    connect(rotateJob, &Job::finished, this, [this, rotateJob]() {
+        if (rotateJob->failedItems()) {
+            MessageBox msgBox(this);
+            msgBox.critical(tr("Error"), tr("Failed to write the orientation of %n image(s).", "",
+                                            rotateJob->failedItems()));
+        }
+
+        thumbsViewer->onSelectionChanged();
+        setStatus(tr("Rotated") + " " + tr("%n image(s)", "",
+                                          rotateJob->progress()->doneItems() - rotateJob->failedItems()));
+    });
+
+    jobScheduler->submit(rotateJob);
 }
 
 void Phototonic::showColorsDialog() {
@@ -1734,15 +1937,45 @@ void Phototonic::pasteThumbs() {
         }
     }
 
-    CopyMoveDialog *copyMoveDialog = new CopyMoveDialog(this);
-    copyMoveDialog->exec(thumbsViewer, destDir, pasteInCurrDir);
-    if (pasteInCurrDir) {
-        for (int thumb = 0; thumb < Settings::copyCutFileList.size(); ++thumb) {
-            thumbsViewer->addThumb(Settings::copyCutFileList[thumb]);
+    transferFiles(Settings::copyCutFileList, destDir, Settings::isCopyOperation);
+    selectCurrentViewDir();
+
+    copyCutThumbsCount = 0;
+    Settings::copyCutIndexList.clear();
+    Settings::copyCutFileList.clear();
+    pasteAction->setEnabled(false);
+
+    thumbsViewer->loadVisibleThumbs();
+}
+
+/*
+ * Copies or moves the files in the background. The view is updated once the job is done, with the
+ * directory it shows by then.
+ */
+void Phototonic::transferFiles(const QStringList &sourceFiles, const QString &destDir, bool isCopy) {
+    FileTransfer *transfer = new FileTransfer(this, sourceFiles, destDir, isCopy);
+    connect(transfer, &FileTransfer::finished, this, [this, transfer](bool canceled) {
+        onFileTransferFinished(transfer, canceled);
+    });
+    transfer->start(jobScheduler);
+
+    Job *transferJob = transfer->job();
+    connect(transferJob->progress(), &ProgressReporter::updated, this, [this, transferJob, isCopy]() {
+        QString state = (isCopy ? tr("Copying %1 of %2") : tr("Moving %1 of %2"))
+                .arg(transferJob->progress()->doneItems()).arg(transferJob->itemCount());
+        QString rate = transferJob->progress()->rateText();
+        if (!rate.isEmpty()) {
+            state += " (" + rate + ")";
         }
-    } else {
-        int row = copyMoveDialog->latestRow;
-        if (thumbsViewer->thumbsViewerModel->rowCount()) {
+        setStatus(state);
+    });
+}
+
+void Phototonic::onFileTransferFinished(FileTransfer *transfer, bool canceled) {
+    QStringList sourceFiles = transfer->transferredSources();
+    if (!transfer->isCopy()) {
+        int row = thumbsViewer->removeThumbs(sourceFiles.toSet());
+        if (row >= 0 && thumbsViewer->thumbsViewerModel->rowCount()) {
             if (row >= thumbsViewer->thumbsViewerModel->rowCount()) {
                 row = thumbsViewer->thumbsViewerModel->rowCount() - 1;
             }
@@ -1752,17 +1985,35 @@ void Phototonic::pasteThumbs() {
         }
     }
 
-    QString state = QString((Settings::isCopyOperation ? tr("Copied") : tr("Moved")) + " " +
-                            tr("%n image(s)", "", copyMoveDialog->nFiles));
+    if (!Settings::isFileListLoaded && QDir(transfer->destinationDir()) == QDir(Settings::currentDirectory)) {
+        QSet<QString> shownFiles;
+        for (int row = 0; row < thumbsViewer->thumbsViewerModel->rowCount(); ++row) {
+            shownFiles.insert(thumbsViewer->thumbsViewerModel->item(row)->data(thumbsViewer->FileNameRole).toString());
+        }
+
+        QStringList destFiles = transfer->transferredDestinations();
+        for (int file = 0; file < destFiles.size(); ++file) {
+            if (!shownFiles.contains(destFiles[file])) {
+                thumbsViewer->addThumb(destFiles[file]);
+            }
+        }
+    }
+
+    QString state = QString((transfer->isCopy() ? tr("Copied") : tr("Moved")) + " " +
+                            tr("%n image(s)", "", sourceFiles.size()));
+    if (canceled) {
+        state += " (" + tr("canceled") + ")";
+    }
     setStatus(state);
-    copyMoveDialog->deleteLater();
-    selectCurrentViewDir();
 
-    copyCutThumbsCount = 0;
-    Settings::copyCutIndexList.clear();
-    Settings::copyCutFileList.clear();
-    pasteAction->setEnabled(false);
+    QStringList failedFiles = transfer->failedFiles();
+    if (!failedFiles.isEmpty()) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("Failed to copy or move %n image(s):", "", failedFiles.size())
+                                     + "\n" + failedFiles.mid(0, 10).join("\n"));
+    }
 
+    transfer->deleteLater();
     thumbsViewer->loadVisibleThumbs();
 }
 
@@ -1796,8 +2047,9 @@ void Phototonic::loadCurrentImage(int currentRow) {
 }
 
 void Phototonic::deleteImages(bool trash) {
-    // Deleting selected thumbnails
-    if (thumbsViewer->selectionModel()->selectedIndexes().size() < 1) {
+    // One snapshot of the selection, the view may change while the job runs
+    QModelIndexList indexList = thumbsViewer->selectionModel()->selectedIndexes();
+    if (indexList.isEmpty()) {
         setStatus(tr("No selection"));
         return;
     }
@@ -1817,85 +2069,94 @@ void Phototonic::deleteImages(bool trash) {
         }
     }
 
-    // To only show progress dialog if deleting actually takes time
-    QElapsedTimer timer;
-    timer.start();
-
-    // Avoid a lot of not interesting updates while deleting
-    QSignalBlocker fsBlocker(fileSystemTree->fileSystemModel);
-    QSignalBlocker scrollbarBlocker(thumbsViewer->verticalScrollBar());
-
-    // Avoid reloading thumbnails all the time
-    thumbsViewer->isBusy = true;
-
-    ProgressDialog *progressDialog = new ProgressDialog(this);
-
-    int deleteFilesCount = 0;
-    bool deleteOk;
-    QList<int> rows;
-    int row;
-    QModelIndexList indexesList;
-    while ((indexesList = thumbsViewer->selectionModel()->selectedIndexes()).size()) {
-        QString fileNameFullPath = thumbsViewer->thumbsViewerModel->item(
-                indexesList.first().row())->data(thumbsViewer->FileNameRole).toString();
-
-        // Only show if it takes a lot of time, since popping this up for just
-        // deleting a single image is annoying
-        if (timer.elapsed() > 100) {
-            progressDialog->opLabel->setText("Deleting " + fileNameFullPath);
-            progressDialog->show();
-        }
+    QStringList imageFullPaths;
+    for (const QModelIndex &index : indexList) {
+        imageFullPaths.append(thumbsViewer->thumbsViewerModel->item(index.row())->data(
+                thumbsViewer->FileNameRole).toString());
+    }
 
-        QString deleteError;
+    // Written by the workers, one slot per image
+    QSharedPointer<QVector<bool>> results(new QVector<bool>(imageFullPaths.size(), false));
+    bool *deleteResults = results->data();
+    QString title = trash ? tr("Move %n image(s) to the trash", "", imageFullPaths.size())
+                          : tr("Delete %n image(s)", "", imageFullPaths.size());
+    Job *deleteJob = new Job(title, imageFullPaths.size(),
+                             [imageFullPaths, trash, deleteResults](int item, QString &error) {
+        const QString &imageFullPath = imageFullPaths.at(item);
         if (trash) {
-            deleteOk = Trash::moveToTrash(fileNameFullPath, deleteError) == Trash::Success;
+            deleteResults[item] = Trash::moveToTrash(imageFullPath, error) == Trash::Success;
         } else {
-            QFile fileToRemove(fileNameFullPath);
-            deleteOk = fileToRemove.remove();
-            if (!deleteOk) {
-                deleteError = fileToRemove.errorString();
+            QFile fileToRemove(imageFullPath);
+            deleteResults[item] = fileToRemove.remove();
+            if (!deleteResults[item]) {
+                error = fileToRemove.errorString();
             }
         }
-
-        ++deleteFilesCount;
-        if (deleteOk) {
-            row = indexesList.first().row();
-            rows << row;
-            thumbsViewer->thumbsViewerModel->removeRow(row);
-        } else {
-            MessageBox msgBox(this);
-            msgBox.critical(tr("Error"),
-                            (trash ? tr("Failed to move image to the trash.") : tr("Failed to delete image.")) + "\n" +
-                            deleteError);
-            break;
+        return deleteResults[item];
+    });
+    deleteJob->setMaxParallelItems(MaxDeleteThreads);
+
+    QSharedPointer<QStringList> failedImages(new QStringList);
+    connect(deleteJob, &Job::itemFinished, this,
+            [imageFullPaths, failedImages](int item, bool succeeded, const QString &error) {
+        if (!succeeded) {
+            failedImages->append(imageFullPaths.at(item) + ": " + error);
+        }
+    });
+    connect(deleteJob, &Job::finished, this, [this, imageFullPaths, results, failedImages]() {
+        // Items that finished after a cancel are only known from their results
+        QSet<QString> deletedImages;
+        for (int item = 0; item < imageFullPaths.size(); ++item) {
+            if (results->at(item)) {
+                deletedImages.insert(imageFullPaths.at(item));
+            }
         }
+        onImagesDeleted(deletedImages, *failedImages);
+    });
 
-        Settings::filesList.removeOne(fileNameFullPath);
+    jobScheduler->submit(deleteJob);
+    setStatus(title);
+}
 
-        if (progressDialog->abortOp) {
-            break;
+/*
+ * Takes the deleted images out of the view and the loaded file list in one pass each, instead of
+ * one model update and one list search per image.
+ */
+void Phototonic::onImagesDeleted(const QSet<QString> &deletedImages, const QStringList &failedImages) {
+    if (!deletedImages.isEmpty()) {
+        QStringList remainingFiles;
+        remainingFiles.reserve(Settings::filesList.size());
+        for (const QString &fileFullPath : Settings::filesList) {
+            if (!deletedImages.contains(fileFullPath)) {
+                remainingFiles.append(fileFullPath);
+            }
         }
-    }
+        Settings::filesList = remainingFiles;
 
-    if (thumbsViewer->thumbsViewerModel->rowCount() && rows.count()) {
-        std::sort(rows.begin(), rows.end());
-        row = rows.at(0);
+        // Avoid reloading thumbnails for every removed range
+        QSignalBlocker scrollbarBlocker(thumbsViewer->verticalScrollBar());
+        thumbsViewer->isBusy = true;
+        int row = thumbsViewer->removeThumbs(deletedImages);
+        thumbsViewer->isBusy = false;
 
-        if (row >= thumbsViewer->thumbsViewerModel->rowCount()) {
-            row = thumbsViewer->thumbsViewerModel->rowCount() - 1;
-        }
+        if (row >= 0 && thumbsViewer->thumbsViewerModel->rowCount()) {
+            if (row >= thumbsViewer->thumbsViewerModel->rowCount()) {
+                row = thumbsViewer->thumbsViewerModel->rowCount() - 1;
+            }
 
-        thumbsViewer->setCurrentRow(row);
-        thumbsViewer->selectThumbByRow(row);
+            thumbsViewer->setCurrentRow(row);
+            thumbsViewer->selectThumbByRow(row);
+        }
+        thumbsViewer->loadVisibleThumbs();
     }
 
-    progressDialog->close();
-    progressDialog->deleteLater();
-
-    QString state = QString(tr("Deleted") + " " + tr("%n image(s)", "", deleteFilesCount));
-    setStatus(state);
+    setStatus(tr("Deleted") + " " + tr("%n image(s)", "", deletedImages.size()));
 
-    thumbsViewer->isBusy = false;
+    if (!failedImages.isEmpty()) {
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("Failed to delete %n image(s):", "", failedImages.size())
+                                     + "\n" + failedImages.mid(0, 10).join("\n"));
+    }
 }
 
 void Phototonic::deleteFromViewer(bool trash) {
@@ -2129,6 +2390,7 @@ void Phototonic::writeSettings() {
     Settings::appSettings->setValue(Settings::optionExifRotationEnabled, (bool) Settings::exifRotationEnabled);
     Settings::appSettings->setValue(Settings::optionExifThumbRotationEnabled,
                                     (bool) Settings::exifThumbRotationEnabled);
+    Settings::appSettings->setValue(Settings::optionSaveMetadataToSidecar, (bool) Settings::saveMetadataToSidecar);
     Settings::appSettings->setValue(Settings::optionReverseMouseBehavior, (bool) Settings::reverseMouseBehavior);
     Settings::appSettings->setValue(Settings::optionDeleteConfirm, (bool) Settings::deleteConfirm);
     Settings::appSettings->setValue(Settings::optionShowHiddenFiles, (bool) Settings::showHiddenFiles);
@@ -2138,12 +2400,17 @@ void Phototonic::writeSettings() {
     Settings::appSettings->setValue(Settings::optionDefaultSaveQuality, Settings::defaultSaveQuality);
     Settings::appSettings->setValue(Settings::optionSlideShowDelay, Settings::slideShowDelay);
     Settings::appSettings->setValue(Settings::optionSlideShowRandom, (bool) Settings::slideShowRandom);
+    Settings::appSettings->setValue(Settings::optionDuplicatesMaxDistance, Settings::duplicatesMaxDistance);
+    Settings::appSettings->setValue(Settings::optionDuplicatesExactOnly, (bool) Settings::duplicatesExactOnly);
+    Settings::appSettings->setValue(Settings::optionDuplicatesHashAlgorithm, Settings::duplicatesHashAlgorithm);
+    Settings::appSettings->setValue(Settings::optionDuplicatesReferencePaths, Settings::duplicatesReferencePaths);
     Settings::appSettings->setValue(Settings::optionEditToolBarVisible, (bool) editToolBarVisible);
     Settings::appSettings->setValue(Settings::optionGoToolBarVisible, (bool) goToolBarVisible);
     Settings::appSettings->setValue(Settings::optionViewToolBarVisible, (bool) viewToolBarVisible);
     Settings::appSettings->setValue(Settings::optionImageToolBarVisible, (bool) imageToolBarVisible);
     Settings::appSettings->setValue(Settings::optionFileSystemDockVisible, (bool) Settings::fileSystemDockVisible);
     Settings::appSettings->setValue(Settings::optionImageInfoDockVisible, (bool) Settings::imageInfoDockVisible);
+    Settings::appSettings->setValue(Settings::optionJobsDockVisible, (bool) Settings::jobsDockVisible);
     Settings::appSettings->setValue(Settings::optionBookmarksDockVisible, (bool) Settings::bookmarksDockVisible);
     Settings::appSettings->setValue(Settings::optionTagsDockVisible, (bool) Settings::tagsDockVisible);
     Settings::appSettings->setValue(Settings::optionImagePreviewDockVisible, (bool) Settings::imagePreviewDockVisible);
@@ -2192,7 +2459,9 @@ void Phototonic::writeSettings() {
     idx = 0;
     Settings::appSettings->beginGroup(Settings::optionKnownTags);
     Settings::appSettings->remove("");
+    QMutexLocker locker(&Settings::knownTagsMutex);
     QSetIterator<QString> tagsIter(Settings::knownTags);
+    locker.unlock();
     while (tagsIter.hasNext()) {
         Settings::appSettings->setValue("tag" + QString::number(++idx), tagsIter.next());
     }
@@ -2221,11 +2490,15 @@ void Phototonic::readSettings() {
         Settings::appSettings->setValue(Settings::optionEnableAnimations, (bool) true);
         Settings::appSettings->setValue(Settings::optionExifRotationEnabled, (bool) true);
         Settings::appSettings->setValue(Settings::optionExifThumbRotationEnabled, (bool) false);
+        Settings::appSettings->setValue(Settings::optionSaveMetadataToSidecar, (bool) false);
         Settings::appSettings->setValue(Settings::optionReverseMouseBehavior, (bool) false);
         Settings::appSettings->setValue(Settings::optionDeleteConfirm, (bool) true);
         Settings::appSettings->setValue(Settings::optionShowHiddenFiles, (bool) false);
         Settings::appSettings->setValue(Settings::optionSlideShowDelay, (int) 5);
         Settings::appSettings->setValue(Settings::optionSlideShowRandom, (bool) false);
+        Settings::appSettings->setValue(Settings::optionDuplicatesMaxDistance, (int) 0);
+        Settings::appSettings->setValue(Settings::optionDuplicatesExactOnly, (bool) false);
+        Settings::appSettings->setValue(Settings::optionDuplicatesHashAlgorithm, (int) ImageHash::DifferenceHash64);
         Settings::appSettings->setValue(Settings::optionEditToolBarVisible, (bool) true);
         Settings::appSettings->setValue(Settings::optionGoToolBarVisible, (bool) true);
         Settings::appSettings->setValue(Settings::optionViewToolBarVisible, (bool) true);
@@ -2235,6 +2508,7 @@ void Phototonic::readSettings() {
         Settings::appSettings->setValue(Settings::optionTagsDockVisible, (bool) true);
         Settings::appSettings->setValue(Settings::optionImagePreviewDockVisible, (bool) true);
         Settings::appSettings->setValue(Settings::optionImageInfoDockVisible, (bool) true);
+        Settings::appSettings->setValue(Settings::optionJobsDockVisible, (bool) false);
         Settings::appSettings->setValue(Settings::optionShowImageName, (bool) false);
         Settings::appSettings->setValue(Settings::optionSmallToolbarIcons, (bool) false);
         Settings::appSettings->setValue(Settings::optionHideDockTitlebars, (bool) false);
@@ -2253,6 +2527,7 @@ void Phototonic::readSettings() {
     Settings::exifRotationEnabled = Settings::appSettings->value(Settings::optionExifRotationEnabled).toBool();
     Settings::exifThumbRotationEnabled = Settings::appSettings->value(
             Settings::optionExifThumbRotationEnabled).toBool();
+    Settings::saveMetadataToSidecar = Settings::appSettings->value(Settings::optionSaveMetadataToSidecar).toBool();
     Settings::thumbsLayout = Settings::appSettings->value(
             Settings::optionThumbsLayout).toInt();
     Settings::reverseMouseBehavior = Settings::appSettings->value(Settings::optionReverseMouseBehavior).toBool();
@@ -2270,6 +2545,13 @@ void Phototonic::readSettings() {
     Settings::defaultSaveQuality = Settings::appSettings->value(Settings::optionDefaultSaveQuality).toInt();
     Settings::slideShowDelay = Settings::appSettings->value(Settings::optionSlideShowDelay).toInt();
     Settings::slideShowRandom = Settings::appSettings->value(Settings::optionSlideShowRandom).toBool();
+    Settings::duplicatesMaxDistance = qBound(0, Settings::appSettings->value(
+            Settings::optionDuplicatesMaxDistance).toInt(), 64);
+    Settings::duplicatesExactOnly = Settings::appSettings->value(Settings::optionDuplicatesExactOnly).toBool();
+    Settings::duplicatesHashAlgorithm = qBound((int) ImageHash::DifferenceHash64, Settings::appSettings->value(
+            Settings::optionDuplicatesHashAlgorithm).toInt(), (int) ImageHash::BlockMeanHash);
+    Settings::duplicatesReferencePaths = Settings::appSettings->value(
+            Settings::optionDuplicatesReferencePaths).toStringList();
     Settings::slideShowActive = false;
     editToolBarVisible = Settings::appSettings->value(Settings::optionEditToolBarVisible).toBool();
     goToolBarVisible = Settings::appSettings->value(Settings::optionGoToolBarVisible).toBool();
@@ -2280,6 +2562,7 @@ void Phototonic::readSettings() {
     Settings::tagsDockVisible = Settings::appSettings->value(Settings::optionTagsDockVisible).toBool();
     Settings::imagePreviewDockVisible = Settings::appSettings->value(Settings::optionImagePreviewDockVisible).toBool();
     Settings::imageInfoDockVisible = Settings::appSettings->value(Settings::optionImageInfoDockVisible).toBool();
+    Settings::jobsDockVisible = Settings::appSettings->value(Settings::optionJobsDockVisible).toBool();
     Settings::startupDir = (Settings::StartupDir) Settings::appSettings->value(Settings::optionStartupDir).toInt();
     Settings::specifiedStartDir = Settings::appSettings->value(Settings::optionSpecifiedStartDir).toString();
     Settings::thumbsBackgroundImage = Settings::appSettings->value(Settings::optionThumbsBackgroundImage).toString();
@@ -2308,9 +2591,11 @@ void Phototonic::readSettings() {
     /* read known tags */
     Settings::appSettings->beginGroup(Settings::optionKnownTags);
     QStringList tags = Settings::appSettings->childKeys();
+    QMutexLocker locker(&Settings::knownTagsMutex);
     for (int i = 0; i < tags.size(); ++i) {
         Settings::knownTags.insert(Settings::appSettings->value(tags.at(i)).toString());
     }
+    locker.unlock();
     Settings::appSettings->endGroup();
 
     Settings::isFileListLoaded = false;
@@ -2331,11 +2616,13 @@ void Phototonic::setupDocks() {
     imagePreviewDockOrigWidget = imagePreviewDock->titleBarWidget();
     tagsDockOrigWidget = tagsDock->titleBarWidget();
     imageInfoDockOrigWidget = imageInfoDock->titleBarWidget();
+    jobsDockOrigWidget = jobsDock->titleBarWidget();
     fileSystemDockEmptyWidget = new QWidget;
     bookmarksDockEmptyWidget = new QWidget;
     imagePreviewDockEmptyWidget = new QWidget;
     tagsDockEmptyWidget = new QWidget;
     imageInfoDockEmptyWidget = new QWidget;
+    jobsDockEmptyWidget = new QWidget;
     lockDocks();
 }
 
@@ -2349,12 +2636,14 @@ void Phototonic::lockDocks() {
         imagePreviewDock->setTitleBarWidget(imagePreviewDockEmptyWidget);
         tagsDock->setTitleBarWidget(tagsDockEmptyWidget);
         imageInfoDock->setTitleBarWidget(imageInfoDockEmptyWidget);
+        jobsDock->setTitleBarWidget(jobsDockEmptyWidget);
     } else {
         fileSystemDock->setTitleBarWidget(fileSystemDockOrigWidget);
         bookmarksDock->setTitleBarWidget(bookmarksDockOrigWidget);
         imagePreviewDock->setTitleBarWidget(imagePreviewDockOrigWidget);
         tagsDock->setTitleBarWidget(tagsDockOrigWidget);
         imageInfoDock->setTitleBarWidget(imageInfoDockOrigWidget);
+        jobsDock->setTitleBarWidget(jobsDockOrigWidget);
     }
 }
 
@@ -2432,6 +2721,8 @@ void Phototonic::loadShortcuts() {
     Settings::actionKeys[createDirectoryAction->objectName()] = createDirectoryAction;
     Settings::actionKeys[addBookmarkAction->objectName()] = addBookmarkAction;
     Settings::actionKeys[removeMetadataAction->objectName()] = removeMetadataAction;
+    Settings::actionKeys[rotateOrientationLeftAction->objectName()] = rotateOrientationLeftAction;
+    Settings::actionKeys[rotateOrientationRightAction->objectName()] = rotateOrientationRightAction;
     Settings::actionKeys[externalAppsAction->objectName()] = externalAppsAction;
     Settings::actionKeys[goHomeAction->objectName()] = goHomeAction;
     Settings::actionKeys[sortByNameAction->objectName()] = sortByNameAction;
@@ -2526,7 +2817,10 @@ void Phototonic::loadShortcuts() {
 
 void Phototonic::closeEvent(QCloseEvent *event) {
     thumbsViewer->abort();
+    thumbsViewer->imageTags->tagWriteQueue->waitForDone();
+    jobScheduler->waitForDone();
     writeSettings();
+    metadataCache->sync();
     hide();
     if (!QApplication::clipboard()->image().isNull()) {
         QApplication::clipboard()->clear();
@@ -2619,6 +2913,7 @@ void Phototonic::setDocksVisibility(bool visible) {
     imagePreviewDock->setVisible(visible ? Settings::imagePreviewDockVisible : false);
     tagsDock->setVisible(visible ? Settings::tagsDockVisible : false);
     imageInfoDock->setVisible(visible ? Settings::imageInfoDockVisible : false);
+    jobsDock->setVisible(visible ? Settings::jobsDockVisible : false);
 
     menuBar()->setVisible(visible);
     menuBar()->setDisabled(!visible);
@@ -2650,15 +2945,16 @@ void Phototonic::viewImage() {
         if (selectedIndexes.size() > 0) {
             selectedImageIndex = selectedIndexes.first();
         } else {
-            if (thumbsViewer->thumbsViewerModel->rowCount() == 0) {
+            int firstRow = thumbsViewer->getFirstRow();
+            if (firstRow < 0) {
                 setStatus(tr("No images"));
                 return;
             }
 
             selectedImageIndex = thumbsViewer->thumbsViewerModel->indexFromItem(
-                    thumbsViewer->thumbsViewerModel->item(0));
+                    thumbsViewer->thumbsViewerModel->item(firstRow));
             thumbsViewer->selectionModel()->select(selectedImageIndex, QItemSelectionModel::Toggle);
-            thumbsViewer->setCurrentRow(0);
+            thumbsViewer->setCurrentRow(firstRow);
         }
 
         loadSelectedThumbImage(selectedImageIndex);
@@ -2718,6 +3014,12 @@ void Phototonic::setImageInfoDockVisibility() {
     }
 }
 
+void Phototonic::setJobsDockVisibility() {
+    if (Settings::layoutMode != ImageViewWidget) {
+        Settings::jobsDockVisible = jobsDock->isVisible();
+    }
+}
+
 void Phototonic::showViewer() {
     if (Settings::layoutMode == ThumbViewWidget) {
         Settings::layoutMode = ImageViewWidget;
@@ -2794,7 +3096,7 @@ void Phototonic::toggleSlideShow() {
         if (Settings::layoutMode == ThumbViewWidget) {
             QModelIndexList indexesList = thumbsViewer->selectionModel()->selectedIndexes();
             if (indexesList.size() != 1) {
-                thumbsViewer->setCurrentRow(0);
+                thumbsViewer->setCurrentRow(thumbsViewer->getFirstRow());
             } else {
                 thumbsViewer->setCurrentRow(indexesList.first().row());
             }
@@ -2830,7 +3132,7 @@ void Phototonic::slideShowHandler() {
                 thumbsViewer->setCurrentRow(thumbsViewer->getNextRow());
             } else {
                 if (Settings::wrapImageList) {
-                    thumbsViewer->setCurrentRow(0);
+                    thumbsViewer->setCurrentRow(thumbsViewer->getFirstRow());
                 } else {
                     toggleSlideShow();
                 }
@@ -2840,14 +3142,14 @@ void Phototonic::slideShowHandler() {
 }
 
 void Phototonic::loadNextImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getFirstRow() < 0) {
         return;
     }
 
     int nextThumb = thumbsViewer->getNextRow();
     if (nextThumb < 0) {
         if (Settings::wrapImageList) {
-            nextThumb = 0;
+            nextThumb = thumbsViewer->getFirstRow();
         } else {
             return;
         }
@@ -2867,7 +3169,7 @@ void Phototonic::loadNextImage() {
 }
 
 void Phototonic::loadPreviousImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    if (thumbsViewer->getFirstRow() < 0) {
         return;
     }
 
@@ -2894,25 +3196,26 @@ void Phototonic::loadPreviousImage() {
 }
 
 void Phototonic::loadFirstImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    int firstRow = thumbsViewer->getFirstRow();
+    if (firstRow < 0) {
         return;
     }
 
-    imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(0)->data(thumbsViewer->FileNameRole).toString());
-    thumbsViewer->setCurrentRow(0);
+    imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(firstRow)->data(thumbsViewer->FileNameRole).toString());
+    thumbsViewer->setCurrentRow(firstRow);
     thumbsViewer->setImageViewerWindowTitle();
 
     if (Settings::layoutMode == ThumbViewWidget) {
-        thumbsViewer->selectThumbByRow(0);
+        thumbsViewer->selectThumbByRow(firstRow);
     }
 }
 
 void Phototonic::loadLastImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    int lastRow = thumbsViewer->getLastRow();
+    if (lastRow < 0) {
         return;
     }
 
-    int lastRow = thumbsViewer->getLastRow();
     imageViewer->loadImage(thumbsViewer->thumbsViewerModel->item(lastRow)->data(thumbsViewer->FileNameRole).toString());
     thumbsViewer->setCurrentRow(lastRow);
     thumbsViewer->setImageViewerWindowTitle();
@@ -2923,11 +3226,11 @@ void Phototonic::loadLastImage() {
 }
 
 void Phototonic::loadRandomImage() {
-    if (thumbsViewer->thumbsViewerModel->rowCount() <= 0) {
+    int randomRow = thumbsViewer->getRandomRow();
+    if (randomRow < 0) {
         return;
     }
 
-    int randomRow = thumbsViewer->getRandomRow();
     imageViewer->loadImage(
             thumbsViewer->thumbsViewerModel->item(randomRow)->data(thumbsViewer->FileNameRole).toString());
     thumbsViewer->setCurrentRow(randomRow);
@@ -3064,26 +3367,12 @@ void Phototonic::dropOp(Qt::KeyboardModifiers keyMods, bool dirOp, QString copyM
             setStatus(tr("Directory moved"));
         }
     } else {
-        CopyMoveDialog *copyMoveDialog = new CopyMoveDialog(this);
-        Settings::copyCutIndexList = thumbsViewer->selectionModel()->selectedIndexes();
-        copyMoveDialog->exec(thumbsViewer, destDir, false);
-
-        if (!Settings::isCopyOperation) {
-            int row = copyMoveDialog->latestRow;
-            if (thumbsViewer->thumbsViewerModel->rowCount()) {
-                if (row >= thumbsViewer->thumbsViewerModel->rowCount()) {
-                    row = thumbsViewer->thumbsViewerModel->rowCount() - 1;
-                }
-
-                thumbsViewer->setCurrentRow(row);
-                thumbsViewer->selectThumbByRow(row);
-            }
+        QStringList sourceFiles;
+        foreach (const QModelIndex &index, thumbsViewer->selectionModel()->selectedIndexes()) {
+            sourceFiles.append(thumbsViewer->thumbsViewerModel->item(index.row())->data(
+                    thumbsViewer->FileNameRole).toString());
         }
-
-        QString stateString = QString((Settings::isCopyOperation ? tr("Copied") : tr("Moved")) + " " +
-                                      tr("%n image(s)", "", copyMoveDialog->nFiles));
-        setStatus(stateString);
-        copyMoveDialog->deleteLater();
+        transferFiles(sourceFiles, destDir, Settings::isCopyOperation);
     }
 
     thumbsViewer->loadVisibleThumbs();
@@ -3181,7 +3470,9 @@ void Phototonic::onReloadThumbs() {
 
 void Phototonic::setThumbsViewerWindowTitle() {
 
-    if (findDupesAction->isChecked()) {
+    if (findDupesAction->isChecked() && !thumbsViewer->dupReferencePaths.isEmpty()) {
+        setWindowTitle(tr("Images in %1 found in reference").arg(Settings::currentDirectory) + " - Phototonic");
+    } else if (findDupesAction->isChecked()) {
         setWindowTitle(tr("Duplicate images in %1").arg(Settings::currentDirectory) + " - Phototonic");
     } else if (Settings::isFileListLoaded) {
         setWindowTitle(tr("Files List") + " - Phototonic");
@@ -3337,26 +3628,65 @@ void Phototonic::removeMetadata() {
     int ret = msgBox.exec();
 
     if (ret == MessageBox::Yes) {
-        for (int file = 0; file < fileList.size(); ++file) {
-            Exiv2::Image::AutoPtr image;
-            try {
-                image = Exiv2::ImageFactory::open(fileList[file].toStdString());
-                image->clearMetadata();
-                image->writeMetadata();
-                metadataCache->removeImage(fileList[file]);
-            }
-            catch (Exiv2::Error &error) {
-                msgBox.critical(tr("Error"), tr("Failed to remove Exif metadata."));
-                return;
-            }
+        // A tag write still queued would put keywords back into a stripped image
+        thumbsViewer->imageTags->tagWriteQueue->waitForDone();
+
+        // Thumbnail rows of the images, checked against the path before use
+        QList<int> rows;
+        for (int thumb = 0; thumb < copyCutThumbsCount; ++thumb) {
+            rows.append(indexList[thumb].row());
         }
 
-        thumbsViewer->onSelectionChanged();
-        QString state = QString(tr("Metadata removed from selected images"));
-        setStatus(state);
+        QSharedPointer<QStringList> failedImages(new QStringList);
+        Job *stripJob = MetadataStripper::createJob(fileList);
+        connect(stripJob, &Job::itemFinished, this,
+                [this, fileList, rows, failedImages](int item, bool succeeded, const QString &error) {
+            if (succeeded) {
+                onImageMetadataStripped(fileList.at(item), rows.at(item));
+            } else {
+                qWarning() << "Failed to remove metadata from" << fileList.at(item) << error;
+                failedImages->append(fileList.at(item) + ": " + error);
+            }
+        });
+        connect(stripJob, &Job::finished, this, [this, failedImages](bool canceled) {
+            onMetadataStripFinished(*failedImages, canceled);
+        });
+
+        jobScheduler->submit(stripJob);
+        setStatus(tr("Removing metadata from %n image(s)", "", fileList.size()));
     }
 }
 
+void Phototonic::onImageMetadataStripped(const QString &imageFullPath, int row) {
+    metadataCache->removeImage(imageFullPath);
+    metadataCache->loadImageMetadata(imageFullPath);
+
+    // The orientation is gone as well, so a rotated thumbnail has to be read again
+    if (row >= 0 && row < thumbsViewer->thumbsViewerModel->rowCount()
+        && thumbsViewer->thumbsViewerModel->item(row)->data(thumbsViewer->FileNameRole).toString() == imageFullPath) {
+        thumbsViewer->reloadThumb(row);
+    }
+}
+
+void Phototonic::onMetadataStripFinished(const QStringList &failedImages, bool canceled) {
+    thumbsViewer->imageTags->invalidateTagIndex();
+    if (thumbsViewer->imageTags->dirFilteringActive) {
+        thumbsViewer->imageTags->filterThumbs();
+        thumbsViewer->onThumbsFiltered();
+    }
+    thumbsViewer->onSelectionChanged();
+
+    if (failedImages.isEmpty()) {
+        setStatus(canceled ? tr("Metadata removal canceled") : tr("Metadata removed from selected images"));
+        return;
+    }
+
+    setStatus(tr("Failed to remove metadata from %n image(s)", "", failedImages.size()));
+    MessageBox msgBox(this);
+    msgBox.critical(tr("Error"), tr("Failed to remove metadata from %n image(s):", "", failedImages.size())
+                                 + "\n" + failedImages.mid(0, 10).join("\n"));
+}
+
 void Phototonic::deleteDirectory(bool trash) {
     bool removeDirectoryOk;
     QModelIndexList selectedDirs = fileSystemTree->selectionModel()->selectedRows();
@@ -3577,5 +3907,31 @@ void Phototonic::addBookmark(QString path) {
 
 void Phototonic::findDuplicateImages()
 {
+    thumbsViewer->dupReferencePaths.clear();
+    refreshThumbs(true);
+}
+
+void Phototonic::findDuplicatesInReference() {
+    bool ok;
+    QString referenceText = QInputDialog::getMultiLineText(this, tr("Find Duplicates in Reference"),
+            tr("Directories or saved file lists to compare the current images against, one per line:"),
+            Settings::duplicatesReferencePaths.join('\n'), &ok);
+    if (!ok) {
+        return;
+    }
+
+    QStringList referencePaths;
+    foreach (const QString &line, referenceText.split('\n', QString::SkipEmptyParts)) {
+        if (!line.trimmed().isEmpty()) {
+            referencePaths.append(line.trimmed());
+        }
+    }
+    if (referencePaths.isEmpty()) {
+        return;
+    }
+
+    Settings::duplicatesReferencePaths = referencePaths;
+    thumbsViewer->dupReferencePaths = referencePaths;
+    findDupesAction->setChecked(true);
     refreshThumbs(true);
 }
@@ -29,8 +29,12 @@
 #include "ResizeDialog.h"
 #include "FileListWidget.h"
 #include "FileSystemTree.h"
+#include "MetadataStripper.h"
+#include "JobsPanel.h"
+#include "FileTransfer.h"
 #include <QStackedLayout>
 
+
 #define VERSION "Phototonic v2.1"
 
 class Phototonic : public QMainWindow {
@@ -98,8 +102,20 @@ private slots:
 
     void onReloadThumbs();
 
+    void onTagWriteProgress(int writtenImages, int totalImages);
+
+    void onTagWritesFinished(const QStringList &failedImages);
+
+    void onImageMetadataStripped(const QString &imageFullPath, int row);
+
+    void updateTagWriteStatus();
+
+    void onMetadataStripFinished(const QStringList &failedImages, bool canceled);
+
     void findDuplicateImages();
 
+    void findDuplicatesInReference();
+
     void renameDir();
 
     void setThumbsViewerWindowTitle();
@@ -202,6 +218,10 @@ private slots:
 
     void batchTransform();
 
+    void rotateOrientationLeft();
+
+    void rotateOrientationRight();
+
     void showColorsDialog();
 
     void setMirrorDisabled();
@@ -268,6 +288,8 @@ private slots:
 
     void setImageInfoDockVisibility();
 
+    void setJobsDockVisibility();
+
     void lockDocks();
 
     void cleanupCropDialog();
@@ -408,11 +430,14 @@ private:
     QAction *filterImagesFocusAction;
     QAction *setPathFocusAction;
     QAction *findDupesAction;
+    QAction *findDupesInReferenceAction;
 
     QAction *openWithMenuAction;
     QAction *externalAppsAction;
     QAction *invertSelectionAction;
     QAction *batchTransformAction;
+    QAction *rotateOrientationLeftAction;
+    QAction *rotateOrientationRightAction;
 
     QLineEdit *pathLineEdit;
     QLineEdit *filterLineEdit;
@@ -424,6 +449,7 @@ private:
     FileSystemTree *fileSystemTree;
     BookMarks *bookmarks;
     QDockWidget *imageInfoDock;
+    QDockWidget *jobsDock;
     ThumbsViewer *thumbsViewer;
     ImageViewer *imageViewer;
     QList<QString> pathHistoryList;
@@ -434,13 +460,17 @@ private:
     QWidget *imagePreviewDockOrigWidget;
     QWidget *tagsDockOrigWidget;
     QWidget *imageInfoDockOrigWidget;
+    QWidget *jobsDockOrigWidget;
     QWidget *fileSystemDockEmptyWidget;
     QWidget *bookmarksDockEmptyWidget;
     QWidget *imagePreviewDockEmptyWidget;
     QWidget *tagsDockEmptyWidget;
     QWidget *imageInfoDockEmptyWidget;
+    QWidget *jobsDockEmptyWidget;
     bool interfaceDisabled;
     MetadataCache *metadataCache;
+    JobScheduler *jobScheduler;
+    ProgressReporter *tagWriteProgress;
     FileListWidget *fileListWidget;
     QStackedLayout *stackedLayout;
 
@@ -470,8 +500,16 @@ private:
 
     void deleteImages(bool trash);
 
+    void onImagesDeleted(const QSet<QString> &deletedImages, const QStringList &failedImages);
+
     void deleteFromViewer(bool trash);
 
+    void rotateOrientation(int rotation);
+
+    void transferFiles(const QStringList &sourceFiles, const QString &destDir, bool isCopy);
+
+    void onFileTransferFinished(FileTransfer *transfer, bool canceled);
+
     void loadCurrentImage(int currentRow);
 
     void selectCurrentViewDir();
@@ -502,6 +540,8 @@ private:
 
     void createImageTagsDock();
 
+    void createJobsDock();
+
     void writeSettings();
 
     void readSettings();
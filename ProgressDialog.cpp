@@ -1,43 +0,0 @@
-/*
- *  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
- *  This file is part of Phototonic Image Viewer.
- *
- *  Phototonic is free software: you can redistribute it and/or modify
- *  it under the terms of the GNU General Public License as published by
- *  the Free Software Foundation, either version 3 of the License, or
- *  (at your option) any later version.
- *
- *  Phototonic is distributed in the hope that it will be useful,
- *  but WITHOUT ANY WARRANTY; without even the implied warranty of
- *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- *  GNU General Public License for more details.
- *
- *  You should have received a copy of the GNU General Public License
- *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
- */
-
-#include "ProgressDialog.h"
-
-ProgressDialog::ProgressDialog(QWidget *parent) : QDialog(parent) {
-    opLabel = new QLabel("");
-    abortOp = false;
-
-    cancelButton = new QPushButton(tr("Cancel"));
-    cancelButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-    connect(cancelButton, SIGNAL(clicked()), this, SLOT(abort()));
-
-    QHBoxLayout *topLayout = new QHBoxLayout;
-    topLayout->addWidget(opLabel);
-
-    QHBoxLayout *buttonsLayout = new QHBoxLayout;
-    buttonsLayout->addWidget(cancelButton);
-
-    QVBoxLayout *mainLayout = new QVBoxLayout;
-    mainLayout->addLayout(topLayout);
-    mainLayout->addLayout(buttonsLayout, Qt::AlignRight);
-    setLayout(mainLayout);
-}
-
-void ProgressDialog::abort() {
-    abortOp = true;
-}
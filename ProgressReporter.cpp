@@ -0,0 +1,143 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ProgressReporter.h"
+
+namespace {
+// Rates measured over less time than this jump around too much to show
+const qint64 MinimumRateTime = 500;
+}
+
+ProgressReporter::ProgressReporter(QObject *parent, int refreshInterval) : QObject(parent) {
+    this->refreshInterval = refreshInterval;
+    done = 0;
+    total = 0;
+    bytesDone = 0;
+    bytesTotal = 0;
+    active = false;
+    refreshTimer.setSingleShot(true);
+    connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(emitUpdate()));
+}
+
+void ProgressReporter::start(int totalItems) {
+    refreshTimer.stop();
+    done = 0;
+    total = totalItems;
+    bytesDone = 0;
+    bytesTotal = 0;
+    active = true;
+    elapsedTimer.start();
+    lastUpdateTimer.invalidate();
+}
+
+void ProgressReporter::setTotal(int totalItems) {
+    total = totalItems;
+}
+
+void ProgressReporter::setProgress(int doneItems) {
+    done = doneItems;
+    scheduleUpdate();
+}
+
+void ProgressReporter::setBytes(qint64 doneBytes, qint64 totalBytes) {
+    bytesDone = doneBytes;
+    bytesTotal = totalBytes;
+    scheduleUpdate();
+}
+
+void ProgressReporter::scheduleUpdate() {
+    if (refreshTimer.isActive()) {
+        return;
+    }
+
+    qint64 sinceLastUpdate = lastUpdateTimer.isValid() ? lastUpdateTimer.elapsed() : refreshInterval;
+    if (sinceLastUpdate >= refreshInterval) {
+        emitUpdate();
+    } else {
+        refreshTimer.start(int(refreshInterval - sinceLastUpdate));
+    }
+}
+
+void ProgressReporter::stop() {
+    refreshTimer.stop();
+    active = false;
+}
+
+bool ProgressReporter::isActive() const {
+    return active;
+}
+
+int ProgressReporter::doneItems() const {
+    return done;
+}
+
+int ProgressReporter::totalItems() const {
+    return total;
+}
+
+qreal ProgressReporter::itemsPerSecond() const {
+    if (!elapsedTimer.isValid() || elapsedTimer.elapsed() < MinimumRateTime) {
+        return 0;
+    }
+    return done * 1000.0 / elapsedTimer.elapsed();
+}
+
+qreal ProgressReporter::bytesPerSecond() const {
+    if (!elapsedTimer.isValid() || elapsedTimer.elapsed() < MinimumRateTime) {
+        return 0;
+    }
+    return bytesDone * 1000.0 / elapsedTimer.elapsed();
+}
+
+qint64 ProgressReporter::remainingMsecs() const {
+    if (bytesTotal > 0) {
+        qreal rate = bytesPerSecond();
+        return rate > 0 ? qint64(qMax(qint64(0), bytesTotal - bytesDone) * 1000.0 / rate) : -1;
+    }
+
+    qreal rate = itemsPerSecond();
+    if (rate <= 0 || total <= 0) {
+        return -1;
+    }
+    return qint64(qMax(0, total - done) * 1000.0 / rate);
+}
+
+QString ProgressReporter::rateText() const {
+    qreal rate = itemsPerSecond();
+    if (rate <= 0) {
+        return QString();
+    }
+
+    QString text = tr("%1/s").arg(QString::number(rate, 'f', rate < 10 ? 1 : 0));
+    if (bytesTotal > 0) {
+        qreal megabytesPerSecond = bytesPerSecond() / (1024 * 1024);
+        text = tr("%1 MB/s").arg(QString::number(megabytesPerSecond, 'f', megabytesPerSecond < 10 ? 1 : 0));
+    }
+    qint64 remaining = remainingMsecs();
+    if (remaining >= 0) {
+        QTime remainingTime = QTime(0, 0).addMSecs(int(qMin(remaining, qint64(24 * 3600 * 1000 - 1))));
+        text = tr("%1, %2 left").arg(text)
+                .arg(remainingTime.toString(remaining >= 3600 * 1000 ? "h:mm:ss" : "m:ss"));
+    }
+    return text;
+}
+
+void ProgressReporter::emitUpdate() {
+    lastUpdateTimer.start();
+    emit updated();
+}
@@ -0,0 +1,94 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROGRESS_REPORTER_H
+#define PROGRESS_REPORTER_H
+
+#include <QtWidgets>
+
+/*
+ * Coalesces the progress of long operations to a fixed refresh rate. setProgress() is cheap enough
+ * to call for every item, updated() follows at most once per refresh interval and once more for
+ * the last change, so labels and the status bar are repainted the same number of times for ten
+ * items or a million. The trailing update needs the event loop, loops that run on the GUI thread
+ * have to call QApplication::processEvents() as they already do for their cancel buttons.
+ */
+class ProgressReporter : public QObject {
+Q_OBJECT
+
+public:
+    // About 10 updates per second
+    static const int DefaultRefreshInterval = 100;
+
+    explicit ProgressReporter(QObject *parent, int refreshInterval = DefaultRefreshInterval);
+
+    // Restarts the rate measurement, totalItems is 0 when not known
+    void start(int totalItems);
+
+    // For operations that are extended while they run
+    void setTotal(int totalItems);
+
+    void setProgress(int doneItems);
+
+    // For items of very different sizes, rate and remaining time are then given in bytes
+    void setBytes(qint64 doneBytes, qint64 totalBytes);
+
+    // Drops a pending update, for when the caller shows the final state itself
+    void stop();
+
+    // Between start() and stop()
+    bool isActive() const;
+
+    int doneItems() const;
+
+    int totalItems() const;
+
+    qreal itemsPerSecond() const;
+
+    // 0 unless setBytes() was called
+    qreal bytesPerSecond() const;
+
+    // -1 until the rate is known or when the total is not known
+    qint64 remainingMsecs() const;
+
+    // Rate and remaining time, like "12.5/s, 1:05 left" or "85.3 MB/s, 1:05 left"
+    QString rateText() const;
+
+signals:
+
+    void updated();
+
+private slots:
+
+    void emitUpdate();
+
+private:
+    void scheduleUpdate();
+
+    QTimer refreshTimer;
+    QElapsedTimer elapsedTimer;
+    QElapsedTimer lastUpdateTimer;
+    int refreshInterval;
+    int done;
+    int total;
+    qint64 bytesDone;
+    qint64 bytesTotal;
+    bool active;
+};
+
+#endif // PROGRESS_REPORTER_H
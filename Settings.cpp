@@ -35,6 +35,7 @@ namespace Settings {
     const char optionWrapImageList[] = "wrapImageList";
     const char optionExifRotationEnabled[] = "exifRotationEnabled";
     const char optionExifThumbRotationEnabled[] = "exifThumbRotationEnabled";
+    const char optionSaveMetadataToSidecar[] = "saveMetadataToSidecar";
     const char optionReverseMouseBehavior[] = "reverseMouseBehavior";
     const char optionDeleteConfirm[] = "deleteConfirm";
     const char optionShowHiddenFiles[] = "showHiddenFiles";
@@ -43,6 +44,10 @@ namespace Settings {
     const char optionDefaultSaveQuality[] = "defaultSaveQuality";
     const char optionSlideShowDelay[] = "slideShowDelay";
     const char optionSlideShowRandom[] = "slideShowRandom";
+    const char optionDuplicatesMaxDistance[] = "duplicatesMaxDistance";
+    const char optionDuplicatesExactOnly[] = "duplicatesExactOnly";
+    const char optionDuplicatesHashAlgorithm[] = "duplicatesHashAlgorithm";
+    const char optionDuplicatesReferencePaths[] = "duplicatesReferencePaths";
     const char optionEditToolBarVisible[] = "editToolBarVisible";
     const char optionGoToolBarVisible[] = "goToolBarVisible";
     const char optionViewToolBarVisible[] = "viewToolBarVisible";
@@ -52,6 +57,7 @@ namespace Settings {
     const char optionImagePreviewDockVisible[] = "imagePreviewDockVisible";
     const char optionTagsDockVisible[] = "tagsDockVisible";
     const char optionImageInfoDockVisible[] = "imageInfoDockVisible";
+    const char optionJobsDockVisible[] = "jobsDockVisible";
     const char optionSmallToolbarIcons[] = "smallToolbarIcons";
     const char optionHideDockTitlebars[] = "hideDockTitlebars";
     const char optionStartupDir[] = "startupDir";
@@ -98,6 +104,10 @@ namespace Settings {
     int slideShowDelay;
     bool slideShowRandom;
     bool slideShowActive;
+    int duplicatesMaxDistance;
+    bool duplicatesExactOnly;
+    int duplicatesHashAlgorithm;
+    QStringList duplicatesReferencePaths;
     QMap<QString, QAction *> actionKeys;
     int hueVal;
     int saturationVal;
@@ -117,12 +127,14 @@ namespace Settings {
     bool hueBlueChannel;
     bool exifRotationEnabled;
     bool exifThumbRotationEnabled;
+    bool saveMetadataToSidecar;
     bool includeSubDirectories;
     bool showHiddenFiles;
     bool showViewerToolbar;
     QMap<QString, QString> externalApps;
     QSet<QString> bookmarkPaths;
     QSet<QString> knownTags;
+    QMutex knownTagsMutex;
     bool reverseMouseBehavior;
     bool deleteConfirm;
     QModelIndexList copyCutIndexList;
@@ -141,6 +153,7 @@ namespace Settings {
     bool bookmarksDockVisible;
     bool imagePreviewDockVisible;
     bool imageInfoDockVisible;
+    bool jobsDockVisible;
     QString currentDirectory;
     QString saveDirectory;
     QString thumbsBackgroundImage;
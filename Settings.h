@@ -28,6 +28,7 @@
 #include <QColor>
 #include <QAction>
 #include <QSet>
+#include <QMutex>
 
 namespace Settings {
 
@@ -52,6 +53,7 @@ namespace Settings {
     extern const char optionWrapImageList[];
     extern const char optionExifRotationEnabled[];
     extern const char optionExifThumbRotationEnabled[];
+    extern const char optionSaveMetadataToSidecar[];
     extern const char optionReverseMouseBehavior[];
     extern const char optionDeleteConfirm[];
     extern const char optionShowHiddenFiles[];
@@ -69,6 +71,7 @@ namespace Settings {
     extern const char optionImagePreviewDockVisible[];
     extern const char optionTagsDockVisible[];
     extern const char optionImageInfoDockVisible[];
+    extern const char optionJobsDockVisible[];
     extern const char optionSmallToolbarIcons[];
     extern const char optionHideDockTitlebars[];
     extern const char optionStartupDir[];
@@ -115,6 +118,10 @@ namespace Settings {
     extern int slideShowDelay;
     extern bool slideShowRandom;
     extern bool slideShowActive;
+    extern int duplicatesMaxDistance;
+    extern bool duplicatesExactOnly;
+    extern int duplicatesHashAlgorithm;
+    extern QStringList duplicatesReferencePaths;
     extern QMap<QString, QAction *> actionKeys;
     extern int hueVal;
     extern int saturationVal;
@@ -134,12 +141,15 @@ namespace Settings {
     extern bool hueBlueChannel;
     extern bool exifRotationEnabled;
     extern bool exifThumbRotationEnabled;
+    extern bool saveMetadataToSidecar;
     extern bool includeSubDirectories;
     extern bool showHiddenFiles;
     extern bool showViewerToolbar;
     extern QMap<QString, QString> externalApps;
     extern QSet<QString> bookmarkPaths;
     extern QSet<QString> knownTags;
+    // Metadata parsing may add to knownTags from worker threads
+    extern QMutex knownTagsMutex;
     extern bool reverseMouseBehavior;
     extern bool deleteConfirm;
     extern QModelIndexList copyCutIndexList;
@@ -158,6 +168,7 @@ namespace Settings {
     extern bool imagePreviewDockVisible;
     extern bool tagsDockVisible;
     extern bool imageInfoDockVisible;
+    extern bool jobsDockVisible;
     extern QString currentDirectory;
     extern QString saveDirectory;
     extern QString thumbsBackgroundImage;
@@ -246,6 +246,10 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent) {
     keyboardSettingsLayout->addLayout(filterShortcutsLayout);
     keyboardGroupBox->setLayout(keyboardSettingsLayout);
 
+    // Metadata edits
+    saveToSidecarCheckBox = new QCheckBox(tr("Save tags and orientation changes to XMP sidecar files"), this);
+    saveToSidecarCheckBox->setChecked(Settings::saveMetadataToSidecar);
+
     // Set window icon
     setWindowIconCheckBox = new QCheckBox(tr("Set the application icon according to the current image"), this);
     setWindowIconCheckBox->setChecked(Settings::setWindowIcon);
@@ -253,8 +257,38 @@ SettingsDialog::SettingsDialog(QWidget *parent) : QDialog(parent) {
     QVBoxLayout *generalSettingsLayout = new QVBoxLayout;
     generalSettingsLayout->addWidget(reverseMouseCheckBox);
     generalSettingsLayout->addWidget(deleteConfirmCheckBox);
+    generalSettingsLayout->addWidget(saveToSidecarCheckBox);
     generalSettingsLayout->addWidget(startupDirGroupBox);
 
+    // Duplicate search threshold
+    QLabel *duplicatesDistanceLab = new QLabel(
+            tr("Maximum differing hash bits for similar images (0 matches identical hashes only):"));
+    duplicatesDistanceSpinBox = new QSpinBox;
+    duplicatesDistanceSpinBox->setRange(0, 64);
+    duplicatesDistanceSpinBox->setValue(Settings::duplicatesMaxDistance);
+    QHBoxLayout *duplicatesDistanceLayout = new QHBoxLayout;
+    duplicatesDistanceLayout->addWidget(duplicatesDistanceLab);
+    duplicatesDistanceLayout->addWidget(duplicatesDistanceSpinBox);
+    duplicatesDistanceLayout->addStretch(1);
+    generalSettingsLayout->addLayout(duplicatesDistanceLayout);
+
+    // Order follows ImageHash::Algorithm
+    QLabel *duplicatesHashLab = new QLabel(tr("Hash for similar images:"));
+    duplicatesHashComboBox = new QComboBox;
+    duplicatesHashComboBox->addItem(tr("Difference hash, 64 bits"));
+    duplicatesHashComboBox->addItem(tr("Difference hash, 128 bits"));
+    duplicatesHashComboBox->addItem(tr("DCT hash, 64 bits"));
+    duplicatesHashComboBox->addItem(tr("Block mean hash, 64 bits"));
+    duplicatesHashComboBox->setCurrentIndex(Settings::duplicatesHashAlgorithm);
+    QHBoxLayout *duplicatesHashLayout = new QHBoxLayout;
+    duplicatesHashLayout->addWidget(duplicatesHashLab);
+    duplicatesHashLayout->addWidget(duplicatesHashComboBox);
+    duplicatesHashLayout->addStretch(1);
+    generalSettingsLayout->addLayout(duplicatesHashLayout);
+    duplicatesExactOnlyCheckBox = new QCheckBox(tr("Find byte-identical duplicates only, without decoding images"), this);
+    duplicatesExactOnlyCheckBox->setChecked(Settings::duplicatesExactOnly);
+    generalSettingsLayout->addWidget(duplicatesExactOnlyCheckBox);
+
     // Slide show delay
     QLabel *slideDelayLab = new QLabel(tr("Delay between slides in seconds:"));
     slideDelaySpinBox = new QSpinBox;
@@ -346,12 +380,16 @@ void SettingsDialog::saveSettings() {
     Settings::defaultSaveQuality = saveQualitySpinBox->value();
     Settings::slideShowDelay = slideDelaySpinBox->value();
     Settings::slideShowRandom = slideRandomCheckBox->isChecked();
+    Settings::duplicatesMaxDistance = duplicatesDistanceSpinBox->value();
+    Settings::duplicatesExactOnly = duplicatesExactOnlyCheckBox->isChecked();
+    Settings::duplicatesHashAlgorithm = duplicatesHashComboBox->currentIndex();
     Settings::enableAnimations = enableAnimCheckBox->isChecked();
     Settings::exifRotationEnabled = enableExifCheckBox->isChecked();
     Settings::exifThumbRotationEnabled = enableThumbExifCheckBox->isChecked();
     Settings::showImageName = showImageNameCheckBox->isChecked();
     Settings::reverseMouseBehavior = reverseMouseCheckBox->isChecked();
     Settings::deleteConfirm = deleteConfirmCheckBox->isChecked();
+    Settings::saveMetadataToSidecar = saveToSidecarCheckBox->isChecked();
     Settings::setWindowIcon = setWindowIconCheckBox->isChecked();
 
     if (startupDirectoryRadioButtons[Settings::RememberLastDir]->isChecked()) {
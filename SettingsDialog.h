@@ -64,11 +64,15 @@ private:
     QCheckBox *enableAnimCheckBox;
     QCheckBox *enableExifCheckBox;
     QCheckBox *enableThumbExifCheckBox;
+    QCheckBox *saveToSidecarCheckBox;
     QCheckBox *showImageNameCheckBox;
     QCheckBox *reverseMouseCheckBox;
     QCheckBox *deleteConfirmCheckBox;
     QSpinBox *slideDelaySpinBox;
     QCheckBox *slideRandomCheckBox;
+    QSpinBox *duplicatesDistanceSpinBox;
+    QCheckBox *duplicatesExactOnlyCheckBox;
+    QComboBox *duplicatesHashComboBox;
     QRadioButton *startupDirectoryRadioButtons[3];
     QLineEdit *startupDirLineEdit;
     QLineEdit *thumbsBackgroundImageLineEdit;
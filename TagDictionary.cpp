@@ -0,0 +1,110 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <algorithm>
+#include "TagDictionary.h"
+
+namespace {
+QReadWriteLock dictionaryLock;
+QHash<QString, int> idsByName;
+QVector<QString> namesById;
+}
+
+namespace TagDictionary {
+
+    int intern(const QString &tagName) {
+        {
+            QReadLocker locker(&dictionaryLock);
+            QHash<QString, int>::const_iterator it = idsByName.constFind(tagName);
+            if (it != idsByName.constEnd()) {
+                return it.value();
+            }
+        }
+
+        QWriteLocker locker(&dictionaryLock);
+        QHash<QString, int>::const_iterator it = idsByName.constFind(tagName);
+        if (it != idsByName.constEnd()) {
+            return it.value();
+        }
+
+        const int tagId = namesById.size();
+        namesById.append(tagName);
+        idsByName.insert(tagName, tagId);
+        return tagId;
+    }
+
+    int find(const QString &tagName) {
+        QReadLocker locker(&dictionaryLock);
+        return idsByName.value(tagName, -1);
+    }
+
+    QString name(int tagId) {
+        QReadLocker locker(&dictionaryLock);
+        return tagId >= 0 && tagId < namesById.size() ? namesById.at(tagId) : QString();
+    }
+
+    int size() {
+        QReadLocker locker(&dictionaryLock);
+        return namesById.size();
+    }
+
+    TagIdList intern(const QSet<QString> &tagNames) {
+        TagIdList result;
+        result.reserve(tagNames.size());
+        for (QSet<QString>::const_iterator it = tagNames.constBegin(); it != tagNames.constEnd(); ++it) {
+            result.append(intern(*it));
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    QSet<QString> names(const TagIdList &tagIds) {
+        QSet<QString> result;
+        result.reserve(tagIds.size());
+
+        QReadLocker locker(&dictionaryLock);
+        for (int i = 0; i < tagIds.size(); ++i) {
+            result.insert(namesById.at(tagIds.at(i)));
+        }
+        return result;
+    }
+
+    bool contains(const TagIdList &tagIds, int tagId) {
+        return std::binary_search(tagIds.constBegin(), tagIds.constEnd(), tagId);
+    }
+
+    bool insert(TagIdList &tagIds, int tagId) {
+        TagIdList::iterator it = std::lower_bound(tagIds.begin(), tagIds.end(), tagId);
+        if (it != tagIds.end() && *it == tagId) {
+            return false;
+        }
+        tagIds.insert(it, tagId);
+        return true;
+    }
+
+    bool remove(TagIdList &tagIds, int tagId) {
+        TagIdList::iterator it = std::lower_bound(tagIds.begin(), tagIds.end(), tagId);
+        if (it == tagIds.end() || *it != tagId) {
+            return false;
+        }
+        tagIds.erase(it);
+        return true;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TAG_DICTIONARY_H
+#define TAG_DICTIONARY_H
+
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+// Sorted, duplicate free tag IDs of one image
+typedef QVector<int> TagIdList;
+
+/*
+ * Interns tag names into small dense integer IDs, so per image tags are compact and counting or
+ * matching them is integer work. IDs are stable for the life of the process, names are never
+ * removed. Thread safe.
+ */
+namespace TagDictionary {
+    int intern(const QString &tagName);
+
+    // Returns -1 for a name that was never interned
+    int find(const QString &tagName);
+
+    QString name(int tagId);
+
+    // One past the largest ID handed out so far
+    int size();
+
+    TagIdList intern(const QSet<QString> &tagNames);
+
+    QSet<QString> names(const TagIdList &tagIds);
+
+    bool contains(const TagIdList &tagIds, int tagId);
+
+    // Both return whether the list changed
+    bool insert(TagIdList &tagIds, int tagId);
+
+    bool remove(TagIdList &tagIds, int tagId);
+}
+
+#endif // TAG_DICTIONARY_H
@@ -0,0 +1,168 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <exiv2/exiv2.hpp>
+#include "TagWriteQueue.h"
+#include "XmpSidecar.h"
+#include "JobScheduler.h"
+
+namespace {
+// Writes are mostly I/O, more threads than this only make the disk seek
+const int MaxWriteThreads = 4;
+
+class TagWriteTask : public QRunnable {
+public:
+    TagWriteTask(TagWriteQueue *queue, const QString &imageFullPath, const QSet<QString> &tags, bool toSidecar)
+            : queue(queue), imageFullPath(imageFullPath), tags(tags), toSidecar(toSidecar) {
+    }
+
+    void run() {
+        QString error;
+        bool succeeded;
+        {
+            // Held for the sidecar too, rotation writes the orientation there as well
+            FileLock fileLock(imageFullPath);
+            succeeded = toSidecar ? XmpSidecar::writeTags(imageFullPath, tags, error)
+                                : TagWriteQueue::writeTags(imageFullPath, tags, error);
+        }
+        QMetaObject::invokeMethod(queue, "onWriteFinished", Qt::QueuedConnection,
+                                  Q_ARG(QString, imageFullPath), Q_ARG(bool, succeeded), Q_ARG(QString, error));
+    }
+
+private:
+    TagWriteQueue *queue;
+    QString imageFullPath;
+    QSet<QString> tags;
+    bool toSidecar;
+};
+}
+
+TagWriteQueue::TagWriteQueue(QObject *parent) : QObject(parent) {
+    threadPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount(), MaxWriteThreads));
+    writtenCount = 0;
+    totalCount = 0;
+}
+
+TagWriteQueue::~TagWriteQueue() {
+    waitForDone();
+}
+
+bool TagWriteQueue::writeTags(const QString &imageFullPath, const QSet<QString> &tags, QString &error) {
+    Exiv2::Image::AutoPtr exifImage;
+
+    try {
+        exifImage = Exiv2::ImageFactory::open(imageFullPath.toStdString());
+        exifImage->readMetadata();
+
+        Exiv2::IptcData newIptcData;
+
+        /* copy existing data */
+        Exiv2::IptcData &iptcData = exifImage->iptcData();
+        if (!iptcData.empty()) {
+            Exiv2::IptcData::iterator end = iptcData.end();
+            for (Exiv2::IptcData::iterator iptcIt = iptcData.begin(); iptcIt != end; ++iptcIt) {
+                if (iptcIt->tagName() != "Keywords") {
+                    newIptcData.add(*iptcIt);
+                }
+            }
+        }
+
+        /* add new tags */
+        QSetIterator<QString> tagsIt(tags);
+        while (tagsIt.hasNext()) {
+            Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::string);
+            value->read(tagsIt.next().toStdString());
+            Exiv2::IptcKey key("Iptc.Application2.Keywords");
+            newIptcData.add(key, value.get());
+        }
+
+        exifImage->setIptcData(newIptcData);
+        exifImage->writeMetadata();
+    }
+    catch (Exiv2::Error &exiv2Error) {
+        error = QString::fromUtf8(exiv2Error.what());
+        return false;
+    }
+
+    return true;
+}
+
+void TagWriteQueue::enqueue(const QString &imageFullPath, const QSet<QString> &tags, bool toSidecar) {
+    if (!pendingWrites.contains(imageFullPath)) {
+        pendingOrder.append(imageFullPath);
+        ++totalCount;
+    }
+
+    PendingWrite &pendingWrite = pendingWrites[imageFullPath];
+    pendingWrite.tags = tags;
+    pendingWrite.toSidecar = toSidecar;
+
+    startWrites();
+}
+
+void TagWriteQueue::startWrites() {
+    for (int i = 0; i < pendingOrder.size() && runningWrites.size() < threadPool.maxThreadCount();) {
+        const QString imageFullPath = pendingOrder.at(i);
+
+        // Written again once the running write of the same file finishes
+        if (runningWrites.contains(imageFullPath)) {
+            ++i;
+            continue;
+        }
+
+        pendingOrder.removeAt(i);
+        runningWrites.insert(imageFullPath);
+        PendingWrite pendingWrite = pendingWrites.take(imageFullPath);
+        threadPool.start(new TagWriteTask(this, imageFullPath, pendingWrite.tags, pendingWrite.toSidecar));
+    }
+}
+
+void TagWriteQueue::onWriteFinished(const QString &imageFullPath, bool succeeded, const QString &error) {
+    runningWrites.remove(imageFullPath);
+    ++writtenCount;
+
+    if (!succeeded) {
+        qWarning() << "Failed to save tags to" << imageFullPath << error;
+        failedImages.append(imageFullPath);
+        emit writeFailed(imageFullPath, error);
+    }
+    emit progress(writtenCount, totalCount);
+
+    startWrites();
+
+    if (isIdle()) {
+        QStringList failed = failedImages;
+        failedImages.clear();
+        writtenCount = 0;
+        totalCount = 0;
+        emit finished(failed);
+    }
+}
+
+bool TagWriteQueue::isIdle() const {
+    return pendingWrites.isEmpty() && runningWrites.isEmpty();
+}
+
+void TagWriteQueue::waitForDone() {
+    while (!isIdle()) {
+        threadPool.waitForDone();
+
+        // Delivers the queued completions, which start the remaining writes
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+    }
+}
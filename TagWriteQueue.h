@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TAG_WRITE_QUEUE_H
+#define TAG_WRITE_QUEUE_H
+
+#include <QtWidgets>
+
+/*
+ * Writes IPTC keywords to image files on a thread pool. Each queued entry holds the complete
+ * keyword set a file should end up with, so repeated edits of a file that has not been written
+ * yet collapse into one write, and a file is never written by two threads at once. Writes hold the
+ * FileLock of the image, so they also wait for the jobs that rewrite it, like rotation.
+ * Signals are emitted on the thread that owns the queue.
+ */
+class TagWriteQueue : public QObject {
+Q_OBJECT
+
+public:
+    explicit TagWriteQueue(QObject *parent);
+
+    ~TagWriteQueue();
+
+    // With toSidecar the keywords go to the XMP sidecar of the image instead of its IPTC data
+    void enqueue(const QString &imageFullPath, const QSet<QString> &tags, bool toSidecar);
+
+    bool isIdle() const;
+
+    // Blocks until every queued write is done, used on shutdown
+    void waitForDone();
+
+    static bool writeTags(const QString &imageFullPath, const QSet<QString> &tags, QString &error);
+
+signals:
+
+    void progress(int writtenImages, int totalImages);
+
+    void writeFailed(const QString &imageFullPath, const QString &error);
+
+    // Emitted when the queue drains, with the images that could not be written since it was last idle
+    void finished(const QStringList &failedImages);
+
+private slots:
+
+    void onWriteFinished(const QString &imageFullPath, bool succeeded, const QString &error);
+
+private:
+    struct PendingWrite {
+        QSet<QString> tags;
+        bool toSidecar;
+    };
+
+    void startWrites();
+
+    QThreadPool threadPool;
+    QHash<QString, PendingWrite> pendingWrites;
+    // First-queued first-written, a coalesced edit keeps the position of the original
+    QStringList pendingOrder;
+    QSet<QString> runningWrites;
+    QStringList failedImages;
+    int writtenCount;
+    int totalCount;
+};
+
+#endif // TAG_WRITE_QUEUE_H
@@ -18,8 +18,9 @@
 
 #include "Tags.h"
 #include "Settings.h"
-#include "ProgressDialog.h"
 #include "MessageBox.h"
+#include <algorithm>
+#include <iterator>
 
 ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache *metadataCache) : QWidget(parent) {
     tagsTree = new QTreeWidget;
@@ -31,6 +32,11 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     this->thumbView = thumbsViewer;
     this->metadataCache = metadataCache;
     negateFilterEnabled = false;
+    matchAllTagsEnabled = false;
+    tagIndexValid = false;
+
+    tagWriteQueue = new TagWriteQueue(this);
+    connect(tagWriteQueue, SIGNAL(writeFailed(QString, QString)), this, SLOT(onTagWriteFailed(QString, QString)));
 
     tabs = new QTabBar(this);
     tabs->addTab(tr("Selection"));
@@ -57,6 +63,13 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     tagsTree->setContextMenuPolicy(Qt::CustomContextMenu);
     connect(tagsTree, SIGNAL(customContextMenuRequested(QPoint)), SLOT(showMenu(QPoint)));
 
+    QStandardItemModel *thumbsModel = thumbView->thumbsViewerModel;
+    connect(thumbsModel, SIGNAL(rowsInserted(QModelIndex, int, int)), this, SLOT(invalidateTagIndex()));
+    connect(thumbsModel, SIGNAL(rowsRemoved(QModelIndex, int, int)), this, SLOT(invalidateTagIndex()));
+    connect(thumbsModel, SIGNAL(rowsMoved(QModelIndex, int, int, QModelIndex, int)), this, SLOT(invalidateTagIndex()));
+    connect(thumbsModel, SIGNAL(layoutChanged()), this, SLOT(invalidateTagIndex()));
+    connect(thumbsModel, SIGNAL(modelReset()), this, SLOT(invalidateTagIndex()));
+
     addToSelectionAction = new QAction(tr("Tag"), this);
     addToSelectionAction->setIcon(QIcon(":/images/tag_yellow.png"));
     connect(addToSelectionAction, SIGNAL(triggered()), this, SLOT(addTagsToSelection()));
@@ -79,6 +92,10 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     negateAction->setCheckable(true);
     connect(negateAction, SIGNAL(triggered()), this, SLOT(negateFilter()));
 
+    matchAllAction = new QAction(tr("Match All Tags"), this);
+    matchAllAction->setCheckable(true);
+    connect(matchAllAction, SIGNAL(triggered()), this, SLOT(matchAllTags()));
+
     tagsMenu = new QMenu("");
     tagsMenu->addAction(addToSelectionAction);
     tagsMenu->addAction(removeFromSelectionAction);
@@ -88,6 +105,7 @@ ImageTags::ImageTags(QWidget *parent, ThumbsViewer *thumbsViewer, MetadataCache
     tagsMenu->addSeparator();
     tagsMenu->addAction(actionClearTagsFilter);
     tagsMenu->addAction(negateAction);
+    tagsMenu->addAction(matchAllAction);
 }
 
 void ImageTags::redrawTagTree() {
@@ -129,55 +147,12 @@ void ImageTags::setTagIcon(QTreeWidgetItem *tagItem, TagIcons icon) {
 void ImageTags::addTag(QString tagName, bool tagChecked) {
     QTreeWidgetItem *tagItem = new QTreeWidgetItem();
     tagItem->setText(0, tagName);
+    tagItem->setData(0, TagIdRole, TagDictionary::intern(tagName));
     tagItem->setCheckState(0, tagChecked ? Qt::Checked : Qt::Unchecked);
     setTagIcon(tagItem, tagChecked ? TagIconEnabled : TagIconDisabled);
     tagsTree->addTopLevelItem(tagItem);
 }
 
-bool ImageTags::writeTagsToImage(QString &imageFileName, QSet<QString> &newTags) {
-    QSet<QString> imageTags;
-    Exiv2::Image::AutoPtr exifImage;
-
-    try {
-        exifImage = Exiv2::ImageFactory::open(imageFileName.toStdString());
-        exifImage->readMetadata();
-
-        Exiv2::IptcData newIptcData;
-
-        /* copy existing data */
-        Exiv2::IptcData &iptcData = exifImage->iptcData();
-        if (!iptcData.empty()) {
-            QString key;
-            Exiv2::IptcData::iterator end = iptcData.end();
-            for (Exiv2::IptcData::iterator iptcIt = iptcData.begin(); iptcIt != end; ++iptcIt) {
-                if (iptcIt->tagName() != "Keywords") {
-                    newIptcData.add(*iptcIt);
-                }
-            }
-        }
-
-        /* add new tags */
-        QSetIterator<QString> newTagsIt(newTags);
-        while (newTagsIt.hasNext()) {
-            QString tag = newTagsIt.next();
-            Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::string);
-            value->read(tag.toStdString());
-            Exiv2::IptcKey key("Iptc.Application2.Keywords");
-            newIptcData.add(key, value.get());
-        }
-
-        exifImage->setIptcData(newIptcData);
-        exifImage->writeMetadata();
-    }
-    catch (Exiv2::Error &error) {
-        MessageBox msgBox(this);
-        msgBox.critical(tr("Error"), tr("Failed to save tags to ") + imageFileName);
-        return false;
-    }
-
-    return true;
-}
-
 void ImageTags::showSelectedImagesTags() {
     static bool busy = false;
     if (busy)
@@ -188,25 +163,43 @@ void ImageTags::showSelectedImagesTags() {
     setActiveViewMode(SelectionTagsDisplay);
 
     int selectedThumbsNum = selectedThumbs.size();
-    QMap<QString, int> tagsCount;
+    QVector<int> tagsCount(TagDictionary::size());
     for (int i = 0; i < selectedThumbsNum; ++i) {
-        QSetIterator<QString> imageTagsIter(metadataCache->getImageTags(selectedThumbs[i]));
-        while (imageTagsIter.hasNext()) {
-            QString imageTag = imageTagsIter.next();
-            tagsCount[imageTag]++;
-
-            if (!Settings::knownTags.contains(imageTag)) {
-                addTag(imageTag, true);
-                Settings::knownTags.insert(imageTag);
-            }
+        const TagIdList imageTagIds = metadataCache->getImageTagIds(selectedThumbs[i]);
+        if (!imageTagIds.isEmpty() && imageTagIds.last() >= tagsCount.size()) {
+            tagsCount.resize(TagDictionary::size());
+        }
+
+        int *counts = tagsCount.data();
+        for (int tag = 0; tag < imageTagIds.size(); ++tag) {
+            ++counts[imageTagIds[tag]];
+        }
+    }
+
+    // Tags found on the selection but not known yet, checked once per tag rather than per image
+    for (int tagId = 0; tagId < tagsCount.size(); ++tagId) {
+        if (!tagsCount[tagId]) {
+            continue;
+        }
+
+        QString imageTag = TagDictionary::name(tagId);
+        Settings::knownTagsMutex.lock();
+        bool unknownTag = !Settings::knownTags.contains(imageTag);
+        if (unknownTag) {
+            Settings::knownTags.insert(imageTag);
+        }
+        Settings::knownTagsMutex.unlock();
+
+        if (unknownTag) {
+            addTag(imageTag, true);
         }
     }
 
     bool imagesTagged = false, imagesTaggedMixed = false;
     QTreeWidgetItemIterator it(tagsTree);
     while (*it) {
-        QString tagName = (*it)->text(0);
-        int tagCountTotal = tagsCount[tagName];
+        int tagId = (*it)->data(0, TagIdRole).toInt();
+        int tagCountTotal = tagId < tagsCount.size() ? tagsCount[tagId] : 0;
 
         if (selectedThumbsNum == 0) {
             (*it)->setCheckState(0, Qt::Unchecked);
@@ -274,7 +267,9 @@ void ImageTags::showTagsFilter() {
 
 void ImageTags::populateTagsTree() {
     tagsTree->clear();
+    QMutexLocker locker(&Settings::knownTagsMutex);
     QSetIterator<QString> knownTagsIt(Settings::knownTags);
+    locker.unlock();
     while (knownTagsIt.hasNext()) {
         QString tag = knownTagsIt.next();
         addTag(tag, false);
@@ -297,24 +292,94 @@ void ImageTags::setActiveViewMode(TagsDisplayMode mode) {
     removeFromSelectionAction->setVisible(currentDisplayMode == SelectionTagsDisplay);
     actionClearTagsFilter->setVisible(currentDisplayMode == DirectoryTagsDisplay);
     negateAction->setVisible(currentDisplayMode == DirectoryTagsDisplay);
+    matchAllAction->setVisible(currentDisplayMode == DirectoryTagsDisplay);
+}
+
+void ImageTags::invalidateTagIndex() {
+    tagIndexValid = false;
 }
 
-bool ImageTags::isImageFilteredOut(QString imageFileName) {
-    QSet<QString> imageTags = metadataCache->getImageTags(imageFileName);
+void ImageTags::buildTagIndex() {
+    rowsByTagId.clear();
 
+    // Rows are visited in order, so every list comes out sorted
+    QStandardItemModel *thumbsModel = thumbView->thumbsViewerModel;
+    for (int row = 0; row < thumbsModel->rowCount(); ++row) {
+        QString imageFileName = thumbsModel->item(row)->data(thumbView->FileNameRole).toString();
+        const TagIdList imageTagIds = metadataCache->getImageTagIds(imageFileName);
+        for (int i = 0; i < imageTagIds.size(); ++i) {
+            rowsByTagId[imageTagIds[i]].append(row);
+        }
+    }
+
+    tagIndexValid = true;
+}
+
+QVector<int> ImageTags::getFilteredRows() {
+    if (!tagIndexValid) {
+        buildTagIndex();
+    }
+
+    QVector<int> rows;
+    bool firstTag = true;
     QSetIterator<QString> filteredTagsIt(imageFilteringTags);
     while (filteredTagsIt.hasNext()) {
-        if (imageTags.contains(filteredTagsIt.next())) {
-            return negateFilterEnabled;
+        const QVector<int> tagRows = rowsByTagId.value(TagDictionary::find(filteredTagsIt.next()));
+        if (firstTag) {
+            rows = tagRows;
+            firstTag = false;
+            continue;
         }
+
+        QVector<int> combinedRows;
+        if (matchAllTagsEnabled) {
+            std::set_intersection(rows.constBegin(), rows.constEnd(), tagRows.constBegin(), tagRows.constEnd(),
+                                  std::back_inserter(combinedRows));
+        } else {
+            std::set_union(rows.constBegin(), rows.constEnd(), tagRows.constBegin(), tagRows.constEnd(),
+                           std::back_inserter(combinedRows));
+        }
+        rows = combinedRows;
     }
 
-    return !negateFilterEnabled;
+    if (negateFilterEnabled) {
+        QVector<int> complementRows;
+        const int rowCount = thumbView->thumbsViewerModel->rowCount();
+        complementRows.reserve(rowCount - rows.size());
+        for (int row = 0, i = 0; row < rowCount; ++row) {
+            if (i < rows.size() && rows[i] == row) {
+                ++i;
+            } else {
+                complementRows.append(row);
+            }
+        }
+        rows = complementRows;
+    }
+
+    return rows;
+}
+
+void ImageTags::filterThumbs() {
+    const int rowCount = thumbView->thumbsViewerModel->rowCount();
+    QVector<bool> rowShown(rowCount, !dirFilteringActive);
+    if (dirFilteringActive) {
+        const QVector<int> filteredRows = getFilteredRows();
+        for (int i = 0; i < filteredRows.size(); ++i) {
+            rowShown[filteredRows[i]] = true;
+        }
+    }
+
+    for (int row = 0; row < rowCount; ++row) {
+        if (thumbView->isRowHidden(row) == rowShown[row]) {
+            thumbView->setRowHidden(row, !rowShown[row]);
+        }
+    }
 }
 
 void ImageTags::resetTagsState() {
     tagsTree->clear();
     metadataCache->clear();
+    tagIndexValid = false;
 }
 
 QSet<QString> ImageTags::getCheckedTags(Qt::CheckState tagState) {
@@ -345,7 +410,8 @@ void ImageTags::applyTagFiltering() {
         tabs->setTabIcon(1, QIcon(":/images/tag_filter_off.png"));
     }
 
-    emit reloadThumbs();
+    filterThumbs();
+    thumbView->onThumbsFiltered();
 }
 
 void ImageTags::applyUserAction(QTreeWidgetItem *item) {
@@ -355,40 +421,39 @@ void ImageTags::applyUserAction(QTreeWidgetItem *item) {
 }
 
 void ImageTags::applyUserAction(QList<QTreeWidgetItem *> tagsList) {
-    ProgressDialog *progressDialog = new ProgressDialog(this);
-    progressDialog->show();
+    for (int i = tagsList.size() - 1; i > -1; --i) {
+        Qt::CheckState tagState = tagsList.at(i)->checkState(0);
+        setTagIcon(tagsList.at(i), (tagState == Qt::Checked ? TagIconEnabled : TagIconDisabled));
+    }
 
+    // The cache is updated right away, files are written in the background
     QStringList currentSelectedImages = thumbView->getSelectedThumbsList();
     for (int currentImage = 0; currentImage < currentSelectedImages.size(); ++currentImage) {
 
         QString imageName = currentSelectedImages[currentImage];
         for (int i = tagsList.size() - 1; i > -1; --i) {
-            Qt::CheckState tagState = tagsList.at(i)->checkState(0);
-            setTagIcon(tagsList.at(i), (tagState == Qt::Checked ? TagIconEnabled : TagIconDisabled));
             QString tagName = tagsList.at(i)->text(0);
-
-            if (tagState == Qt::Checked) {
-                progressDialog->opLabel->setText(tr("Tagging ") + imageName);
+            if (tagsList.at(i)->checkState(0) == Qt::Checked) {
                 metadataCache->addTagToImage(imageName, tagName);
             } else {
-                progressDialog->opLabel->setText(tr("Untagging ") + imageName);
                 metadataCache->removeTagFromImage(imageName, tagName);
             }
         }
 
-        if (!writeTagsToImage(imageName, metadataCache->getImageTags(imageName))) {
-            metadataCache->removeImage(imageName);
-        }
+        tagWriteQueue->enqueue(imageName, metadataCache->getImageTags(imageName), Settings::saveMetadataToSidecar);
+    }
+    tagIndexValid = false;
+}
 
-        QApplication::processEvents();
+void ImageTags::onTagWriteFailed(const QString &imageFullPath, const QString &) {
+    // Drops the optimistic update and goes back to what the file really holds
+    metadataCache->removeImage(imageFullPath);
+    metadataCache->loadImageMetadata(imageFullPath);
+    tagIndexValid = false;
 
-        if (progressDialog->abortOp) {
-            break;
-        }
+    if (isVisible() && currentDisplayMode == SelectionTagsDisplay) {
+        showSelectedImagesTags();
     }
-
-    progressDialog->close();
-    delete (progressDialog);
 }
 
 void ImageTags::saveLastChangedTag(QTreeWidgetItem *item, int) {
@@ -446,6 +511,11 @@ void ImageTags::negateFilter() {
     applyTagFiltering();
 }
 
+void ImageTags::matchAllTags() {
+    matchAllTagsEnabled = matchAllAction->isChecked();
+    applyTagFiltering();
+}
+
 void ImageTags::addNewTag() {
     bool ok;
     QString title = tr("Add a new tag");
@@ -461,18 +531,17 @@ void ImageTags::addNewTag() {
         return;
     }
 
-    QSetIterator<QString> knownTagsIt(Settings::knownTags);
-    while (knownTagsIt.hasNext()) {
-        QString tag = knownTagsIt.next();
-        if (newTagName == tag) {
-            MessageBox msgBox(this);
-            msgBox.critical(tr("Error"), tr("Tag ") + newTagName + tr(" already exists"));
-            return;
-        }
+    QMutexLocker locker(&Settings::knownTagsMutex);
+    if (Settings::knownTags.contains(newTagName)) {
+        locker.unlock();
+        MessageBox msgBox(this);
+        msgBox.critical(tr("Error"), tr("Tag ") + newTagName + tr(" already exists"));
+        return;
     }
+    Settings::knownTags.insert(newTagName);
+    locker.unlock();
 
     addTag(newTagName, false);
-    Settings::knownTags.insert(newTagName);
     redrawTagTree();
 }
 
@@ -498,7 +567,9 @@ void ImageTags::removeTag() {
     for (int i = tagsTree->selectedItems().size() - 1; i > -1; --i) {
 
         QString tagName = tagsTree->selectedItems().at(i)->text(0);
+        Settings::knownTagsMutex.lock();
         Settings::knownTags.remove(tagName);
+        Settings::knownTagsMutex.unlock();
 
         if (imageFilteringTags.contains(tagName)) {
             imageFilteringTags.remove(tagName);
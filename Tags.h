@@ -23,6 +23,7 @@
 #include <exiv2/exiv2.hpp>
 #include "ThumbsViewer.h"
 #include "MetadataCache.h"
+#include "TagWriteQueue.h"
 
 class ThumbsViewer;
 
@@ -31,6 +32,9 @@ enum TagsDisplayMode {
     SelectionTagsDisplay
 };
 
+// Tree items keep the interned ID of their tag, see TagDictionary
+const int TagIdRole = Qt::UserRole;
+
 enum TagIcons {
     TagIconDisabled,
     TagIconEnabled,
@@ -54,7 +58,8 @@ public:
 
     void resetTagsState();
 
-    bool isImageFilteredOut(QString imagePath);
+    // Hides the thumbnails that do not pass the tag filter, evaluated on the in-memory tag index
+    void filterThumbs();
 
     void removeTag();
 
@@ -64,11 +69,15 @@ public:
     QTreeWidget *tagsTree;
     bool dirFilteringActive;
     QAction *removeTagAction;
+    TagWriteQueue *tagWriteQueue;
     TagsDisplayMode currentDisplayMode;
 
-private:
-    bool writeTagsToImage(QString &imageFileName, QSet<QString> &tags);
+public slots:
 
+    // For changes of image tags made outside of the tags view
+    void invalidateTagIndex();
+
+private:
     QSet<QString> getCheckedTags(Qt::CheckState tagState);
 
     void setTagIcon(QTreeWidgetItem *tagItem, TagIcons icon);
@@ -81,17 +90,26 @@ private:
 
     void redrawTagTree();
 
+    void buildTagIndex();
+
+    QVector<int> getFilteredRows();
+
     QSet<QString> imageFilteringTags;
     QAction *actionAddTag;
     QAction *addToSelectionAction;
     QAction *removeFromSelectionAction;
     QAction *actionClearTagsFilter;
     QAction *negateAction;
+    QAction *matchAllAction;
     QTreeWidgetItem *lastChangedTagItem;
     ThumbsViewer *thumbView;
     QTabBar *tabs;
     MetadataCache *metadataCache;
     bool negateFilterEnabled;
+    bool matchAllTagsEnabled;
+    // Sorted thumbnail rows of every tag ID, valid until the rows or their tags change
+    QHash<int, QVector<int> > rowsByTagId;
+    bool tagIndexValid;
 
 private slots:
 
@@ -111,13 +129,14 @@ private slots:
 
     void negateFilter();
 
+    void matchAllTags();
+
     void removeTagsFromSelection();
 
     void tabsChanged(int index);
 
-signals:
+    void onTagWriteFailed(const QString &imageFullPath, const QString &error);
 
-    void reloadThumbs();
 
 };
 
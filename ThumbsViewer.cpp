@@ -16,14 +16,32 @@
  *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <QProgressDialog>
 #include <QMimeDatabase>
 
 #include "ThumbsViewer.h"
 #include "Phototonic.h"
+#include "ImageTransforms.h"
+#include "BoundedFileIo.h"
+#include "ImageFileBuffer.h"
+#include "XmpSidecar.h"
+#include "ItemModelRows.h"
+
+namespace {
+// One per job item. The worker fills the thumbnail, the GUI thread applies it to the row of index.
+struct ThumbSlot {
+    QPersistentModelIndex index;
+    QImage thumb;
+    qreal brightness;
+    bool decoded;
+};
+}
 
-ThumbsViewer::ThumbsViewer(QWidget *parent, MetadataCache *metadataCache) : QListView(parent) {
+ThumbsViewer::ThumbsViewer(QWidget *parent, MetadataCache *metadataCache, JobScheduler *jobScheduler)
+        : QListView(parent) {
     this->metadataCache = metadataCache;
+    this->jobScheduler = jobScheduler;
+    thumbsGeneration = 0;
+    isAbortDuplicatesSearch = false;
     Settings::thumbsBackgroundColor = Settings::appSettings->value(
             Settings::optionThumbsBackgroundColor).value<QColor>();
     Settings::thumbsTextColor = Settings::appSettings->value(Settings::optionThumbsTextColor).value<QColor>();
@@ -68,14 +86,28 @@ ThumbsViewer::ThumbsViewer(QWidget *parent, MetadataCache *metadataCache) : QLis
 
     thumbsDir = new QDir();
     fileFilters = new QStringList;
-    emptyImg.load(":/images/no_image.png");
 
     QTime time = QTime::currentTime();
     qsrand((uint) time.msec());
     phototonic = (Phototonic *) parent;
     infoView = new InfoView(this);
+    connect(infoView, SIGNAL(updateInfo()), this, SLOT(updateCurrentImageInfo()));
+    imageInfoCache.setMaxCost(IMAGE_INFO_CACHE_SIZE);
 
     imagePreview = new ImagePreview(this);
+
+    exactDuplicateFinder = new ExactDuplicateFinder(this, jobScheduler);
+    connect(exactDuplicateFinder, SIGNAL(duplicatesFound(QStringList)), this, SLOT(onExactDuplicatesFound(QStringList)));
+    connect(exactDuplicateFinder, SIGNAL(finished(QStringList, bool)),
+            this, SLOT(onExactDuplicatesSearchFinished(QStringList, bool)));
+    imageHasher = new ImageHasher(this, jobScheduler);
+    connect(imageHasher, SIGNAL(imageHashed(QString, ImageHash)), this, SLOT(onDuplicateCandidateHashed(QString, ImageHash)));
+    connect(imageHasher, SIGNAL(hashFailed(QString)), this, SLOT(onDuplicateCandidateFailed(QString)));
+    connect(imageHasher, SIGNAL(finished(bool)), this, SLOT(onDuplicateCandidatesHashed(bool)));
+    dupProgress = new ProgressReporter(this);
+    connect(dupProgress, SIGNAL(updated()), this, SLOT(onDuplicatesProgress()));
+    dupOriginalImages = dupFoundImages = dupScannedImages = 0;
+    dupHashingReference = false;
 }
 
 void ThumbsViewer::setThumbColors() {
@@ -112,27 +144,118 @@ QString ThumbsViewer::getSingleSelectionFilename() {
 }
 
 int ThumbsViewer::getNextRow() {
-    if (currentRow == thumbsViewerModel->rowCount() - 1) {
-        return -1;
+    for (int row = currentRow + 1; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
     }
 
-    return currentRow + 1;
+    return -1;
 }
 
 int ThumbsViewer::getPrevRow() {
-    if (currentRow == 0) {
-        return -1;
+    for (int row = currentRow - 1; row >= 0; --row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
     }
 
-    return currentRow - 1;
+    return -1;
+}
+
+int ThumbsViewer::getFirstRow() {
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
+    }
+
+    return -1;
 }
 
 int ThumbsViewer::getLastRow() {
-    return thumbsViewerModel->rowCount() - 1;
+    for (int row = thumbsViewerModel->rowCount() - 1; row >= 0; --row) {
+        if (!isRowHidden(row)) {
+            return row;
+        }
+    }
+
+    return -1;
 }
 
 int ThumbsViewer::getRandomRow() {
-    return qrand() % (thumbsViewerModel->rowCount());
+    const int rowCount = thumbsViewerModel->rowCount();
+    if (rowCount <= 0) {
+        return -1;
+    }
+
+    // Rows hidden by the tag filter are skipped by moving on to the next shown one
+    const int randomRow = qrand() % rowCount;
+    for (int i = 0; i < rowCount; ++i) {
+        int row = (randomRow + i) % rowCount;
+        if (!isRowHidden(row)) {
+            return row;
+        }
+    }
+
+    return -1;
+}
+
+int ThumbsViewer::getShownThumbsCount() {
+    if (!imageTags->dirFilteringActive) {
+        return thumbsViewerModel->rowCount();
+    }
+
+    int shownThumbs = 0;
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!isRowHidden(row)) {
+            ++shownThumbs;
+        }
+    }
+
+    return shownThumbs;
+}
+
+QItemSelection ThumbsViewer::getShownRowsSelection() {
+    QItemSelection selection;
+    const int rowCount = thumbsViewerModel->rowCount();
+    for (int row = 0; row < rowCount; ++row) {
+        if (isRowHidden(row)) {
+            continue;
+        }
+
+        int lastRow = row;
+        while (lastRow + 1 < rowCount && !isRowHidden(lastRow + 1)) {
+            ++lastRow;
+        }
+        selection.select(thumbsViewerModel->index(row, 0), thumbsViewerModel->index(lastRow, 0));
+        row = lastRow;
+    }
+
+    return selection;
+}
+
+void ThumbsViewer::selectAll() {
+    // The default selects hidden rows too, which file operations would then act on
+    selectionModel()->select(getShownRowsSelection(), QItemSelectionModel::ClearAndSelect);
+}
+
+void ThumbsViewer::onThumbsFiltered() {
+    QModelIndexList indexesList = selectionModel()->selectedIndexes();
+    for (int i = 0; i < indexesList.size(); ++i) {
+        if (isRowHidden(indexesList[i].row())) {
+            selectionModel()->select(indexesList[i], QItemSelectionModel::Deselect);
+        }
+    }
+
+    if (selectionModel()->selectedIndexes().isEmpty() && getFirstRow() >= 0) {
+        selectThumbByRow(getFirstRow());
+    }
+
+    thumbsRangeFirst = -1;
+    thumbsRangeLast = -1;
+    updateThumbsCount();
+    loadVisibleThumbs(verticalScrollBar()->value());
 }
 
 int ThumbsViewer::getCurrentRow() {
@@ -182,59 +305,60 @@ bool ThumbsViewer::setCurrentIndexByRow(int row) {
 
 void ThumbsViewer::updateImageInfoViewer(int row) {
     QString imageFullPath = thumbsViewerModel->item(row)->data(FileNameRole).toString();
-    QImageReader imageInfoReader(imageFullPath);
-    QString key;
-    QString val;
-
     QFileInfo imageInfo = QFileInfo(imageFullPath);
-    infoView->addTitleEntry(tr("Image"));
-
-    key = tr("File name");
-    val = imageInfo.fileName();
-    infoView->addEntry(key, val);
-
-    key = tr("Location");
-    val = imageInfo.path();
-    infoView->addEntry(key, val);
-
-    key = tr("Size");
-    val = QString::number(imageInfo.size() / 1024.0, 'f', 2) + "K";
-    infoView->addEntry(key, val);
-
-    key = tr("Modified");
-    val = imageInfo.lastModified().toString(Qt::SystemLocaleShortDate);
-    infoView->addEntry(key, val);
-
-    if (imageInfoReader.size().isValid()) {
-        key = tr("Format");
-        val = imageInfoReader.format().toUpper();
-        infoView->addEntry(key, val);
-
-        key = tr("Resolution");
-        val = QString::number(imageInfoReader.size().width())
-              + "x"
-              + QString::number(imageInfoReader.size().height());
-        infoView->addEntry(key, val);
-
-        key = tr("Megapixel");
-        val = QString::number((imageInfoReader.size().width() * imageInfoReader.size().height()) / 1000000.0, 'f',
-                              2);
-        infoView->addEntry(key, val);
-
-        key = tr("Average brightness");
-        val = QString::number(thumbsViewerModel->item(row)->data(BrightnessRole).toReal(), 'f', 2);
-        infoView->addEntry(key, val);
+    InfoEntryList entries;
+
+    InfoView::addTitleEntry(entries, tr("Image"));
+    InfoView::addEntry(entries, tr("File name"), imageInfo.fileName());
+    InfoView::addEntry(entries, tr("Location"), imageInfo.path());
+    InfoView::addEntry(entries, tr("Size"), QString::number(imageInfo.size() / 1024.0, 'f', 2) + "K");
+    InfoView::addEntry(entries, tr("Modified"), imageInfo.lastModified().toString(Qt::SystemLocaleShortDate));
+
+    qint64 sidecarModified = XmpSidecar::lastModified(imageFullPath);
+    CachedImageInfo *cachedInfo = imageInfoCache.object(imageFullPath);
+    if (!cachedInfo || cachedInfo->modified != imageInfo.lastModified() || cachedInfo->size != imageInfo.size()
+        || cachedInfo->sidecarModified != sidecarModified) {
+        cachedInfo = new CachedImageInfo;
+        cachedInfo->modified = imageInfo.lastModified();
+        cachedInfo->size = imageInfo.size();
+        cachedInfo->sidecarModified = sidecarModified;
+        readImageInfo(imageFullPath, *cachedInfo);
+        imageInfoCache.insert(imageFullPath, cachedInfo);
+    }
+
+    entries += cachedInfo->formatEntries;
+    // Brightness comes from the thumbnail, which may have loaded after the file was parsed
+    if (cachedInfo->isReadable) {
+        InfoView::addEntry(entries, tr("Average brightness"),
+                           QString::number(thumbsViewerModel->item(row)->data(BrightnessRole).toReal(), 'f', 2));
+    }
+    entries += cachedInfo->metadataEntries;
+
+    infoView->setEntries(entries);
+}
+
+void ThumbsViewer::readImageInfo(const QString &imageFullPath, CachedImageInfo &imageInfo) {
+    QImageReader imageInfoReader(imageFullPath);
+    QSize imageSize = imageInfoReader.size();
+
+    imageInfo.isReadable = imageSize.isValid();
+    if (imageInfo.isReadable) {
+        InfoView::addEntry(imageInfo.formatEntries, tr("Format"), imageInfoReader.format().toUpper());
+        InfoView::addEntry(imageInfo.formatEntries, tr("Resolution"),
+                           QString::number(imageSize.width()) + "x" + QString::number(imageSize.height()));
+        InfoView::addEntry(imageInfo.formatEntries, tr("Megapixel"),
+                           QString::number((imageSize.width() * imageSize.height()) / 1000000.0, 'f', 2));
     } else {
         imageInfoReader.read();
-        key = tr("Error");
-        val = imageInfoReader.errorString();
-        infoView->addEntry(key, val);
+        InfoView::addEntry(imageInfo.formatEntries, tr("Error"), imageInfoReader.errorString());
     }
 
+    InfoEntryList &entries = imageInfo.metadataEntries;
+
     Exiv2::Image::AutoPtr exifImage;
+    qint64 bytesRead = 0;
     try {
-        exifImage = Exiv2::ImageFactory::open(imageFullPath.toStdString());
-        exifImage->readMetadata();
+        exifImage = BoundedFileIo::readMetadata(imageFullPath, bytesRead);
     }
     catch (Exiv2::Error &error) {
         return;
@@ -243,37 +367,40 @@ void ThumbsViewer::updateImageInfoViewer(int row) {
     Exiv2::ExifData &exifData = exifImage->exifData();
     if (!exifData.empty()) {
         Exiv2::ExifData::const_iterator end = exifData.end();
-        infoView->addTitleEntry("Exif");
+        InfoView::addTitleEntry(entries, "Exif");
         for (Exiv2::ExifData::const_iterator md = exifData.begin(); md != end; ++md) {
-            key = QString::fromUtf8(md->tagName().c_str());
-            val = QString::fromUtf8(md->print().c_str());
-            infoView->addEntry(key, val);
+            InfoView::addEntry(entries, QString::fromUtf8(md->tagName().c_str()), QString::fromUtf8(md->print().c_str()));
         }
     }
 
     Exiv2::IptcData &iptcData = exifImage->iptcData();
     if (!iptcData.empty()) {
         Exiv2::IptcData::iterator end = iptcData.end();
-        infoView->addTitleEntry("IPTC");
+        InfoView::addTitleEntry(entries, "IPTC");
         for (Exiv2::IptcData::iterator md = iptcData.begin(); md != end; ++md) {
-            key = QString::fromUtf8(md->tagName().c_str());
-            val = QString::fromUtf8(md->print().c_str());
-            infoView->addEntry(key, val);
+            InfoView::addEntry(entries, QString::fromUtf8(md->tagName().c_str()), QString::fromUtf8(md->print().c_str()));
         }
     }
 
     Exiv2::XmpData &xmpData = exifImage->xmpData();
     if (!xmpData.empty()) {
         Exiv2::XmpData::iterator end = xmpData.end();
-        infoView->addTitleEntry("XMP");
+        InfoView::addTitleEntry(entries, "XMP");
         for (Exiv2::XmpData::iterator md = xmpData.begin(); md != end; ++md) {
-            key = QString::fromUtf8(md->tagName().c_str());
-            val = QString::fromUtf8(md->print().c_str());
-            infoView->addEntry(key, val);
+            InfoView::addEntry(entries, QString::fromUtf8(md->tagName().c_str()), QString::fromUtf8(md->print().c_str()));
         }
     }
 }
 
+void ThumbsViewer::updateCurrentImageInfo() {
+    infoView->clear();
+
+    QModelIndexList indexesList = selectionModel()->selectedIndexes();
+    if (indexesList.size() == 1) {
+        updateImageInfoViewer(indexesList.first().row());
+    }
+}
+
 void ThumbsViewer::onSelectionChanged() {
     infoView->clear();
     imagePreview->clear();
@@ -306,7 +433,7 @@ void ThumbsViewer::onSelectionChanged() {
     if (selectedThumbs >= 1) {
         QString statusStr;
         statusStr = tr("Selected %1 of %2").arg(QString::number(selectedThumbs))
-                .arg(tr(" %n image(s)", "", thumbsViewerModel->rowCount()));
+                .arg(tr(" %n image(s)", "", getShownThumbsCount()));
         phototonic->setStatus(statusStr);
     } else if (!selectedThumbs) {
         updateThumbsCount();
@@ -372,7 +499,18 @@ void ThumbsViewer::startDrag(Qt::DropActions) {
 }
 
 void ThumbsViewer::abort() {
-    isAbortThumbsLoading = true;
+    isAbortDuplicatesSearch = true;
+    if (listJob) {
+        listJob->cancel();
+    }
+    if (rangeThumbsJob) {
+        rangeThumbsJob->cancel();
+    }
+    if (allThumbsJob) {
+        allThumbsJob->cancel();
+    }
+    exactDuplicateFinder->cancel();
+    imageHasher->cancel();
 }
 
 void ThumbsViewer::loadVisibleThumbs(int scrollBarValue) {
@@ -382,41 +520,9 @@ void ThumbsViewer::loadVisibleThumbs(int scrollBarValue) {
 
     lastScrollBarValue = scrollBarValue;
 
-    for (;;) {
-        int firstVisible = getFirstVisibleThumb();
-        int lastVisible = getLastVisibleThumb();
-        if (isAbortThumbsLoading || firstVisible < 0 || lastVisible < 0) {
-            return;
-        }
-
-        if (scrolledForward) {
-            lastVisible += ((lastVisible - firstVisible) * (Settings::thumbsPagesReadCount + 1));
-            if (lastVisible >= thumbsViewerModel->rowCount()) {
-                lastVisible = thumbsViewerModel->rowCount() - 1;
-            }
-        } else {
-            firstVisible -= (lastVisible - firstVisible) * (Settings::thumbsPagesReadCount + 1);
-            if (firstVisible < 0) {
-                firstVisible = 0;
-            }
-
-            lastVisible += 10;
-            if (lastVisible >= thumbsViewerModel->rowCount()) {
-                lastVisible = thumbsViewerModel->rowCount() - 1;
-            }
-        }
-
-        if (thumbsRangeFirst == firstVisible && thumbsRangeLast == lastVisible) {
-            return;
-        }
-
-        thumbsRangeFirst = firstVisible;
-        thumbsRangeLast = lastVisible;
-
-        loadThumbsRange();
-        if (isAbortThumbsLoading) {
-            break;
-        }
+    // Scrolling and listing call this in bursts, the range is looked at once they settle
+    if (!m_loadThumbTimer.isActive()) {
+        m_loadThumbTimer.start();
     }
 }
 
@@ -424,6 +530,9 @@ int ThumbsViewer::getFirstVisibleThumb() {
     QModelIndex idx;
 
     for (int currThumb = 0; currThumb < thumbsViewerModel->rowCount(); ++currThumb) {
+        if (isRowHidden(currThumb)) {
+            continue;
+        }
         idx = thumbsViewerModel->indexFromItem(thumbsViewerModel->item(currThumb));
         if (viewport()->rect().contains(QPoint(0, visualRect(idx).y() + visualRect(idx).height() + 1))) {
             return idx.row();
@@ -437,6 +546,9 @@ int ThumbsViewer::getLastVisibleThumb() {
     QModelIndex idx;
 
     for (int currThumb = thumbsViewerModel->rowCount() - 1; currThumb >= 0; --currThumb) {
+        if (isRowHidden(currThumb)) {
+            continue;
+        }
         idx = thumbsViewerModel->indexFromItem(thumbsViewerModel->item(currThumb));
         if (viewport()->rect().contains(QPoint(0, visualRect(idx).y() + visualRect(idx).height() + 1))) {
             return idx.row();
@@ -450,12 +562,13 @@ void ThumbsViewer::loadFileList() {
     for (int i = 0; i < Settings::filesList.size(); i++) {
         addThumb(Settings::filesList[i]);
     }
-    updateThumbsCount();
 
     imageTags->populateTagsTree();
+    imageTags->filterThumbs();
+    updateThumbsCount();
 
-    if (thumbFileInfoList.size() && selectionModel()->selectedIndexes().size() == 0) {
-        selectThumbByRow(0);
+    if (selectionModel()->selectedIndexes().size() == 0 && getFirstRow() >= 0) {
+        selectThumbByRow(getFirstRow());
     }
 
     phototonic->showBusyAnimation(false);
@@ -474,37 +587,10 @@ void ThumbsViewer::reLoad() {
     }
 
     applyFilter();
-    initThumbs();
     updateThumbsCount();
-    loadVisibleThumbs();
-
-    if (Settings::includeSubDirectories) {
-        loadSubDirectories();
-    }
-
-    phototonic->showBusyAnimation(false);
-    isBusy = false;
-}
-
-void ThumbsViewer::loadSubDirectories() {
-    QDirIterator dirIterator(Settings::currentDirectory, QDirIterator::Subdirectories);
-    while (dirIterator.hasNext()) {
-        dirIterator.next();
-        if (dirIterator.fileInfo().isDir() && dirIterator.fileName() != "." && dirIterator.fileName() != "..") {
-            thumbsDir->setPath(dirIterator.filePath());
-
-            initThumbs();
-            updateThumbsCount();
-            loadVisibleThumbs();
-
-            if (isAbortThumbsLoading) {
-                return;
-            }
-        }
-        QApplication::processEvents();
-    }
 
-    onSelectionChanged();
+    // The rows come in from the listing job, which also ends the busy state
+    initThumbs();
 }
 
 void ThumbsViewer::applyFilter() {
@@ -560,7 +646,18 @@ void ThumbsViewer::loadPrepare() {
         scrollToTop();
     }
 
-    isAbortThumbsLoading = false;
+    // Results still coming in belong to the rows just cleared
+    ++thumbsGeneration;
+    if (listJob) {
+        listJob->cancel();
+    }
+    if (rangeThumbsJob) {
+        rangeThumbsJob->cancel();
+    }
+    if (allThumbsJob) {
+        allThumbsJob->cancel();
+    }
+    isAbortDuplicatesSearch = false;
 
     thumbsRangeFirst = -1;
     thumbsRangeLast = -1;
@@ -576,8 +673,16 @@ void ThumbsViewer::loadDuplicates()
 
     phototonic->setStatus(tr("Searching duplicate images..."));
 
-    dupImageHashes.clear();
-    findDupes(true);
+    dupGroupLeaders.clear();
+    dupGroups.clear();
+    dupExactCopies.clear();
+    dupOriginalImages = dupFoundImages = dupScannedImages = 0;
+
+    QStringList imageFullPaths;
+    thumbFileInfoList = thumbsDir->entryInfoList();
+    for (int i = 0; i < thumbFileInfoList.size(); ++i) {
+        imageFullPaths.append(thumbFileInfoList.at(i).filePath());
+    }
 
     if (Settings::includeSubDirectories) {
         QDirIterator iterator(Settings::currentDirectory, QDirIterator::Subdirectories);
@@ -586,63 +691,333 @@ void ThumbsViewer::loadDuplicates()
             if (iterator.fileInfo().isDir() && iterator.fileName() != "." && iterator.fileName() != "..") {
                 thumbsDir->setPath(iterator.filePath());
 
-                findDupes(false);
-                if (isAbortThumbsLoading) {
-                    goto finish;
+                thumbFileInfoList = thumbsDir->entryInfoList();
+                for (int i = 0; i < thumbFileInfoList.size(); ++i) {
+                    imageFullPaths.append(thumbFileInfoList.at(i).filePath());
+                }
+                if (isAbortDuplicatesSearch) {
+                    onDuplicatesSearchFinished();
+                    return;
                 }
             }
             QApplication::processEvents();
         }
     }
 
-finish:
+    if (!dupReferencePaths.isEmpty()) {
+        QStringList referenceImages = collectReferenceImages();
+        if (isAbortDuplicatesSearch) {
+            onDuplicatesSearchFinished();
+            return;
+        }
+
+        QSet<QString> referenceSet = referenceImages.toSet();
+        dupQueryImages.clear();
+        foreach (const QString &imageFullPath, imageFullPaths) {
+            if (!referenceSet.contains(QFileInfo(imageFullPath).absoluteFilePath())) {
+                dupQueryImages.append(imageFullPath);
+            }
+        }
+
+        // Hashes of an indexed reference come from the hash index, only new files are decoded
+        phototonic->setStatus(tr("Hashing reference images..."));
+        dupHashingReference = true;
+        if (!imageHasher->start(referenceImages, ImageHash::Algorithm(Settings::duplicatesHashAlgorithm))) {
+            dupHashingReference = false;
+            onDuplicatesSearchFinished();
+        }
+        return;
+    }
+
+    // Identical files are set aside first so they are never decoded, the rest is hashed after
+    dupProgress->start(imageFullPaths.size());
+    if (!exactDuplicateFinder->start(imageFullPaths)) {
+        onDuplicatesSearchFinished();
+    }
+}
+
+QStringList ThumbsViewer::collectReferenceImages() {
+    QStringList referenceImages;
+    foreach (const QString &referencePath, dupReferencePaths) {
+        QFileInfo referenceInfo(referencePath);
+        if (referenceInfo.isDir()) {
+            QDirIterator iterator(referenceInfo.absoluteFilePath(), *fileFilters, thumbsDir->filter(),
+                                  QDirIterator::Subdirectories);
+            while (iterator.hasNext()) {
+                referenceImages.append(QFileInfo(iterator.next()).absoluteFilePath());
+                if (referenceImages.size() % 100 == 0) {
+                    QApplication::processEvents();
+                    if (isAbortDuplicatesSearch) {
+                        return QStringList();
+                    }
+                }
+            }
+            continue;
+        }
+
+        // A saved file list, one image path per line, relative ones are taken from its directory
+        QFile listFile(referencePath);
+        if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            qWarning() << "Failed to read reference file list" << referencePath << listFile.errorString();
+            continue;
+        }
+        QTextStream listStream(&listFile);
+        while (!listStream.atEnd()) {
+            QString line = listStream.readLine().trimmed();
+            if (!line.isEmpty()) {
+                referenceImages.append(QFileInfo(referenceInfo.absoluteDir(), line).absoluteFilePath());
+            }
+        }
+    }
+
+    referenceImages.removeDuplicates();
+    return referenceImages;
+}
+
+void ThumbsViewer::onExactDuplicatesFound(const QStringList &identicalImages) {
+    dupScannedImages += identicalImages.size() - 1;
+
+    if (Settings::duplicatesExactOnly) {
+        int group = dupGroups.size();
+        DuplicateImage dupImage;
+        dupImage.filePath = identicalImages.first();
+        dupImage.duplicates = 0;
+        dupGroups.append(dupImage);
+
+        for (int i = 1; i < identicalImages.size(); ++i) {
+            addDuplicateToGroup(group, identicalImages.at(i), 0);
+        }
+        dupProgress->setProgress(dupScannedImages);
+    } else {
+        dupExactCopies.insert(identicalImages.first(), identicalImages.mid(1));
+    }
+}
+
+void ThumbsViewer::onExactDuplicatesSearchFinished(const QStringList &distinctImages, bool canceled) {
+    if (canceled || isAbortDuplicatesSearch || Settings::duplicatesExactOnly) {
+        if (!canceled) {
+            dupScannedImages += distinctImages.size();
+        }
+        onDuplicatesSearchFinished();
+        return;
+    }
+
+    // Hashes stream in from the workers, the search ends in onDuplicatesSearchFinished()
+    if (!imageHasher->start(distinctImages, ImageHash::Algorithm(Settings::duplicatesHashAlgorithm))) {
+        onDuplicatesSearchFinished();
+    }
+}
+
+void ThumbsViewer::onDuplicateCandidateHashed(const QString &imageFullPath, const ImageHash &hash) {
+    if (dupHashingReference) {
+        addDuplicateGroup(imageFullPath, hash);
+        return;
+    }
+
+    ++dupScannedImages;
+
+    /*
+     * Each group is led by the first image that matched no earlier group, later images join the
+     * group with the nearest leader. Members are then within the threshold of the leader, while
+     * chaining them pairwise could pull unrelated images into one group. In a reference search
+     * only the reference images lead groups and query images are not compared to each other.
+     */
+    int group;
+    int distance;
+    if (dupGroupLeaders.findNearest(hash, Settings::duplicatesMaxDistance, group, distance)) {
+        addDuplicateToGroup(group, imageFullPath, distance);
+    } else if (dupReferencePaths.isEmpty()) {
+        group = addDuplicateGroup(imageFullPath, hash);
+        distance = 0;
+    } else {
+        group = -1;
+    }
+
+    if (group >= 0) {
+        foreach (const QString &copyFullPath, dupExactCopies.take(imageFullPath)) {
+            addDuplicateToGroup(group, copyFullPath, distance);
+        }
+    }
+
+    dupProgress->setProgress(dupScannedImages);
+}
+
+int ThumbsViewer::addDuplicateGroup(const QString &imageFullPath, const ImageHash &hash) {
+    int group = dupGroups.size();
+    DuplicateImage dupImage;
+    dupImage.filePath = imageFullPath;
+    dupImage.duplicates = 0;
+    dupGroupLeaders.insert(hash, group);
+    dupGroups.append(dupImage);
+    return group;
+}
+
+void ThumbsViewer::addDuplicateToGroup(int group, const QString &imageFullPath, int distance) {
+    DuplicateImage &leader = dupGroups[group];
+    if (leader.duplicates < 1) {
+        insertDuplicateThumb(leader.filePath, group, 0);
+        ++dupOriginalImages;
+    }
+
+    ++dupFoundImages;
+    ++leader.duplicates;
+    insertDuplicateThumb(imageFullPath, group, distance);
+}
+
+// Keeps the thumbnails of a group together, leader first and members by their distance to it
+void ThumbsViewer::insertDuplicateThumb(const QString &imageFullPath, int group, int distance) {
+    int sortValue = group * (MAX_HASH_DISTANCE + 1) + distance;
+    int low = 0;
+    int high = thumbsViewerModel->rowCount();
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (thumbsViewerModel->item(middle)->data(SortRole).toInt() <= sortValue) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    QString thumbFullPath = imageFullPath;
+    insertThumb(low, thumbFullPath, sortValue);
+}
+
+void ThumbsViewer::onDuplicateCandidateFailed(const QString &imageFullPath) {
+    dupExactCopies.remove(imageFullPath);
+    qWarning() << "invalid image" << QFileInfo(imageFullPath).fileName();
+}
+
+void ThumbsViewer::onDuplicateCandidatesHashed(bool canceled) {
+    if (dupHashingReference) {
+        dupHashingReference = false;
+        if (!canceled && !isAbortDuplicatesSearch) {
+            phototonic->setStatus(tr("Searching duplicate images..."));
+            // The rate covers the query images only, reference hashes mostly come from the index
+            dupProgress->start(dupQueryImages.size());
+            if (imageHasher->start(dupQueryImages, ImageHash::Algorithm(Settings::duplicatesHashAlgorithm))) {
+                return;
+            }
+        }
+    }
+
+    onDuplicatesSearchFinished();
+}
+
+void ThumbsViewer::onDuplicatesProgress() {
+    updateFoundDupesState(dupFoundImages, dupScannedImages, dupOriginalImages, dupProgress->rateText());
+}
+
+void ThumbsViewer::onDuplicatesSearchFinished() {
+    dupProgress->stop();
+    updateFoundDupesState(dupFoundImages, dupScannedImages, dupOriginalImages);
     isBusy = false;
     phototonic->showBusyAnimation(false);
-    return;
 }
 
 void ThumbsViewer::initThumbs() {
-    thumbFileInfoList = thumbsDir->entryInfoList();
+    // A copy of its own, the worker must not share thumbsDir with the GUI thread
+    QDir listDir(thumbsDir->path());
+    listDir.setNameFilters(thumbsDir->nameFilters());
+    listDir.setFilter(thumbsDir->filter());
+    listDir.setSorting(thumbsDir->sorting());
+    QDir::SortFlags sortFlags = thumbsSortFlags;
+    bool includeSubDirectories = Settings::includeSubDirectories;
+    int generation = thumbsGeneration;
+
+    // Set once the job exists, its work function only runs after submit()
+    QSharedPointer<const Job *> jobHolder(new const Job *(0));
+    Job *job = new Job(tr("List images in %1").arg(listDir.path()), 1,
+                       [this, listDir, sortFlags, includeSubDirectories, generation, jobHolder](int, QString &) {
+                           listThumbs(listDir, sortFlags, includeSubDirectories, generation, *jobHolder);
+                           return true;
+                       }, Job::HighPriority);
+    *jobHolder = job;
+    connect(job, &Job::finished, this, [this, job]() {
+        // A listing canceled by a reload may finish after the next one started
+        if (listJob != job) {
+            return;
+        }
+        listJob = 0;
+        metadataCache->sync();
+        updateThumbsCount();
+        onSelectionChanged();
+        phototonic->showBusyAnimation(false);
+        isBusy = false;
+    });
+    listJob = job;
+    jobScheduler->submit(job);
+}
 
-    if (!(thumbsSortFlags & QDir::Time) && !(thumbsSortFlags & QDir::Size) && !(thumbsSortFlags & QDir::Type)) {
-        QCollator collator;
-        if (thumbsSortFlags & QDir::IgnoreCase) {
-            collator.setCaseSensitivity(Qt::CaseInsensitive);
+void ThumbsViewer::listThumbs(const QDir &dir, QDir::SortFlags sortFlags, bool includeSubDirectories,
+                              int generation, const Job *job) {
+    QDir listDir(dir);
+    QCollator collator;
+    if (sortFlags & QDir::IgnoreCase) {
+        collator.setCaseSensitivity(Qt::CaseInsensitive);
+    }
+    collator.setNumericMode(true);
+    bool sortByName = !(sortFlags & QDir::Time) && !(sortFlags & QDir::Size) && !(sortFlags & QDir::Type);
+
+    QDirIterator dirIterator(dir.path(), QDirIterator::Subdirectories);
+    QString directory = dir.path();
+    for (;;) {
+        listDir.setPath(directory);
+        QFileInfoList fileInfoList = listDir.entryInfoList();
+        if (sortByName) {
+            if (sortFlags & QDir::Reversed) {
+                std::sort(fileInfoList.begin(), fileInfoList.end(), [&](const QFileInfo &a, const QFileInfo &b) {
+                        return collator.compare(a.fileName(), b.fileName()) > 0;
+                        });
+            } else {
+                std::sort(fileInfoList.begin(), fileInfoList.end(), [&](const QFileInfo &a, const QFileInfo &b) {
+                        return collator.compare(a.fileName(), b.fileName()) < 0;
+                        });
+            }
         }
 
-        collator.setNumericMode(true);
+        QStringList imageFullPaths;
+        for (int fileIndex = 0; fileIndex < fileInfoList.size(); ++fileIndex) {
+            if (job->isCanceled()) {
+                return;
+            }
+            metadataCache->loadImageMetadata(fileInfoList.at(fileIndex));
+            imageFullPaths.append(fileInfoList.at(fileIndex).filePath());
+        }
+        if (!imageFullPaths.isEmpty()) {
+            QMetaObject::invokeMethod(this, "onThumbsListed", Qt::QueuedConnection,
+                                      Q_ARG(QStringList, imageFullPaths), Q_ARG(int, generation));
+        }
 
-        if (thumbsSortFlags & QDir::Reversed) {
-            std::sort(thumbFileInfoList.begin(), thumbFileInfoList.end(), [&](const QFileInfo &a, const QFileInfo &b) {
-                    return collator.compare(a.fileName(), b.fileName()) > 0;
-                    });
-        } else {
-            std::sort(thumbFileInfoList.begin(), thumbFileInfoList.end(), [&](const QFileInfo &a, const QFileInfo &b) {
-                    return collator.compare(a.fileName(), b.fileName()) < 0;
-                    });
+        if (!includeSubDirectories) {
+            return;
+        }
+        directory.clear();
+        while (directory.isEmpty() && dirIterator.hasNext() && !job->isCanceled()) {
+            dirIterator.next();
+            if (dirIterator.fileInfo().isDir() && dirIterator.fileName() != "." && dirIterator.fileName() != "..") {
+                directory = dirIterator.filePath();
+            }
+        }
+        if (directory.isEmpty()) {
+            return;
         }
     }
+}
 
-    static QStandardItem *thumbItem;
-    static int fileIndex;
-    static QPixmap emptyPixMap;
-    static QSize hintSize;
-    int thumbsAddedCounter = 1;
+void ThumbsViewer::onThumbsListed(const QStringList &imageFullPaths, int generation) {
+    if (generation != thumbsGeneration) {
+        return;
+    }
 
-    emptyPixMap = QPixmap::fromImage(emptyImg).scaled(thumbSize, thumbSize);
-    hintSize = Settings::thumbsLayout == Classic ?
+    QSize hintSize = Settings::thumbsLayout == Classic ?
         QSize(thumbSize, thumbSize + ((int) (QFontMetrics(font()).height() * 1.5))) :
         QSize(thumbSize, thumbSize);
 
-    for (fileIndex = 0; fileIndex < thumbFileInfoList.size(); ++fileIndex) {
-        thumbFileInfo = thumbFileInfoList.at(fileIndex);
+    QList<QStandardItem *> thumbItems;
+    for (int fileIndex = 0; fileIndex < imageFullPaths.size(); ++fileIndex) {
+        thumbFileInfo = QFileInfo(imageFullPaths.at(fileIndex));
 
-        metadataCache->loadImageMetadata(thumbFileInfo.filePath());
-        if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(thumbFileInfo.filePath())) {
-            continue;
-        }
-
-        thumbItem = new QStandardItem();
+        QStandardItem *thumbItem = new QStandardItem();
         thumbItem->setData(false, LoadedRole);
         thumbItem->setData(fileIndex, SortRole);
         thumbItem->setData(thumbFileInfo.filePath(), FileNameRole);
@@ -651,28 +1026,29 @@ void ThumbsViewer::initThumbs() {
             thumbItem->setTextAlignment(Qt::AlignTop | Qt::AlignHCenter);
             thumbItem->setText(thumbFileInfo.fileName());
         }
-
-        thumbsViewerModel->appendRow(thumbItem);
-
-        ++thumbsAddedCounter;
-        if (thumbsAddedCounter > 100) {
-            thumbsAddedCounter = 1;
-            QApplication::processEvents();
-        }
+        thumbItems.append(thumbItem);
     }
 
+    // One insertion for the whole directory instead of one per image
+    thumbsViewerModel->invisibleRootItem()->appendRows(thumbItems);
+
     imageTags->populateTagsTree();
+    imageTags->filterThumbs();
 
-    if (thumbFileInfoList.size() && selectionModel()->selectedIndexes().size() == 0) {
-        selectThumbByRow(0);
+    if (selectionModel()->selectedIndexes().size() == 0 && getFirstRow() >= 0) {
+        selectThumbByRow(getFirstRow());
     }
+
+    updateThumbsCount();
+    loadVisibleThumbs();
 }
 
 void ThumbsViewer::updateThumbsCount() {
     QString state;
 
-    if (thumbsViewerModel->rowCount() > 0) {
-        state = tr("%n image(s)", "", thumbsViewerModel->rowCount());
+    int shownThumbs = getShownThumbsCount();
+    if (shownThumbs > 0) {
+        state = tr("%n image(s)", "", shownThumbs);
     } else {
         state = tr("No images");
     }
@@ -685,7 +1061,7 @@ void ThumbsViewer::selectThumbByRow(int row) {
     selectCurrentIndex();
 }
 
-void ThumbsViewer::updateFoundDupesState(int duplicates, int filesScanned, int originalImages)
+void ThumbsViewer::updateFoundDupesState(int duplicates, int filesScanned, int originalImages, const QString &rate)
 {
     QString state;
     state = tr("Scanned %1, displaying %2 (%3 and %4)")
@@ -693,77 +1069,38 @@ void ThumbsViewer::updateFoundDupesState(int duplicates, int filesScanned, int o
                 .arg(tr("%n image(s)", "", originalImages + duplicates))
                 .arg(tr("%n original(s)", "", originalImages))
                 .arg(tr("%n duplicate(s)", "", duplicates));
+    if (!rate.isEmpty()) {
+        state += " - " + rate;
+    }
     phototonic->setStatus(state);
 }
 
-void ThumbsViewer::findDupes(bool resetCounters)
-{
-    thumbFileInfoList = thumbsDir->entryInfoList();
-    int processEventsCounter = 0;
-    static int originalImages;
-    static int foundDups;
-    static int totalFiles;
-    if (resetCounters) {
-        originalImages = totalFiles = foundDups = 0;
-    }
-
-    for (int currThumb = 0; currThumb < thumbFileInfoList.size(); ++currThumb) {
-        thumbFileInfo = thumbFileInfoList.at(currThumb);
-        QImage image = QImage(thumbFileInfo.absoluteFilePath());
-        if (image.isNull()) {
-            qWarning() << "invalid image" << thumbFileInfo.fileName();
-            continue;
-        }
-
-        QBitArray imageHash(64);
-        image = image.convertToFormat(QImage::Format_Grayscale8).scaled(9, 9, Qt::KeepAspectRatioByExpanding);
-        for (int y=0; y<8; y++) {
-            const uchar *line = image.scanLine(y);
-            const uchar *nextLine = image.scanLine(y+1);
-            for (int x=0; x<8; x++) {
-                imageHash.setBit(y * 8 + x, line[x] > line[x+1]);
-                //imageHash.setBit(y * 8 + x + 64, line[x] > nextLine[x]);
-            }
-        }
-
-        QString currentFilePath = thumbFileInfo.filePath();
-
-        totalFiles++;
-
-        if (dupImageHashes.contains(imageHash)) {
-            if (dupImageHashes[imageHash].duplicates < 1) {
-                addThumb(dupImageHashes[imageHash].filePath);
-                originalImages++;
-            }
-
-            foundDups++;
-            dupImageHashes[imageHash].duplicates++;
-            addThumb(currentFilePath);
-        } else {
-            DuplicateImage dupImage;
-            dupImage.filePath = currentFilePath;
-            dupImage.duplicates = 0;
-            dupImageHashes.insert(imageHash, dupImage);
-        }
-
-        ++processEventsCounter;
-        if (processEventsCounter > 9) {
-            processEventsCounter = 0;
-            QApplication::processEvents();
+void ThumbsViewer::selectByBrightness(qreal min, qreal max) {
+    QList<int> rows;
+    for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
+        if (!thumbsViewerModel->item(row)->data(LoadedRole).toBool()) {
+            rows.append(row);
         }
+    }
 
-        updateFoundDupesState(foundDups, totalFiles, originalImages);
-
-        if (isAbortThumbsLoading) {
-            break;
-        }
+    if (allThumbsJob) {
+        allThumbsJob->cancel();
+    }
+    allThumbsJob = loadThumbs(rows, Job::NormalPriority);
+    if (!allThumbsJob) {
+        selectLoadedByBrightness(min, max);
+        return;
     }
 
-    updateFoundDupesState(foundDups, totalFiles, originalImages);
+    // The brightness is computed from the thumbnails, so the selection waits for all of them
+    connect(allThumbsJob, &Job::finished, this, [this, min, max](bool canceled) {
+        if (!canceled) {
+            selectLoadedByBrightness(min, max);
+        }
+    });
 }
 
-void ThumbsViewer::selectByBrightness(qreal min, qreal max) {
-    loadAllThumbs();
+void ThumbsViewer::selectLoadedByBrightness(qreal min, qreal max) {
     QItemSelection sel;
     for (int row = 0; row < thumbsViewerModel->rowCount(); ++row) {
         QModelIndex idx = thumbsViewerModel->index(row, 0);
@@ -777,117 +1114,183 @@ void ThumbsViewer::selectByBrightness(qreal min, qreal max) {
     selectionModel()->select(sel, QItemSelectionModel::Select);
 }
 
-void ThumbsViewer::loadAllThumbs() {
-    QProgressDialog progress(tr("Loading thumbnails..."), tr("Abort"), 0, thumbFileInfoList.count(), this);
-    for (int i = 0; i < thumbFileInfoList.count(); ++i) {
-        progress.setValue(i);
-        if (progress.wasCanceled())
-            break;
-        if (thumbsViewerModel->item(i)->data(LoadedRole).toBool())
-            continue;
-        loadThumb(i);
+void ThumbsViewer::loadThumbsRange() {
+    int firstVisible = getFirstVisibleThumb();
+    int lastVisible = getLastVisibleThumb();
+    if (firstVisible < 0 || lastVisible < 0) {
+        return;
+    }
 
-        if (isAbortThumbsLoading) {
-            break;
+    if (scrolledForward) {
+        lastVisible += ((lastVisible - firstVisible) * (Settings::thumbsPagesReadCount + 1));
+        if (lastVisible >= thumbsViewerModel->rowCount()) {
+            lastVisible = thumbsViewerModel->rowCount() - 1;
+        }
+    } else {
+        firstVisible -= (lastVisible - firstVisible) * (Settings::thumbsPagesReadCount + 1);
+        if (firstVisible < 0) {
+            firstVisible = 0;
         }
 
-        QApplication::processEvents();
+        lastVisible += 10;
+        if (lastVisible >= thumbsViewerModel->rowCount()) {
+            lastVisible = thumbsViewerModel->rowCount() - 1;
+        }
     }
-}
 
-void ThumbsViewer::loadThumbsRange() {
-    static bool isInProgress = false;
-    static int currentRowCount;
-    int currThumb;
-
-    if (isInProgress) {
-        isAbortThumbsLoading = true;
-        QTimer::singleShot(0, this, SLOT(loadThumbsRange()));
+    if (thumbsRangeFirst == firstVisible && thumbsRangeLast == lastVisible) {
         return;
     }
 
-    isInProgress = true;
-    currentRowCount = thumbsViewerModel->rowCount();
+    thumbsRangeFirst = firstVisible;
+    thumbsRangeLast = lastVisible;
 
-    for (scrolledForward ? currThumb = thumbsRangeFirst : currThumb = thumbsRangeLast;
-         (scrolledForward ? currThumb <= thumbsRangeLast : currThumb >= thumbsRangeFirst);
-         scrolledForward ? ++currThumb : --currThumb) {
+    QList<int> rows;
+    for (int row = thumbsRangeFirst; row <= thumbsRangeLast; ++row) {
+        if (!thumbsViewerModel->item(row)->data(LoadedRole).toBool() && !isRowHidden(row)) {
+            rows.append(row);
+        }
+    }
 
-        if (isAbortThumbsLoading || thumbsViewerModel->rowCount() != currentRowCount || currThumb < 0)
-            break;
+    // The thumbnails come in from where the view is scrolling to
+    if (!scrolledForward) {
+        std::reverse(rows.begin(), rows.end());
+    }
 
-        if (thumbsViewerModel->item(currThumb)->data(LoadedRole).toBool())
-            continue;
+    // What the previous range still had queued is either in this one or scrolled away
+    if (rangeThumbsJob) {
+        rangeThumbsJob->cancel();
+    }
+    rangeThumbsJob = loadThumbs(rows, Job::HighPriority);
+}
 
-        loadThumb(currThumb);
+Job *ThumbsViewer::loadThumbs(const QList<int> &rows, Job::Priority priority) {
+    if (rows.isEmpty()) {
+        return 0;
+    }
 
-        QApplication::processEvents();
+    QStringList imageFullPaths;
+    QSharedPointer<QVector<ThumbSlot> > thumbs(new QVector<ThumbSlot>(rows.size()));
+    for (int item = 0; item < rows.size(); ++item) {
+        QStandardItem *thumbItem = thumbsViewerModel->item(rows.at(item));
+        imageFullPaths.append(thumbItem->data(FileNameRole).toString());
+        // Follows the row when rows are inserted or removed before the thumbnail is ready
+        (*thumbs)[item].index = QPersistentModelIndex(thumbItem->index());
+        (*thumbs)[item].decoded = false;
     }
 
-    isInProgress = false;
-    isAbortThumbsLoading = false;
+    ThumbSlot *thumbSlots = thumbs->data();
+    int size = thumbSize;
+    bool squares = Settings::thumbsLayout == Squares;
+    bool exifRotation = Settings::exifThumbRotationEnabled;
+    MetadataCache *cache = metadataCache;
+    Job *job = new Job(tr("Load %n thumbnail(s)", "", rows.size()), rows.size(),
+                       [imageFullPaths, thumbSlots, size, squares, exifRotation, cache](int item, QString &) {
+        ThumbSlot &slot = thumbSlots[item];
+        if (decodeThumb(imageFullPaths.at(item), size, squares, exifRotation, cache, slot.thumb)) {
+            slot.brightness = qGray(slot.thumb.scaled(1, 1).pixel(0, 0)) / 255.0;
+        } else {
+            slot.thumb = QImage();
+        }
+        slot.decoded = true;
+        return !slot.thumb.isNull();
+    }, priority);
+
+    auto applyThumb = [this, thumbs](int item) {
+        ThumbSlot &slot = (*thumbs)[item];
+        if (!slot.decoded) {
+            return;
+        }
+        slot.decoded = false;
+
+        // Invalid once the row is removed or the model is cleared for another directory
+        if (slot.index.isValid()) {
+            QStandardItem *thumbItem = thumbsViewerModel->itemFromIndex(slot.index);
+            if (slot.thumb.isNull()) {
+                setBadThumb(thumbItem);
+            } else {
+                setThumb(thumbItem, slot.thumb, slot.brightness);
+            }
+        }
+        slot.thumb = QImage();
+    };
+    connect(job, &Job::itemFinished, this, applyThumb);
+    connect(job, &Job::finished, this, [thumbs, applyThumb]() {
+        // Thumbnails decoded after a cancel are still good
+        for (int item = 0; item < thumbs->size(); ++item) {
+            applyThumb(item);
+        }
+        thumbs->clear();
+    });
+
+    jobScheduler->submit(job);
+    return job;
 }
 
-bool ThumbsViewer::loadThumb(int currThumb) {
-    static QSize currentThumbSize;
-    QImageReader thumbReader;
-    QString imageFileName = thumbsViewerModel->item(currThumb)->data(FileNameRole).toString();
-    QImage thumb;
-    bool imageReadOk = false;
+bool ThumbsViewer::decodeThumb(const QString &imageFullPath, int thumbSize, bool squares, bool exifRotation,
+                               MetadataCache *metadataCache, QImage &thumb) {
+    ImageFileBuffer imageFile(imageFullPath);
+    QImageReader &thumbReader = imageFile.reader();
+    Qt::AspectRatioMode aspectRatioMode = squares ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio;
 
-    thumbReader.setFileName(imageFileName);
-    currentThumbSize = thumbReader.size();
+    QSize currentThumbSize = thumbReader.size();
+    if (!currentThumbSize.isValid()) {
+        return false;
+    }
 
-    if (currentThumbSize.isValid()) {
-        if (currentThumbSize.width() > thumbSize || currentThumbSize.height() > thumbSize) {
-            currentThumbSize.scale(QSize(thumbSize, thumbSize), Settings::thumbsLayout == Squares ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio);
-        }
+    if (currentThumbSize.width() > thumbSize || currentThumbSize.height() > thumbSize) {
+        currentThumbSize.scale(QSize(thumbSize, thumbSize), aspectRatioMode);
+    }
 
-        thumbReader.setScaledSize(currentThumbSize);
-        imageReadOk = thumbReader.read(&thumb);
+    thumbReader.setScaledSize(currentThumbSize);
+    if (!thumbReader.read(&thumb)) {
+        return false;
     }
 
-    if (imageReadOk) {
-        if (Settings::exifThumbRotationEnabled) {
-            imageViewer->rotateByExifRotation(thumb, imageFileName);
-            currentThumbSize = thumb.size();
-            currentThumbSize.scale(QSize(thumbSize, thumbSize), Settings::thumbsLayout == Squares ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio);
+    if (exifRotation) {
+        if (!metadataCache->contains(imageFullPath)) {
+            metadataCache->loadImageMetadata(imageFile);
         }
-
-        if (Settings::thumbsLayout == Squares) {
-            const QRect subRect((currentThumbSize.width() - thumbSize) / 2, (currentThumbSize.height() - thumbSize) / 2, thumbSize, thumbSize);
-            thumb = thumb.scaled(QSize(thumbSize, thumbSize), Qt::KeepAspectRatioByExpanding).copy(subRect);
+        long orientation = metadataCache->getImageOrientation(imageFullPath);
+        if (orientation > ImageTransforms::Normal && orientation <= ImageTransforms::Rotate270) {
+            thumb = ImageTransforms::orient(thumb, orientation);
         }
+        currentThumbSize = thumb.size();
+        currentThumbSize.scale(QSize(thumbSize, thumbSize), aspectRatioMode);
+    }
 
-        thumbsViewerModel->item(currThumb)->setIcon(QPixmap::fromImage(thumb));
-        thumbsViewerModel->item(currThumb)->setData(qGray(thumb.scaled(1, 1).pixel(0, 0)) / 255.0, BrightnessRole);
-        thumbsViewerModel->item(currThumb)->setData(true, LoadedRole);
-        if (Settings::thumbsLayout == Squares) {
-            thumbsViewerModel->item(currThumb)->setSizeHint(QSize(thumbSize, thumbSize));
-        }
-    } else {
-        thumbsViewerModel->item(currThumb)->setIcon(QIcon::fromTheme("image-missing",
-                                                                     QIcon(":/images/error_image.png")).pixmap(
-                BAD_IMAGE_SIZE, BAD_IMAGE_SIZE));
-        currentThumbSize.setHeight(BAD_IMAGE_SIZE);
-        currentThumbSize.setWidth(BAD_IMAGE_SIZE);
-        return false;
+    if (squares) {
+        const QRect subRect((currentThumbSize.width() - thumbSize) / 2, (currentThumbSize.height() - thumbSize) / 2, thumbSize, thumbSize);
+        thumb = thumb.scaled(QSize(thumbSize, thumbSize), Qt::KeepAspectRatioByExpanding).copy(subRect);
     }
     return true;
 }
 
+void ThumbsViewer::setThumb(QStandardItem *thumbItem, const QImage &thumb, qreal brightness) {
+    thumbItem->setIcon(QPixmap::fromImage(thumb));
+    thumbItem->setData(brightness, BrightnessRole);
+    thumbItem->setData(true, LoadedRole);
+    if (Settings::thumbsLayout == Squares) {
+        thumbItem->setSizeHint(QSize(thumbSize, thumbSize));
+    }
+}
+
+void ThumbsViewer::setBadThumb(QStandardItem *thumbItem) {
+    thumbItem->setIcon(QIcon::fromTheme("image-missing",
+                                        QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE, BAD_IMAGE_SIZE));
+    // Not decoded again on every scroll, reloadThumb() tries again once the file changed
+    thumbItem->setData(true, LoadedRole);
+}
+
 void ThumbsViewer::addThumb(QString &imageFullPath) {
+    insertThumb(thumbsViewerModel->rowCount(), imageFullPath, 0);
+}
 
+void ThumbsViewer::insertThumb(int row, QString &imageFullPath, int sortValue) {
     metadataCache->loadImageMetadata(imageFullPath);
-    if (imageTags->dirFilteringActive && imageTags->isImageFilteredOut(imageFullPath)) {
-        return;
-    }
 
     QStandardItem *thumbItem = new QStandardItem();
-    QImageReader thumbReader;
     QSize hintSize;
-    QSize currThumbSize;
-    static QImage thumb;
 
     if (Settings::thumbsLayout == Squares) {
         hintSize = QSize(thumbSize, thumbSize);
@@ -896,39 +1299,55 @@ void ThumbsViewer::addThumb(QString &imageFullPath) {
     }
 
     thumbFileInfo = QFileInfo(imageFullPath);
-    thumbItem->setData(true, LoadedRole);
-    thumbItem->setData(0, SortRole);
+    thumbItem->setData(false, LoadedRole);
+    thumbItem->setData(sortValue, SortRole);
     thumbItem->setData(thumbFileInfo.filePath(), FileNameRole);
     thumbItem->setTextAlignment(Qt::AlignTop | Qt::AlignHCenter);
     thumbItem->setData(thumbFileInfo.fileName(), Qt::DisplayRole);
     thumbItem->setSizeHint(hintSize);
 
-    thumbReader.setFileName(imageFullPath);
-    currThumbSize = thumbReader.size();
-    if (currThumbSize.isValid()) {
-        if (currThumbSize.width() > thumbSize || currThumbSize.height() > thumbSize) {
-            currThumbSize.scale(QSize(thumbSize, thumbSize), Settings::thumbsLayout == Squares ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio);
-        }
+    thumbsViewerModel->insertRow(row, thumbItem);
 
-        thumbReader.setScaledSize(currThumbSize);
-        thumb = thumbReader.read();
+    // The rows after it moved, so the same range may now hold thumbnails that are not loaded
+    thumbsRangeFirst = -1;
+    thumbsRangeLast = -1;
+    loadVisibleThumbs(verticalScrollBar()->value());
+}
 
-        if (Settings::exifThumbRotationEnabled) {
-            imageViewer->rotateByExifRotation(thumb, imageFullPath);
-            currThumbSize = thumb.size();
-            currThumbSize.scale(QSize(thumbSize, thumbSize), Settings::thumbsLayout == Squares ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio);
-        }
+int ThumbsViewer::removeThumbs(const QSet<QString> &imageFullPaths) {
+    int firstRemovedRow = ItemModelRows::removeRows(thumbsViewerModel, FileNameRole, imageFullPaths);
+    if (firstRemovedRow >= 0) {
+        thumbsRangeFirst = -1;
+        thumbsRangeLast = -1;
+    }
+    return firstRemovedRow;
+}
 
-        thumbItem->setIcon(QPixmap::fromImage(thumb));
-    } else {
-        thumbItem->setIcon(
-                QIcon::fromTheme("image-missing", QIcon(":/images/error_image.png")).pixmap(BAD_IMAGE_SIZE,
-                                                                                            BAD_IMAGE_SIZE));
-        currThumbSize.setHeight(BAD_IMAGE_SIZE);
-        currThumbSize.setWidth(BAD_IMAGE_SIZE);
+void ThumbsViewer::reloadThumb(int row) {
+    QStandardItem *thumbItem = thumbsViewerModel->item(row);
+    if (thumbItem && thumbItem->data(LoadedRole).toBool()) {
+        thumbItem->setData(false, LoadedRole);
+        thumbsRangeFirst = -1;
+        thumbsRangeLast = -1;
+        loadVisibleThumbs(verticalScrollBar()->value());
+    }
+}
+
+// Applies an orientation to an already loaded thumbnail without reading the image again
+void ThumbsViewer::rotateThumb(int row, int orientation) {
+    QStandardItem *thumbItem = thumbsViewerModel->item(row);
+    if (!thumbItem || !thumbItem->data(LoadedRole).toBool()) {
+        return;
+    }
+
+    QIcon thumbIcon = thumbItem->icon();
+    QList<QSize> thumbSizes = thumbIcon.availableSizes();
+    if (thumbSizes.isEmpty()) {
+        return;
     }
 
-    thumbsViewerModel->appendRow(thumbItem);
+    QImage thumb = thumbIcon.pixmap(thumbSizes.first()).toImage();
+    thumbItem->setIcon(QPixmap::fromImage(ImageTransforms::orient(thumb, orientation)));
 }
 
 void ThumbsViewer::mousePressEvent(QMouseEvent *event) {
@@ -941,11 +1360,7 @@ void ThumbsViewer::mousePressEvent(QMouseEvent *event) {
 }
 
 void ThumbsViewer::invertSelection() {
-    QItemSelection toggleSelection;
-    QModelIndex firstIndex = thumbsViewerModel->index(0, 0);
-    QModelIndex lastIndex = thumbsViewerModel->index(thumbsViewerModel->rowCount() - 1, 0);
-    toggleSelection.select(firstIndex, lastIndex);
-    selectionModel()->select(toggleSelection, QItemSelectionModel::Toggle);
+    selectionModel()->select(getShownRowsSelection(), QItemSelectionModel::Toggle);
 }
 
 void ThumbsViewer::setNeedToScroll(bool needToScroll) {
@@ -28,6 +28,11 @@
 #include "Tags.h"
 #include "MetadataCache.h"
 #include "ImagePreview.h"
+#include "ImageHasher.h"
+#include "ExactDuplicateFinder.h"
+#include "HammingBkTree.h"
+#include "ProgressReporter.h"
+#include "JobScheduler.h"
 
 class Phototonic;
 
@@ -35,6 +40,8 @@ class ImageViewer;
 
 #define BAD_IMAGE_SIZE 64
 #define WINDOW_ICON_SIZE 48
+#define IMAGE_INFO_CACHE_SIZE 200
+#define MAX_HASH_DISTANCE 128
 
 class ImageTags;
 
@@ -59,7 +66,7 @@ public:
         Squares
     };
 
-    ThumbsViewer(QWidget *parent, MetadataCache *metadataCache);
+    ThumbsViewer(QWidget *parent, MetadataCache *metadataCache, JobScheduler *jobScheduler);
 
     void loadPrepare();
 
@@ -71,8 +78,6 @@ public:
 
     void loadFileList();
 
-    void loadSubDirectories();
-
     void setThumbColors();
 
     bool setCurrentIndexByName(QString &fileName);
@@ -89,6 +94,13 @@ public:
 
     void addThumb(QString &imageFullPath);
 
+    void insertThumb(int row, QString &imageFullPath, int sortValue);
+
+    void rotateThumb(int row, int orientation);
+
+    // Removes the thumbnails of the files in one pass, returns the first removed row or -1
+    int removeThumbs(const QSet<QString> &imageFullPaths);
+
     void abort();
 
     void selectThumbByRow(int row);
@@ -99,10 +111,20 @@ public:
 
     int getPrevRow();
 
+    int getFirstRow();
+
     int getLastRow();
 
     int getRandomRow();
 
+    // Rows not hidden by the tag filter
+    int getShownThumbsCount();
+
+    void onThumbsFiltered();
+
+    // Reads the thumbnail again when it is next shown, after the image file changed
+    void reloadThumb(int row);
+
     int getCurrentRow();
 
     QStringList getSelectedThumbsList();
@@ -121,6 +143,8 @@ public:
     int thumbSize;
     QString filterString;
     bool isBusy;
+    // Directories and saved file lists the duplicate search compares against, empty for a plain search
+    QStringList dupReferencePaths;
 
 protected:
     void startDrag(Qt::DropActions);
@@ -128,31 +152,86 @@ protected:
     void mousePressEvent(QMouseEvent *event);
 
 private:
+    // Lists the current directory, and its subdirectories if enabled, in a job
     void initThumbs();
 
-    bool loadThumb(int row);
+    // Runs on the listing job worker, posts the images of each directory to onThumbsListed()
+    void listThumbs(const QDir &dir, QDir::SortFlags sortFlags, bool includeSubDirectories, int generation,
+                    const Job *job);
 
-    void findDupes(bool resetCounters);
+    // Decodes the thumbnails in a job, they are applied as they come in unless the rows are gone
+    Job *loadThumbs(const QList<int> &rows, Job::Priority priority);
+
+    // Safe to call from job workers
+    static bool decodeThumb(const QString &imageFullPath, int thumbSize, bool squares, bool exifRotation,
+                            MetadataCache *metadataCache, QImage &thumb);
+
+    void setThumb(QStandardItem *thumbItem, const QImage &thumb, qreal brightness);
+
+    void setBadThumb(QStandardItem *thumbItem);
+
+    void selectLoadedByBrightness(qreal min, qreal max);
 
     int getFirstVisibleThumb();
 
     int getLastVisibleThumb();
 
+    QItemSelection getShownRowsSelection();
+
     void updateThumbsCount();
 
-    void updateFoundDupesState(int duplicates, int filesScanned, int originalImages);
+    void updateFoundDupesState(int duplicates, int filesScanned, int originalImages, const QString &rate = QString());
+
+    int addDuplicateGroup(const QString &imageFullPath, const ImageHash &hash);
+
+    void addDuplicateToGroup(int group, const QString &imageFullPath, int distance);
+
+    void insertDuplicateThumb(const QString &imageFullPath, int group, int distance);
+
+    QStringList collectReferenceImages();
 
     void updateImageInfoViewer(int row);
 
+    // Parsed format and metadata entries, valid while the file and its sidecar are unchanged
+    struct CachedImageInfo {
+        QDateTime modified;
+        qint64 size;
+        qint64 sidecarModified;
+        bool isReadable;
+        InfoEntryList formatEntries;
+        InfoEntryList metadataEntries;
+    };
+
+    void readImageInfo(const QString &imageFullPath, CachedImageInfo &imageInfo);
+
     QFileInfo thumbFileInfo;
     QFileInfoList thumbFileInfoList;
-    QImage emptyImg;
     QModelIndex currentIndex;
     Phototonic *phototonic;
     MetadataCache *metadataCache;
+    JobScheduler *jobScheduler;
+    QPointer<Job> listJob;
+    QPointer<Job> rangeThumbsJob;
+    QPointer<Job> allThumbsJob;
+    // Changes on every reload, so rows listed for an earlier directory are dropped
+    int thumbsGeneration;
     ImageViewer *imageViewer;
-    QHash<QBitArray, DuplicateImage> dupImageHashes;
-    bool isAbortThumbsLoading;
+    ExactDuplicateFinder *exactDuplicateFinder;
+    ImageHasher *imageHasher;
+    ProgressReporter *dupProgress;
+    // Hashes of the group leaders, valued by their index in dupGroups
+    HammingBkTree dupGroupLeaders;
+    QVector<DuplicateImage> dupGroups;
+    // Byte-identical copies keyed by their original, they skip the perceptual hashing
+    QHash<QString, QStringList> dupExactCopies;
+    // Reference search: the reference images are hashed first, then only the query images are matched
+    bool dupHashingReference;
+    QStringList dupQueryImages;
+    int dupOriginalImages;
+    int dupFoundImages;
+    int dupScannedImages;
+    QCache<QString, CachedImageInfo> imageInfoCache;
+    bool isAbortDuplicatesSearch;
     bool isNeedToScroll;
     int currentRow;
     bool scrolledForward;
@@ -170,11 +249,29 @@ public slots:
 
     void invertSelection();
 
+    void selectAll() override;
+
 private slots:
 
     void loadThumbsRange();
 
-    void loadAllThumbs();
+    void onThumbsListed(const QStringList &imageFullPaths, int generation);
+
+    void updateCurrentImageInfo();
+
+    void onExactDuplicatesFound(const QStringList &identicalImages);
+
+    void onExactDuplicatesSearchFinished(const QStringList &distinctImages, bool canceled);
+
+    void onDuplicateCandidateHashed(const QString &imageFullPath, const ImageHash &hash);
+
+    void onDuplicateCandidateFailed(const QString &imageFullPath);
+
+    void onDuplicateCandidatesHashed(bool canceled);
+
+    void onDuplicatesProgress();
+
+    void onDuplicatesSearchFinished();
 };
 
 #endif // THUMBS_VIEWER_H
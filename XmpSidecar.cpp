@@ -0,0 +1,179 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDebug>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <exiv2/exiv2.hpp>
+#include "MetadataIndex.h"
+#include "XmpSidecar.h"
+
+namespace {
+const char PhototonicNamespace[] = "http://oferkv.github.io/phototonic/xmp/1.0/";
+const char KeywordsKey[] = "Xmp.dc.subject";
+const char OrientationKey[] = "Xmp.tiff.Orientation";
+// Set once Phototonic wrote the keywords, they then replace the embedded ones instead of adding to them
+const char KeywordsEditedKey[] = "Xmp.phototonic.KeywordsEdited";
+
+Exiv2::Image::AutoPtr openSidecar(const QString &sidecarFullPath, bool create) {
+    if (QFile::exists(sidecarFullPath)) {
+        Exiv2::Image::AutoPtr sidecar = Exiv2::ImageFactory::open(sidecarFullPath.toStdString());
+        sidecar->readMetadata();
+        return sidecar;
+    }
+
+    if (!create) {
+        return Exiv2::Image::AutoPtr();
+    }
+    return Exiv2::ImageFactory::create(Exiv2::ImageType::xmp, sidecarFullPath.toStdString());
+}
+
+// The XMP toolkit keeps global state, parsing and serializing from several threads must be serialized
+QMutex xmpMutex(QMutex::Recursive);
+
+void lockXmp(void *, bool lockUnlock) {
+    if (lockUnlock) {
+        xmpMutex.lock();
+    } else {
+        xmpMutex.unlock();
+    }
+}
+
+void eraseKey(Exiv2::XmpData &xmpData, const char *key) {
+    Exiv2::XmpData::iterator it = xmpData.findKey(Exiv2::XmpKey(key));
+    if (it != xmpData.end()) {
+        xmpData.erase(it);
+    }
+}
+}
+
+namespace XmpSidecar {
+
+    void initialize() {
+        Exiv2::XmpParser::initialize(lockXmp);
+        try {
+            Exiv2::XmpProperties::registerNs(PhototonicNamespace, "phototonic");
+        } catch (Exiv2::Error &error) {
+            qWarning() << "Failed to register XMP namespace" << error.what();
+        }
+    }
+
+    QString path(const QString &imageFullPath) {
+        return imageFullPath + ".xmp";
+    }
+
+    qint64 lastModified(const QString &imageFullPath) {
+        QFileInfo sidecarInfo(path(imageFullPath));
+        return sidecarInfo.exists() ? sidecarInfo.lastModified().toMSecsSinceEpoch() : 0;
+    }
+
+    bool read(const QString &imageFullPath, ImageMetadata &imageMetadata) {
+        const QString sidecarFullPath = path(imageFullPath);
+        if (!QFile::exists(sidecarFullPath)) {
+            return false;
+        }
+
+        try {
+            Exiv2::Image::AutoPtr sidecar = openSidecar(sidecarFullPath, false);
+            Exiv2::XmpData &xmpData = sidecar->xmpData();
+
+            TagIdList tagIds;
+            Exiv2::XmpData::iterator it = xmpData.findKey(Exiv2::XmpKey(KeywordsKey));
+            if (it != xmpData.end()) {
+                for (long i = 0; i < it->count(); ++i) {
+                    TagDictionary::insert(tagIds, TagDictionary::intern(QString::fromUtf8(it->toString(i).c_str())));
+                }
+            }
+
+            if (xmpData.findKey(Exiv2::XmpKey(KeywordsEditedKey)) != xmpData.end()) {
+                imageMetadata.tagIds = tagIds;
+            } else {
+                for (int i = 0; i < tagIds.size(); ++i) {
+                    TagDictionary::insert(imageMetadata.tagIds, tagIds.at(i));
+                }
+            }
+
+            it = xmpData.findKey(Exiv2::XmpKey(OrientationKey));
+            if (it != xmpData.end()) {
+                imageMetadata.orientation = it->toLong();
+            }
+        } catch (Exiv2::Error &error) {
+            qWarning() << "Failed to read XMP sidecar" << sidecarFullPath << error.what();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool writeTags(const QString &imageFullPath, const QSet<QString> &tags, QString &error) {
+        try {
+            Exiv2::Image::AutoPtr sidecar = openSidecar(path(imageFullPath), true);
+            Exiv2::XmpData &xmpData = sidecar->xmpData();
+
+            eraseKey(xmpData, KeywordsKey);
+            if (!tags.isEmpty()) {
+                Exiv2::Value::AutoPtr value = Exiv2::Value::create(Exiv2::xmpBag);
+                QSetIterator<QString> tagsIt(tags);
+                while (tagsIt.hasNext()) {
+                    value->read(tagsIt.next().toStdString());
+                }
+                xmpData.add(Exiv2::XmpKey(KeywordsKey), value.get());
+            }
+            xmpData[KeywordsEditedKey] = std::string("True");
+
+            sidecar->writeMetadata();
+        } catch (Exiv2::Error &exiv2Error) {
+            error = QString::fromUtf8(exiv2Error.what());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool writeOrientation(const QString &imageFullPath, long orientation, QString &error) {
+        try {
+            Exiv2::Image::AutoPtr sidecar = openSidecar(path(imageFullPath), true);
+            sidecar->xmpData()[OrientationKey] = QString::number(orientation).toStdString();
+            sidecar->writeMetadata();
+        } catch (Exiv2::Error &exiv2Error) {
+            error = QString::fromUtf8(exiv2Error.what());
+            return false;
+        }
+
+        return true;
+    }
+
+    bool resetOrientation(const QString &imageFullPath, QString &error) {
+        try {
+            Exiv2::Image::AutoPtr sidecar = openSidecar(path(imageFullPath), false);
+            if (!sidecar.get() || sidecar->xmpData().findKey(Exiv2::XmpKey(OrientationKey)) == sidecar->xmpData().end()) {
+                return true;
+            }
+
+            eraseKey(sidecar->xmpData(), OrientationKey);
+            sidecar->writeMetadata();
+        } catch (Exiv2::Error &exiv2Error) {
+            error = QString::fromUtf8(exiv2Error.what());
+            return false;
+        }
+
+        return true;
+    }
+}
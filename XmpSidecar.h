@@ -0,0 +1,53 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XMP_SIDECAR_H
+#define XMP_SIDECAR_H
+
+#include <QSet>
+#include <QString>
+
+class ImageMetadata;
+
+/*
+ * XMP sidecar files (<image>.xmp) that hold keywords and orientation, so editing them rewrites a
+ * small text file instead of the image. Keywords go to Xmp.dc.subject and orientation to
+ * Xmp.tiff.Orientation, which other tools read as well.
+ */
+namespace XmpSidecar {
+    // Registers the XMP namespace and initializes the XMP toolkit with a lock, so metadata can be
+    // parsed on several threads. Call once before any threads start.
+    void initialize();
+
+    QString path(const QString &imageFullPath);
+
+    // Modification time of the sidecar in ms since the epoch, 0 when the image has none
+    qint64 lastModified(const QString &imageFullPath);
+
+    // Merges the sidecar of the image, if any, into metadata read from the image itself
+    bool read(const QString &imageFullPath, ImageMetadata &imageMetadata);
+
+    bool writeTags(const QString &imageFullPath, const QSet<QString> &tags, QString &error);
+
+    bool writeOrientation(const QString &imageFullPath, long orientation, QString &error);
+
+    // Drops the sidecar orientation after the pixels were rotated upright, no-op without one
+    bool resetOrientation(const QString &imageFullPath, QString &error);
+}
+
+#endif // XMP_SIDECAR_H
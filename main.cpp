@@ -17,11 +17,13 @@
  */
 
 #include "Phototonic.h"
+#include "XmpSidecar.h"
 #include <QApplication>
 #include <QCommandLineParser>
 
 int main(int argc, char *argv[]) {
     QApplication QApp(argc, argv);
+    XmpSidecar::initialize();
     QLocale locale = QLocale::system();
     QCoreApplication::setApplicationVersion(VERSION);
 
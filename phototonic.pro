@@ -23,14 +23,14 @@ INCLUDEPATH += /usr/local/include
 win32-g++ {
 MINGWEXIVPATH = $$PWD/mingw
 
-LIBS += -L$$MINGWEXIVPATH/lib/ -lexiv2 -lexpat -lz
+LIBS += -L$$MINGWEXIVPATH/lib/ -lexiv2 -lexpat -lz -ljpeg
 
 INCLUDEPATH += $$MINGWEXIVPATH/include
 DEPENDPATH += $$MINGWEXIVPATH/include
 
 PRE_TARGETDEPS += $$MINGWEXIVPATH/lib/libexiv2.a $$MINGWEXIVPATH/lib/libexpat.a $$MINGWEXIVPATH/lib/libz.a
 }
-else: LIBS += -L/usr/local/lib -lexiv2
+else: LIBS += -L/usr/local/lib -lexiv2 -ljpeg
 QT += widgets
 QMAKE_CXXFLAGS += $$(CXXFLAGS)
 QMAKE_CFLAGS += $$(CFLAGS)
@@ -38,17 +38,17 @@ QMAKE_LFLAGS += $$(LDFLAGS)
 CONFIG += c++11
 
 HEADERS += Phototonic.h ThumbsViewer.h ImageViewer.h CropRubberband.h SettingsDialog.h Settings.h InfoViewer.h \
-			FileSystemTree.h Bookmarks.h DirCompleter.h Tags.h MetadataCache.h ShortcutsTable.h CopyMoveDialog.h \
-			CopyMoveToDialog.h CropDialog.h ProgressDialog.h ColorsDialog.h ResizeDialog.h ExternalAppsDialog.h \
+			FileSystemTree.h Bookmarks.h DirCompleter.h Tags.h MetadataCache.h ShortcutsTable.h \
+			CopyMoveToDialog.h CropDialog.h ColorsDialog.h ResizeDialog.h ExternalAppsDialog.h \
 			ImagePreview.h ImageWidget.h FileSystemModel.h FileListWidget.h RenameDialog.h Trashcan.h MessageBox.h \
-			GuideWidget.h RangeInputDialog.h
+			GuideWidget.h RangeInputDialog.h ImageTransforms.h LosslessJpeg.h MetadataIndex.h TagDictionary.h TagWriteQueue.h XmpSidecar.h BoundedFileIo.h ImageFileBuffer.h MetadataStripper.h ImageHasher.h ImageHashIndex.h HammingBkTree.h ExactDuplicateFinder.h ImageHash.h ProgressReporter.h JobScheduler.h JobsPanel.h FileTransfer.h ItemModelRows.h
 
 SOURCES += main.cpp Phototonic.cpp ThumbsViewer.cpp ImageViewer.cpp CropRubberband.cpp SettingsDialog.cpp \
 			Settings.cpp InfoViewer.cpp FileSystemTree.cpp Bookmarks.cpp DirCompleter.cpp Tags.cpp \
-			MetadataCache.cpp ShortcutsTable.cpp CopyMoveDialog.cpp CopyMoveToDialog.cpp CropDialog.cpp \
-			ProgressDialog.cpp ExternalAppsDialog.cpp ColorsDialog.cpp ResizeDialog.cpp ImagePreview.cpp \
+			MetadataCache.cpp ShortcutsTable.cpp CopyMoveToDialog.cpp CropDialog.cpp \
+			ExternalAppsDialog.cpp ColorsDialog.cpp ResizeDialog.cpp ImagePreview.cpp \
 			ImageWidget.cpp FileSystemModel.cpp FileListWidget.cpp RenameDialog.cpp Trashcan.cpp MessageBox.cpp \
-			GuideWidget.cpp RangeInputDialog.cpp
+			GuideWidget.cpp RangeInputDialog.cpp ImageTransforms.cpp LosslessJpeg.cpp MetadataIndex.cpp TagDictionary.cpp TagWriteQueue.cpp XmpSidecar.cpp BoundedFileIo.cpp ImageFileBuffer.cpp MetadataStripper.cpp ImageHasher.cpp ImageHashIndex.cpp HammingBkTree.cpp ExactDuplicateFinder.cpp ProgressReporter.cpp JobScheduler.cpp JobsPanel.cpp FileTransfer.cpp ItemModelRows.cpp
 
 FORMS += RangeInputDialog.ui
 
@@ -0,0 +1,8 @@
+include(../tests.pri)
+
+TARGET = tst_filetransfer
+
+HEADERS += $$SOURCE_DIR/FileTransfer.h $$SOURCE_DIR/JobScheduler.h $$SOURCE_DIR/ProgressReporter.h
+
+SOURCES += tst_filetransfer.cpp $$SOURCE_DIR/FileTransfer.cpp $$SOURCE_DIR/JobScheduler.cpp \
+			$$SOURCE_DIR/ProgressReporter.cpp
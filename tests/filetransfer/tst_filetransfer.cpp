@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include "FileTransfer.h"
+
+namespace {
+bool writeFile(const QString &filePath, const QByteArray &data) {
+    QFile file(filePath);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+
+QByteArray readFile(const QString &filePath) {
+    QFile file(filePath);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+}
+
+class TestFileTransfer : public QObject {
+Q_OBJECT
+
+private slots:
+
+    void uniqueFileName_data() {
+        QTest::addColumn<QString>("fileName");
+        QTest::addColumn<QStringList>("takenNames");
+        QTest::addColumn<QString>("expected");
+
+        QTest::newRow("free") << "image.jpg" << QStringList() << "image.jpg";
+        QTest::newRow("taken") << "image.jpg" << (QStringList() << "image.jpg") << "image_copy_1.jpg";
+        QTest::newRow("copy taken") << "image.jpg" << (QStringList() << "image.jpg" << "image_copy_1.jpg")
+                                    << "image_copy_2.jpg";
+        QTest::newRow("other case taken") << "Image.JPG" << (QStringList() << "image.jpg") << "Image_copy_1.JPG";
+        QTest::newRow("last extension") << "photo.tar.gz" << (QStringList() << "photo.tar.gz")
+                                        << "photo.tar_copy_1.gz";
+        QTest::newRow("no extension") << "README" << (QStringList() << "readme") << "README_copy_1";
+        QTest::newRow("hidden file") << ".hidden" << (QStringList() << ".hidden") << ".hidden_copy_1";
+    }
+
+    void uniqueFileName() {
+        QFETCH(QString, fileName);
+        QFETCH(QStringList, takenNames);
+        QFETCH(QString, expected);
+
+        // Taken names are lower case, as listFileNames() gives them
+        QSet<QString> names;
+        foreach (const QString &name, takenNames) {
+            names.insert(name.toLower());
+        }
+
+        QCOMPARE(FileTransfer::uniqueFileName(fileName, names), expected);
+        QVERIFY(names.contains(expected.toLower()));
+    }
+
+    void uniqueFileNameWithinOneBatch() {
+        // Files of the same name from different source directories
+        QSet<QString> names;
+        QCOMPARE(FileTransfer::uniqueFileName("image.jpg", names), QString("image.jpg"));
+        QCOMPARE(FileTransfer::uniqueFileName("image.jpg", names), QString("image_copy_1.jpg"));
+        QCOMPARE(FileTransfer::uniqueFileName("IMAGE.jpg", names), QString("IMAGE_copy_2.jpg"));
+    }
+
+    void copyOrMoveFileKeepsExistingFiles() {
+        QTemporaryDir sourceDir;
+        QTemporaryDir destDir;
+        QVERIFY(sourceDir.isValid());
+        QVERIFY(destDir.isValid());
+
+        QString sourcePath = sourceDir.path() + "/image.jpg";
+        QVERIFY(writeFile(sourcePath, "new"));
+        QVERIFY(writeFile(destDir.path() + "/image.jpg", "existing"));
+        QCOMPARE(FileTransfer::listFileNames(destDir.path()), QSet<QString>() << "image.jpg");
+
+        QString destPath;
+        QString error;
+        QVERIFY2(FileTransfer::copyOrMoveFile(true, sourcePath, destDir.path(), destPath, error), qPrintable(error));
+        QCOMPARE(QFileInfo(destPath).fileName(), QString("image_copy_1.jpg"));
+        QCOMPARE(readFile(destPath), QByteArray("new"));
+        QCOMPARE(readFile(destDir.path() + "/image.jpg"), QByteArray("existing"));
+        QVERIFY(QFileInfo::exists(sourcePath));
+
+        QVERIFY2(FileTransfer::copyOrMoveFile(false, sourcePath, destDir.path(), destPath, error), qPrintable(error));
+        QCOMPARE(QFileInfo(destPath).fileName(), QString("image_copy_2.jpg"));
+        QCOMPARE(readFile(destPath), QByteArray("new"));
+        QVERIFY(!QFileInfo::exists(sourcePath));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestFileTransfer)
+
+#include "tst_filetransfer.moc"
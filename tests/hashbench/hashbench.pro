@@ -0,0 +1,27 @@
+#
+#  Copyright (C) 2013-2018 Ofer Kashayov <oferkv@live.com>
+#  This file is part of Phototonic Image Viewer.
+#
+#  Phototonic is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  Phototonic is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+include(../tests.pri)
+
+TARGET = tst_hashbench
+
+HEADERS += $$SOURCE_DIR/ImageHasher.h $$SOURCE_DIR/ImageHashIndex.h $$SOURCE_DIR/ImageHash.h \
+			$$SOURCE_DIR/JobScheduler.h $$SOURCE_DIR/ProgressReporter.h
+
+SOURCES += tst_hashbench.cpp $$SOURCE_DIR/ImageHasher.cpp $$SOURCE_DIR/ImageHashIndex.cpp \
+			$$SOURCE_DIR/JobScheduler.cpp $$SOURCE_DIR/ProgressReporter.cpp
@@ -0,0 +1,216 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <random>
+#include "ImageHasher.h"
+
+/*
+ * Benchmarks the perceptual hashes of the duplicate search: generated images are hashed along with
+ * edited copies of them, then the time per image and the precision and recall of matching a copy
+ * to its original are reported for each algorithm at a few distance thresholds.
+ */
+
+namespace {
+const int OriginalCount = 40;
+const int ImageWidth = 480;
+const int ImageHeight = 360;
+
+enum Variants {
+    LosslessCopy,
+    HalfSize,
+    LowQualityJpeg,
+    Brighter,
+    Cropped,
+    Noise,
+    VariantCount
+};
+
+const char *const VariantNames[VariantCount] = {
+    "lossless copy", "half size", "JPEG quality 40", "brighter", "cropped 5%", "noise"
+};
+
+// Shapes over a gradient, different enough from each other to count as distinct images
+QImage generateImage(std::mt19937 &random) {
+    std::uniform_int_distribution<int> channel(0, 255);
+    std::uniform_int_distribution<int> x(0, ImageWidth);
+    std::uniform_int_distribution<int> y(0, ImageHeight);
+    std::uniform_int_distribution<int> extent(ImageHeight / 10, ImageWidth / 2);
+    auto randomColor = [&]() {
+        return QColor(channel(random), channel(random), channel(random));
+    };
+
+    QImage image(ImageWidth, ImageHeight, QImage::Format_RGB32);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, x(random), ImageHeight);
+    gradient.setColorAt(0, randomColor());
+    gradient.setColorAt(1, randomColor());
+    painter.fillRect(image.rect(), gradient);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    for (int shape = 0; shape < 12; ++shape) {
+        painter.setBrush(randomColor());
+        QRect rect(x(random) - ImageWidth / 4, y(random) - ImageHeight / 4, extent(random), extent(random));
+        if (shape % 2) {
+            painter.drawEllipse(rect);
+        } else {
+            painter.drawRect(rect);
+        }
+    }
+    painter.end();
+    return image;
+}
+
+QImage offsetPixels(const QImage &image, std::mt19937 &random, int minOffset, int maxOffset) {
+    std::uniform_int_distribution<int> offset(minOffset, maxOffset);
+    QImage result = image.convertToFormat(QImage::Format_RGB32);
+    for (int y = 0; y < result.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(result.scanLine(y));
+        for (int x = 0; x < result.width(); ++x) {
+            int pixelOffset = offset(random);
+            line[x] = qRgb(qBound(0, qRed(line[x]) + pixelOffset, 255), qBound(0, qGreen(line[x]) + pixelOffset, 255),
+                           qBound(0, qBlue(line[x]) + pixelOffset, 255));
+        }
+    }
+    return result;
+}
+
+bool saveVariant(const QImage &original, int variant, std::mt19937 &random, const QString &imageFullPath) {
+    switch (variant) {
+        case HalfSize:
+            return original.scaled(original.size() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                    .save(imageFullPath, "PNG");
+        case LowQualityJpeg:
+            return original.save(imageFullPath, "JPG", 40);
+        case Brighter:
+            return offsetPixels(original, random, 24, 24).save(imageFullPath, "PNG");
+        case Cropped: {
+            int marginX = original.width() / 20;
+            int marginY = original.height() / 20;
+            return original.copy(original.rect().adjusted(marginX, marginY, -marginX, -marginY))
+                    .save(imageFullPath, "PNG");
+        }
+        case Noise:
+            return offsetPixels(original, random, -12, 12).save(imageFullPath, "PNG");
+        default:
+            return original.save(imageFullPath, "PNG");
+    }
+}
+}
+
+class TestHashBench : public QObject {
+Q_OBJECT
+
+private:
+    QTemporaryDir imageDir;
+    // The originals first, then each variant of all of them in the order of Variants
+    QStringList imageFullPaths;
+
+    int variantIndex(int variant, int original) const {
+        return (variant + 1) * OriginalCount + original;
+    }
+
+private slots:
+
+    void initTestCase() {
+        QVERIFY(imageDir.isValid());
+
+        std::mt19937 random(2018);
+        QVector<QImage> originals;
+        for (int original = 0; original < OriginalCount; ++original) {
+            originals.append(generateImage(random));
+            imageFullPaths.append(imageDir.path() + QString("/original%1.png").arg(original));
+            QVERIFY(originals.last().save(imageFullPaths.last(), "PNG"));
+        }
+
+        for (int variant = 0; variant < VariantCount; ++variant) {
+            for (int original = 0; original < OriginalCount; ++original) {
+                imageFullPaths.append(imageDir.path() + QString("/variant%1_%2.%3").arg(variant).arg(original)
+                        .arg(variant == LowQualityJpeg ? "jpg" : "png"));
+                QVERIFY(saveVariant(originals.at(original), variant, random, imageFullPaths.last()));
+            }
+        }
+    }
+
+    void hashAlgorithms_data() {
+        QTest::addColumn<int>("algorithm");
+        QTest::addColumn<int>("bits");
+
+        QTest::newRow("DifferenceHash64") << int(ImageHash::DifferenceHash64) << 64;
+        QTest::newRow("DifferenceHash128") << int(ImageHash::DifferenceHash128) << 128;
+        QTest::newRow("DctHash") << int(ImageHash::DctHash) << 64;
+        QTest::newRow("BlockMeanHash") << int(ImageHash::BlockMeanHash) << 64;
+    }
+
+    void hashAlgorithms() {
+        QFETCH(int, algorithm);
+        QFETCH(int, bits);
+
+        QVector<ImageHash> hashes(imageFullPaths.size());
+        QElapsedTimer timer;
+        timer.start();
+        for (int image = 0; image < imageFullPaths.size(); ++image) {
+            QVERIFY2(ImageHasher::computeHash(imageFullPaths.at(image), ImageHash::Algorithm(algorithm), hashes[image]),
+                     qPrintable(imageFullPaths.at(image)));
+        }
+        qDebug("%s: %.3f ms per image, decoding included", QTest::currentDataTag(),
+               timer.nsecsElapsed() / 1e6 / imageFullPaths.size());
+
+        // Every copy is compared with every original, only its own original is a match
+        for (int threshold = bits / 16; threshold <= 3 * bits / 16; threshold += bits / 16) {
+            int truePositives = 0;
+            int falsePositives = 0;
+            int falseNegatives = 0;
+            QStringList variantRecalls;
+            for (int variant = 0; variant < VariantCount; ++variant) {
+                int found = 0;
+                for (int original = 0; original < OriginalCount; ++original) {
+                    for (int copy = 0; copy < OriginalCount; ++copy) {
+                        bool matched = ImageHash::distance(hashes.at(original),
+                                                           hashes.at(variantIndex(variant, copy))) <= threshold;
+                        if (original == copy && matched) {
+                            ++found;
+                        } else if (original == copy) {
+                            ++falseNegatives;
+                        } else if (matched) {
+                            ++falsePositives;
+                        }
+                    }
+                }
+                truePositives += found;
+                variantRecalls.append(QString("%1 %2").arg(VariantNames[variant])
+                                              .arg(qreal(found) / OriginalCount, 0, 'f', 2));
+            }
+
+            qreal precision = truePositives + falsePositives
+                              ? qreal(truePositives) / (truePositives + falsePositives) : 1.0;
+            qreal recall = qreal(truePositives) / (truePositives + falseNegatives);
+            qDebug("%s at distance %d: precision %.3f, recall %.3f (%s)", QTest::currentDataTag(), threshold,
+                   precision, recall, qPrintable(variantRecalls.join(", ")));
+        }
+
+        // The same pixels give the same hash
+        for (int original = 0; original < OriginalCount; ++original) {
+            QCOMPARE(ImageHash::distance(hashes.at(original), hashes.at(variantIndex(LosslessCopy, original))), 0);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestHashBench)
+
+#include "tst_hashbench.moc"
@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_itemmodelrows
+
+HEADERS += $$SOURCE_DIR/ItemModelRows.h
+
+SOURCES += tst_itemmodelrows.cpp $$SOURCE_DIR/ItemModelRows.cpp
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include "ItemModelRows.h"
+
+namespace {
+const int PathRole = Qt::UserRole + 1;
+
+// Rows "0" to "rowCount - 1", with the path in PathRole and its name for display
+void fillModel(QStandardItemModel &model, int rowCount) {
+    for (int row = 0; row < rowCount; ++row) {
+        QStandardItem *item = new QStandardItem(QString::number(row));
+        item->setData(QString("/images/%1.jpg").arg(row), PathRole);
+        model.appendRow(item);
+    }
+}
+
+QSet<QString> paths(const QList<int> &rows) {
+    QSet<QString> rowPaths;
+    foreach (int row, rows) {
+        rowPaths.insert(QString("/images/%1.jpg").arg(row));
+    }
+    return rowPaths;
+}
+
+QStringList rowNames(const QStandardItemModel &model) {
+    QStringList names;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        names.append(model.item(row)->text());
+    }
+    return names;
+}
+}
+
+class TestItemModelRows : public QObject {
+Q_OBJECT
+
+private slots:
+
+    void removeRows_data() {
+        QTest::addColumn<QList<int> >("removedRows");
+        QTest::addColumn<int>("expectedFirstRow");
+        QTest::addColumn<QStringList>("expectedRows");
+        QTest::addColumn<int>("expectedRemoveCalls");
+
+        QTest::newRow("none") << QList<int>() << -1 << (QStringList() << "0" << "1" << "2" << "3" << "4" << "5") << 0;
+        QTest::newRow("not in the model") << (QList<int>() << 9) << -1
+                                          << (QStringList() << "0" << "1" << "2" << "3" << "4" << "5") << 0;
+        QTest::newRow("single") << (QList<int>() << 3) << 3 << (QStringList() << "0" << "1" << "2" << "4" << "5") << 1;
+        QTest::newRow("block") << (QList<int>() << 1 << 2 << 3) << 1 << (QStringList() << "0" << "4" << "5") << 1;
+        QTest::newRow("two blocks") << (QList<int>() << 0 << 1 << 4 << 5) << 0 << (QStringList() << "2" << "3") << 2;
+        QTest::newRow("scattered") << (QList<int>() << 1 << 3 << 5) << 1 << (QStringList() << "0" << "2" << "4") << 3;
+        QTest::newRow("all") << (QList<int>() << 0 << 1 << 2 << 3 << 4 << 5) << 0 << QStringList() << 1;
+    }
+
+    void removeRows() {
+        QFETCH(QList<int>, removedRows);
+        QFETCH(int, expectedFirstRow);
+        QFETCH(QStringList, expectedRows);
+        QFETCH(int, expectedRemoveCalls);
+
+        QStandardItemModel model;
+        fillModel(model, 6);
+        QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+
+        QCOMPARE(ItemModelRows::removeRows(&model, PathRole, paths(removedRows)), expectedFirstRow);
+        QCOMPARE(rowNames(model), expectedRows);
+        QCOMPARE(removeSpy.count(), expectedRemoveCalls);
+    }
+
+    void removeRowsOnEmptyModel() {
+        QStandardItemModel model;
+        QCOMPARE(ItemModelRows::removeRows(&model, PathRole, paths(QList<int>() << 0)), -1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestItemModelRows)
+
+#include "tst_itemmodelrows.moc"
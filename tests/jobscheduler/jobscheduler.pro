@@ -0,0 +1,7 @@
+include(../tests.pri)
+
+TARGET = tst_jobscheduler
+
+HEADERS += $$SOURCE_DIR/JobScheduler.h $$SOURCE_DIR/ProgressReporter.h
+
+SOURCES += tst_jobscheduler.cpp $$SOURCE_DIR/JobScheduler.cpp $$SOURCE_DIR/ProgressReporter.cpp
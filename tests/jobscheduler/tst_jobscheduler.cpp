@@ -0,0 +1,201 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include "JobScheduler.h"
+
+namespace {
+// As many as the threads of the scheduler's pool
+int workerThreads() {
+    return qMax(2, QThread::idealThreadCount());
+}
+}
+
+class TestJobScheduler : public QObject {
+Q_OBJECT
+
+private:
+    JobScheduler *scheduler;
+
+    // Work functions that wait for it block a worker thread until released
+    QSemaphore gate;
+
+    QMutex mutex;
+    // Names of the items in the order they started
+    QStringList startedItems;
+    int fileLockHolders;
+    int maxFileLockHolders;
+
+    Job::WorkFunction recordStart(const QString &name, bool waitForGate = false) {
+        return [this, name, waitForGate](int, QString &) {
+            {
+                QMutexLocker locker(&mutex);
+                startedItems.append(name);
+            }
+            if (waitForGate) {
+                gate.acquire();
+            }
+            return true;
+        };
+    }
+
+    QStringList started() {
+        QMutexLocker locker(&mutex);
+        return startedItems;
+    }
+
+    QStringList startedWithout(const QString &name) {
+        QStringList items = started();
+        items.removeAll(name);
+        return items;
+    }
+
+    // Keeps every worker thread busy until the gate is released
+    void occupyWorkers() {
+        scheduler->submit(new Job("blocker", workerThreads(), recordStart("blocker", true)));
+    }
+
+private slots:
+
+    void init() {
+        scheduler = new JobScheduler(0);
+        startedItems.clear();
+        fileLockHolders = 0;
+        maxFileLockHolders = 0;
+    }
+
+    void cleanup() {
+        // Unblocks whatever a failed test left waiting
+        gate.release(1000);
+        delete scheduler;
+        scheduler = 0;
+        gate.acquire(gate.available());
+    }
+
+    void higherPriorityJobsRunFirst() {
+        occupyWorkers();
+
+        scheduler->submit(new Job("low", 1, recordStart("low"), Job::LowPriority));
+        scheduler->submit(new Job("normal1", 1, recordStart("normal1"), Job::NormalPriority));
+        scheduler->submit(new Job("high", 1, recordStart("high"), Job::HighPriority));
+        scheduler->submit(new Job("normal2", 1, recordStart("normal2"), Job::NormalPriority));
+
+        // One free thread, so the queued jobs start one after the other
+        gate.release(1);
+        QStringList expected = QStringList() << "high" << "normal1" << "normal2" << "low";
+        QTRY_COMPARE(startedWithout("blocker"), expected);
+    }
+
+    void dependentJobWaitsForDependency() {
+        Job *first = new Job("first", 3, recordStart("first", true));
+        Job *second = new Job("second", 1, recordStart("second"));
+        second->addDependency(first);
+        QSignalSpy finishedSpy(second, SIGNAL(finished(bool)));
+
+        // Submission order does not matter
+        scheduler->submit(second);
+        scheduler->submit(first);
+        QCOMPARE(second->state(), Job::Waiting);
+
+        gate.release(3);
+        QTRY_COMPARE(finishedSpy.count(), 1);
+        QCOMPARE(finishedSpy.at(0).at(0).toBool(), false);
+        QCOMPARE(started(), QStringList() << "first" << "first" << "first" << "second");
+    }
+
+    void canceledDependencyCancelsDependent() {
+        Job *first = new Job("first", 1, recordStart("first", true));
+        Job *second = new Job("second", 1, recordStart("second"));
+        second->addDependency(first);
+        QSignalSpy finishedSpy(second, SIGNAL(finished(bool)));
+        scheduler->submit(first);
+        scheduler->submit(second);
+
+        first->cancel();
+        gate.release(1);
+        QTRY_COMPARE(finishedSpy.count(), 1);
+        QCOMPARE(finishedSpy.at(0).at(0).toBool(), true);
+        QCOMPARE(second->state(), Job::Canceled);
+        QVERIFY(!started().contains("second"));
+    }
+
+    void cancelDropsItemsNotStarted() {
+        Job *job = new Job("canceled", 10, recordStart("canceled", true));
+        job->setMaxParallelItems(1);
+        QSignalSpy itemSpy(job, SIGNAL(itemFinished(int, bool, QString)));
+        QSignalSpy finishedSpy(job, SIGNAL(finished(bool)));
+        scheduler->submit(job);
+
+        QTRY_COMPARE(started().size(), 1);
+        job->cancel();
+        QVERIFY(job->isCanceled());
+
+        // Not finished while an item is still running
+        QCOMPARE(finishedSpy.count(), 0);
+        QCOMPARE(job->state(), Job::Running);
+
+        gate.release(1);
+        QTRY_COMPARE(finishedSpy.count(), 1);
+        QCOMPARE(finishedSpy.at(0).at(0).toBool(), true);
+        QCOMPARE(job->state(), Job::Canceled);
+        QCOMPARE(itemSpy.count(), 0);
+        QCOMPARE(started().size(), 1);
+    }
+
+    void oldDoneJobsArePruned() {
+        const int jobCount = JobScheduler::KeptDoneJobs + 5;
+        QList<QPointer<Job> > submittedJobs;
+        for (int i = 0; i < jobCount; ++i) {
+            Job *job = new Job(QString::number(i), 1, recordStart(QString::number(i)));
+            submittedJobs.append(job);
+            scheduler->submit(job);
+        }
+
+        QTRY_COMPARE(scheduler->jobs().size(), int(JobScheduler::KeptDoneJobs));
+        for (int i = 0; i < jobCount; ++i) {
+            QCOMPARE(submittedJobs.at(i).isNull(), i < jobCount - JobScheduler::KeptDoneJobs);
+        }
+
+        scheduler->removeDoneJobs();
+        QVERIFY(scheduler->jobs().isEmpty());
+    }
+
+    void fileLockSerializesRewrites() {
+        Job *job = new Job("rewrite", 4 * workerThreads(), [this](int, QString &) {
+            FileLock fileLock("/nonexistent/image.jpg");
+            {
+                QMutexLocker locker(&mutex);
+                maxFileLockHolders = qMax(maxFileLockHolders, ++fileLockHolders);
+            }
+            QThread::msleep(2);
+            QMutexLocker locker(&mutex);
+            --fileLockHolders;
+            return true;
+        });
+        QSignalSpy finishedSpy(job, SIGNAL(finished(bool)));
+        scheduler->submit(job);
+
+        QTRY_COMPARE(finishedSpy.count(), 1);
+        QCOMPARE(job->failedItems(), 0);
+        QCOMPARE(maxFileLockHolders, 1);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestJobScheduler)
+
+#include "tst_jobscheduler.moc"
@@ -0,0 +1,11 @@
+include(../tests.pri)
+
+TARGET = tst_metadatacache
+LIBS += -L/usr/local/lib -lexiv2
+
+HEADERS += $$SOURCE_DIR/MetadataCache.h $$SOURCE_DIR/MetadataIndex.h $$SOURCE_DIR/TagDictionary.h \
+			$$SOURCE_DIR/XmpSidecar.h $$SOURCE_DIR/BoundedFileIo.h $$SOURCE_DIR/ImageFileBuffer.h $$SOURCE_DIR/Settings.h
+
+SOURCES += tst_metadatacache.cpp $$SOURCE_DIR/MetadataCache.cpp $$SOURCE_DIR/MetadataIndex.cpp \
+			$$SOURCE_DIR/TagDictionary.cpp $$SOURCE_DIR/XmpSidecar.cpp $$SOURCE_DIR/BoundedFileIo.cpp \
+			$$SOURCE_DIR/ImageFileBuffer.cpp $$SOURCE_DIR/Settings.cpp
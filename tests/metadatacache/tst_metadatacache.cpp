@@ -0,0 +1,171 @@
+/*
+ *  Copyright (C) 2013-2015 Ofer Kashayov <oferkv@live.com>
+ *  This file is part of Phototonic Image Viewer.
+ *
+ *  Phototonic is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phototonic is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Phototonic.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest>
+#include <functional>
+#include "MetadataCache.h"
+
+namespace {
+class Worker : public QRunnable {
+
+public:
+    explicit Worker(const std::function<void()> &work) : work(work) {
+    }
+
+    void run() {
+        work();
+    }
+
+private:
+    std::function<void()> work;
+};
+
+QString imagePath(int thread, int image) {
+    return QString("/nonexistent/thread%1/image%2.jpg").arg(thread).arg(image);
+}
+
+ImageMetadata metadataWith(long orientation, const QString &tag) {
+    ImageMetadata imageMetadata;
+    imageMetadata.orientation = orientation;
+    imageMetadata.width = 640;
+    imageMetadata.height = 480;
+    imageMetadata.tagIds = TagDictionary::intern(QSet<QString>() << tag);
+    return imageMetadata;
+}
+}
+
+class TestMetadataCache : public QObject {
+Q_OBJECT
+
+private slots:
+
+    void initTestCase() {
+        // Keeps the persistent index away from the user's cache directory
+        QStandardPaths::setTestModeEnabled(true);
+    }
+
+    void updatesDoNotCreateEntries() {
+        MetadataCache metadataCache;
+        const QString imageFullPath = imagePath(0, 0);
+
+        metadataCache.setImageOrientation(imageFullPath, 6);
+        metadataCache.addTagToImage(imageFullPath, "holiday");
+        metadataCache.updateImageTags(imageFullPath, QSet<QString>() << "beach");
+
+        QVERIFY(!metadataCache.contains(imageFullPath));
+        QVERIFY(metadataCache.getImageTags(imageFullPath).isEmpty());
+    }
+
+    void updatesChangeCachedEntries() {
+        MetadataCache metadataCache;
+        const QString imageFullPath = imagePath(0, 0);
+        QHash<QString, ImageMetadata> images;
+        images.insert(imageFullPath, metadataWith(1, "holiday"));
+        metadataCache.insertImages(images);
+
+        metadataCache.setImageOrientation(imageFullPath, 8);
+        metadataCache.addTagToImage(imageFullPath, "beach");
+
+        QCOMPARE(metadataCache.getImageOrientation(imageFullPath), 8L);
+        QCOMPARE(metadataCache.getImageTags(imageFullPath), QSet<QString>() << "holiday" << "beach");
+    }
+
+    void updatesAfterClearLeaveImagesUncached() {
+        MetadataCache metadataCache;
+        const QString imageFullPath = imagePath(0, 0);
+        QHash<QString, ImageMetadata> images;
+        images.insert(imageFullPath, metadataWith(1, "holiday"));
+        metadataCache.insertImages(images);
+
+        // A job finishing after the folder changed
+        metadataCache.clear();
+        metadataCache.setImageOrientation(imageFullPath, 3);
+
+        QVERIFY(!metadataCache.contains(imageFullPath));
+    }
+
+    void concurrentAccess() {
+        const int threadCount = 8;
+        const int imageCount = 500;
+        MetadataCache metadataCache;
+        QThreadPool threadPool;
+        threadPool.setMaxThreadCount(threadCount + 1);
+
+        for (int thread = 0; thread < threadCount; ++thread) {
+            threadPool.start(new Worker([&metadataCache, thread, threadCount, imageCount]() {
+                for (int image = 0; image < imageCount; ++image) {
+                    const QString imageFullPath = imagePath(thread, image);
+                    QHash<QString, ImageMetadata> images;
+                    images.insert(imageFullPath, metadataWith(1, QString("tag%1").arg(image % 10)));
+                    metadataCache.insertImages(images);
+
+                    metadataCache.setImageOrientation(imageFullPath, 6);
+                    metadataCache.addTagToImage(imageFullPath, "shared");
+                    metadataCache.getImageTags(imagePath((thread + 1) % threadCount, image));
+                    metadataCache.setImageOrientation(imagePath((thread + 1) % threadCount, image), 3);
+                }
+            }));
+        }
+        // Clears race with the writers, so entries may vanish but must never be made up
+        threadPool.start(new Worker([&metadataCache]() {
+            for (int i = 0; i < 50; ++i) {
+                metadataCache.clear();
+                QThread::msleep(1);
+            }
+        }));
+        threadPool.waitForDone();
+
+        for (int thread = 0; thread < threadCount; ++thread) {
+            for (int image = 0; image < imageCount; ++image) {
+                const QString imageFullPath = imagePath(thread, image);
+                if (!metadataCache.contains(imageFullPath)) {
+                    continue;
+                }
+
+                long orientation = metadataCache.getImageOrientation(imageFullPath);
+                QVERIFY2(orientation == 1 || orientation == 3 || orientation == 6, qPrintable(imageFullPath));
+                QVERIFY(metadataCache.getImageTags(imageFullPath).contains(QString("tag%1").arg(image % 10)));
+            }
+        }
+
+        // Without clears every image ends up cached exactly as written last
+        metadataCache.clear();
+        for (int thread = 0; thread < threadCount; ++thread) {
+            threadPool.start(new Worker([&metadataCache, thread, imageCount]() {
+                for (int image = 0; image < imageCount; ++image) {
+                    QHash<QString, ImageMetadata> images;
+                    images.insert(imagePath(thread, image), metadataWith(1, "first"));
+                    metadataCache.insertImages(images);
+                    metadataCache.addTagToImage(imagePath(thread, image), "second");
+                }
+            }));
+        }
+        threadPool.waitForDone();
+
+        for (int thread = 0; thread < threadCount; ++thread) {
+            for (int image = 0; image < imageCount; ++image) {
+                QCOMPARE(metadataCache.getImageTags(imagePath(thread, image)),
+                         QSet<QString>() << "first" << "second");
+            }
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMetadataCache)
+
+#include "tst_metadatacache.moc"